@@ -0,0 +1,257 @@
+#include "aliasingPlanner.h"
+#include "reachability.h"
+#include "resourceState.h"
+#include "jsonReader.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 资源在拓扑序中的生命周期[first, last] */
+		struct LifetimeInterval {
+			uint32_t first;
+			uint32_t last;
+			ResourceIdx resource;
+		};
+
+		/** 静态的区间树: 区间按first排列，以有序数组的中点为根隐式地组成平衡二叉树，
+		 * 每个节点记录其子树中last的最大值 */
+		class IntervalTree {
+		public:
+			void Build(const std::vector<LifetimeInterval>& intervals) {
+				m_intervals = intervals;
+				std::sort(m_intervals.begin(), m_intervals.end(),
+					[](const LifetimeInterval& lhs, const LifetimeInterval& rhs) { return lhs.first < rhs.first; });
+				m_maxLast.assign(m_intervals.size(), 0);
+				buildHelper(0, m_intervals.size());
+			}
+			/** 访问所有与[first, last]重叠的区间 */
+			template<typename Visitor>
+			void Query(uint32_t first, uint32_t last, Visitor&& visit) const {
+				queryHelper(0, m_intervals.size(), first, last, visit);
+			}
+		private:
+			uint32_t buildHelper(size_t begin, size_t end) {
+				if (begin >= end) return 0;
+				size_t mid = begin + (end - begin) / 2;
+				uint32_t maxLast = std::max(m_intervals[mid].last,
+					std::max(buildHelper(begin, mid), buildHelper(mid + 1, end)));
+				m_maxLast[mid] = maxLast;
+				return maxLast;
+			}
+			template<typename Visitor>
+			void queryHelper(size_t begin, size_t end, uint32_t first, uint32_t last, Visitor& visit) const {
+				if (begin >= end) return;
+				size_t mid = begin + (end - begin) / 2;
+				if (m_maxLast[mid] < first) return;
+				queryHelper(begin, mid, first, last, visit);
+				/** 右子树中区间的first都不小于中点的first */
+				if (m_intervals[mid].first > last) return;
+				if (m_intervals[mid].last >= first) visit(m_intervals[mid].resource);
+				queryHelper(mid + 1, end, first, last, visit);
+			}
+		private:
+			std::vector<LifetimeInterval> m_intervals;
+			std::vector<uint32_t> m_maxLast;
+		};
+
+	}
+
+	bool PlanAliasing(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		AliasingPlan& plan, std::string* error)
+	{
+		plan.offsets.assign(resMap.size(), INVALID_OFFSET);
+		std::fill(plan.heapSizes, plan.heapSizes + HEAP_TYPE_COUNT, 0);
+		std::fill(plan.naiveSizes, plan.naiveSizes + HEAP_TYPE_COUNT, 0);
+		plan.barriers.clear();
+		ReachabilityIndex reachability;
+		if (!reachability.Build(passMap, ReachabilityIndex::Options(), error)) return false;
+		const PassIndex& index = reachability.Index();
+		const uint32_t lastRank = index.PassCount() == 0 ? 0 : index.PassCount() - 1;
+
+		/** 创建与删除资源的pass的编号，没有时为INVALID_INDEX */
+		std::vector<uint32_t> creates(resMap.size(), INVALID_INDEX), destroys(resMap.size(), INVALID_INDEX);
+		std::vector<LifetimeInterval> intervals;
+		std::vector<ResourceIdx> candidates;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			const Resource& resource = resMap[resIdx];
+			if (resource.size == 0) continue;
+			bool valid = (resource.firstCreate == INVALID_PASS_LOCATE || index.Contains(resource.firstCreate))
+				&& (resource.lastDestroy == INVALID_PASS_LOCATE || index.Contains(resource.lastDestroy))
+				&& resource.heapType < HEAP_TYPE_COUNT;
+			if (!valid) {
+				if (error) *error = "resource " + resource.name + " has an invalid lifetime or heap type";
+				return false;
+			}
+			if (resource.firstCreate != INVALID_PASS_LOCATE) creates[resIdx] = index.ToId(resource.firstCreate);
+			if (resource.lastDestroy != INVALID_PASS_LOCATE) destroys[resIdx] = index.ToId(resource.lastDestroy);
+			LifetimeInterval interval = { 0, lastRank, resIdx };
+			if (creates[resIdx] != INVALID_INDEX) interval.first = reachability.Rank(creates[resIdx]);
+			if (destroys[resIdx] != INVALID_INDEX) interval.last = reachability.Rank(destroys[resIdx]);
+			if (interval.last < interval.first) interval.last = interval.first;
+			intervals.push_back(interval);
+			candidates.push_back(resIdx);
+			plan.naiveSizes[resource.heapType] += resource.GetAlignedSize();
+		}
+		IntervalTree tree;
+		tree.Build(intervals);
+
+		/** before的生命周期是否在after开始之前结束 */
+		auto ordered = [&](ResourceIdx before, ResourceIdx after) {
+			return destroys[before] != INVALID_INDEX && creates[after] != INVALID_INDEX
+				&& reachability.HappensBefore(destroys[before], creates[after]);
+		};
+		/** 在queue上二分查找第一个满足条件的pass，条件沿queue单调(先不满足后满足)，找不到时返回queue中pass的数量 */
+		auto partition = [&](QueueIdx queIdx, const std::function<bool(uint32_t)>& predicate) {
+			uint32_t low = 0, high = index.QueueEnd(queIdx) - index.QueueBegin(queIdx);
+			while (low < high) {
+				uint32_t mid = low + (high - low) / 2;
+				if (predicate(index.QueueBegin(queIdx) + mid)) high = mid;
+				else low = mid + 1;
+			}
+			return low;
+		};
+
+		/** 大的资源先放，大小相同时按索引排列，保证结果稳定 */
+		std::stable_sort(candidates.begin(), candidates.end(), [&resMap](ResourceIdx lhs, ResourceIdx rhs) {
+			return resMap[lhs].GetAlignedSize() > resMap[rhs].GetAlignedSize();
+		});
+		std::vector<ResourceIdx> conflicts;
+		for (ResourceIdx resIdx : candidates) {
+			const Resource& resource = resMap[resIdx];
+			const uint64_t size = resource.GetAlignedSize();
+			const uint64_t alignment = resource.alignment > 1 ? resource.alignment : 1;
+			/** 拓扑序中不重叠的资源也可能在没有同步的queue上同时存在，因此把查询的范围扩大到[low, high]:
+			 * 在low之前结束的资源一定先于该资源的创建，在high之后开始的资源一定晚于该资源的删除 */
+			uint32_t low = 0, high = lastRank;
+			if (creates[resIdx] != INVALID_INDEX) {
+				low = lastRank;
+				for (QueueIdx queIdx = 0; queIdx < index.QueueCount(); ++queIdx) {
+					uint32_t first = partition(queIdx, [&](uint32_t id) {
+						return !reachability.HappensBefore(id, creates[resIdx]);
+					});
+					if (first < index.QueueEnd(queIdx) - index.QueueBegin(queIdx))
+						low = std::min(low, reachability.Rank(index.QueueBegin(queIdx) + first));
+				}
+			}
+			if (destroys[resIdx] != INVALID_INDEX) {
+				high = 0;
+				for (QueueIdx queIdx = 0; queIdx < index.QueueCount(); ++queIdx) {
+					uint32_t after = partition(queIdx, [&](uint32_t id) {
+						return reachability.HappensBefore(destroys[resIdx], id);
+					});
+					if (after > 0) high = std::max(high, reachability.Rank(index.QueueBegin(queIdx) + after - 1));
+				}
+			}
+			conflicts.clear();
+			tree.Query(low, high, [&](ResourceIdx other) {
+				if (plan.offsets[other] != INVALID_OFFSET && resMap[other].heapType == resource.heapType
+					&& !ordered(other, resIdx) && !ordered(resIdx, other))
+					conflicts.push_back(other);
+			});
+			/** 在冲突的资源之间找到第一个放得下的位置 */
+			std::sort(conflicts.begin(), conflicts.end(), [&plan](ResourceIdx lhs, ResourceIdx rhs) {
+				return plan.offsets[lhs] < plan.offsets[rhs];
+			});
+			uint64_t offset = 0;
+			for (ResourceIdx other : conflicts) {
+				if (plan.offsets[other] >= offset + size) break;
+				uint64_t end = plan.offsets[other] + resMap[other].GetAlignedSize();
+				if (end > offset) offset = (end + alignment - 1) / alignment * alignment;
+			}
+			plan.offsets[resIdx] = offset;
+			plan.heapSizes[resource.heapType] = std::max(plan.heapSizes[resource.heapType], offset + size);
+		}
+
+		/** 按创建的先后扫描，记录每个堆中每段内存最后的使用者；共享内存的资源之间一定有先后关系，
+		 * 因此资源开始使用时，其范围内的使用者即需要aliasing barrier的before */
+		struct Segment {
+			uint64_t end;
+			ResourceIdx resource;
+		};
+		std::map<uint64_t, Segment> occupants[HEAP_TYPE_COUNT];
+		std::sort(intervals.begin(), intervals.end(), [](const LifetimeInterval& lhs, const LifetimeInterval& rhs) {
+			return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.resource < rhs.resource;
+		});
+		std::vector<ResourceIdx> befores;
+		for (const auto& interval : intervals) {
+			const ResourceIdx resIdx = interval.resource;
+			auto& segments = occupants[resMap[resIdx].heapType];
+			const uint64_t begin = plan.offsets[resIdx], end = begin + resMap[resIdx].GetAlignedSize();
+			auto segment = segments.upper_bound(begin);
+			if (segment != segments.begin() && std::prev(segment)->second.end > begin) --segment;
+			befores.clear();
+			while (segment != segments.end() && segment->first < end) {
+				uint64_t segmentBegin = segment->first;
+				Segment covered = segment->second;
+				segment = segments.erase(segment);
+				if (std::find(befores.begin(), befores.end(), covered.resource) == befores.end())
+					befores.push_back(covered.resource);
+				/** 保留超出该资源范围的部分 */
+				if (segmentBegin < begin) segments[segmentBegin] = { begin, covered.resource };
+				if (covered.end > end) segment = segments.insert(std::make_pair(end, covered)).first;
+			}
+			segments[begin] = { end, resIdx };
+			for (ResourceIdx before : befores)
+				plan.barriers.push_back({ before, resIdx, resMap[resIdx].firstCreate });
+		}
+		std::stable_sort(plan.barriers.begin(), plan.barriers.end(),
+			[](const PlannedAliasingBarrier& lhs, const PlannedAliasingBarrier& rhs) { return lhs.after < rhs.after; });
+		return true;
+	}
+
+	bool SaveAliasingPlan(const char* path, const std::vector<Resource>& resMap, const AliasingPlan& plan)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file) return false;
+		std::fprintf(file, "{\n  \"heaps\": [");
+		bool firstEntry = true;
+		for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+			if (plan.naiveSizes[heap] == 0) continue;
+			std::fprintf(file, "%s\n    { \"heap\": \"%s\", \"size\": %llu, \"naiveSize\": %llu }", firstEntry ? "" : ",",
+				HEAP_TYPE_NAMES[heap], static_cast<unsigned long long>(plan.heapSizes[heap]),
+				static_cast<unsigned long long>(plan.naiveSizes[heap]));
+			firstEntry = false;
+		}
+		std::fprintf(file, " ],\n  \"resources\": [");
+		firstEntry = true;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			if (plan.offsets[resIdx] == INVALID_OFFSET) continue;
+			const Resource& resource = resMap[resIdx];
+			std::fprintf(file, "%s\n    { \"name\": \"%s\", \"heap\": \"%s\", \"offset\": %llu, \"size\": %llu }",
+				firstEntry ? "" : ",", EscapeJson(resource.name).c_str(), HEAP_TYPE_NAMES[resource.heapType],
+				static_cast<unsigned long long>(plan.offsets[resIdx]),
+				static_cast<unsigned long long>(resource.GetAlignedSize()));
+			firstEntry = false;
+		}
+		std::fprintf(file, " ],\n  \"aliasingBarriers\": [");
+		firstEntry = true;
+		for (const auto& barrier : plan.barriers) {
+			std::fprintf(file, "%s\n    { \"before\": \"%s\", \"after\": \"%s\", \"pass\": [%u, %u] }",
+				firstEntry ? "" : ",", EscapeJson(resMap[barrier.before].name).c_str(),
+				EscapeJson(resMap[barrier.after].name).c_str(), barrier.pass.queueIndex, barrier.pass.inqueueIndex);
+			firstEntry = false;
+		}
+		std::fprintf(file, " ]\n}\n");
+		bool succeed = std::ferror(file) == 0;
+		return std::fclose(file) == 0 && succeed;
+	}
+
+	void AnnotateAliasingPlan(PipelineGraph& graph, const AliasingPlan& plan)
+	{
+		const auto& resMap = graph.GetResourceMap();
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			if (plan.offsets[resIdx] == INVALID_OFFSET) continue;
+			graph.MarkResource(resIdx, 0, "offset " + std::to_string(plan.offsets[resIdx]) + " in "
+				+ HEAP_TYPE_NAMES[resMap[resIdx].heapType] + " heap");
+		}
+		for (const auto& barrier : plan.barriers)
+			graph.MarkPass(barrier.pass, 0, "aliasing barrier: " + resMap[barrier.before].name
+				+ " -> " + resMap[barrier.after].name);
+	}
+
+}
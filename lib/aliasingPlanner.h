@@ -0,0 +1,49 @@
+#ifndef ALIASING_PLANNER_H
+#define ALIASING_PLANNER_H
+
+#include "ppfg.h"
+
+/** 规划资源在堆中的位置，使生命周期不重叠的资源共享内存
+ * 两个资源可以重叠当且仅当其中一个的lastDestroy先于(happens-before)另一个的firstCreate，
+ * 没有创建或删除的pass的资源视为一直存在；资源按对齐后的大小从大到小依次放入其所在的堆，
+ * 放在与之冲突的资源之间第一个放得下的位置。冲突的资源由按拓扑序中生命周期建立的区间树查询，
+ * 查询范围扩大到没有同步的queue上可能同时执行的pass，再逐个检查先后关系 */
+namespace PipelineProfilingGraph {
+
+	const uint64_t INVALID_OFFSET = UINT64_MAX;
+
+	/** 复用内存时需要的aliasing barrier */
+	struct PlannedAliasingBarrier {
+		ResourceIdx before; /**< 在after之前占用这块内存的资源 */
+		ResourceIdx after; /**< 开始使用这块内存的资源 */
+		PassLocate pass; /**< 需要提交barrier的pass，即after的firstCreate */
+	};
+
+	struct AliasingPlan {
+		std::vector<uint64_t> offsets; /**< 每个资源在其堆中的偏移，没有记录大小的资源为INVALID_OFFSET */
+		uint64_t heapSizes[HEAP_TYPE_COUNT]; /**< 规划后每个堆的大小 */
+		uint64_t naiveSizes[HEAP_TYPE_COUNT]; /**< 不复用内存时每个堆的大小，即资源大小之和 */
+		std::vector<PlannedAliasingBarrier> barriers; /**< 复用内存的资源需要的barrier，按after的索引排列 */
+	};
+
+	/** 规划所有记录了大小的资源在堆中的位置
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param plan 规划的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 图中引用了未知的pass、fence之间存在环或者资源的堆类型无效时返回false */
+	bool PlanAliasing(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		AliasingPlan& plan, std::string* error = nullptr);
+	/** 将规划结果写成JSON文件，可以直接交给分配器使用
+	 * 格式: { "heaps": [ { "heap": "DEFAULT", "size": 字节数, "naiveSize": 字节数 } ],
+	 *         "resources": [ { "name": 名称, "heap": "DEFAULT", "offset": 偏移, "size": 对齐后的大小 } ],
+	 *         "aliasingBarriers": [ { "before": 名称, "after": 名称, "pass": [queue索引, queue内索引] } ] }
+	 * @return 是否写入成功 */
+	bool SaveAliasingPlan(const char* path, const std::vector<Resource>& resMap, const AliasingPlan& plan);
+	/** 在资源的描述中加入其偏移，并在需要aliasing barrier的pass的描述中说明
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void AnnotateAliasingPlan(PipelineGraph& graph, const AliasingPlan& plan);
+
+}
+
+#endif // ALIASING_PLANNER_H
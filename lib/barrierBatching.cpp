@@ -0,0 +1,45 @@
+#include "barrierBatching.h"
+
+namespace PipelineProfilingGraph {
+
+	void AnalyzeBarrierBatching(const PipelineGraph& graph, BarrierBatchingReport& report)
+	{
+		report.batches.clear();
+		report.flushesBefore = 0;
+		const auto& passMap = graph.GetPassMap();
+		const auto& resMap = graph.GetResourceMap();
+		BarrierBatch positions[2];
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx) {
+				uint32_t count = 0;
+				const BarrierRef* barriers = graph.GetPassBarriers({ queIdx, passIdx }, count);
+				if (count == 0) continue;
+				report.flushesBefore += count;
+				for (uint8_t position = 0; position < 2; ++position) {
+					positions[position].pass = { queIdx, passIdx };
+					positions[position].position = static_cast<BarrierBatch::Position>(position);
+					positions[position].barriers.clear();
+				}
+				for (uint32_t barrierIdx = 0; barrierIdx < count; ++barrierIdx) {
+					const BarrierRef& ref = barriers[barrierIdx];
+					bool after = (resMap[ref.resource].barriers[ref.barrierIndex].flags & Barrier::BEGIN) != 0;
+					positions[after ? BarrierBatch::AFTER_PASS : BarrierBatch::BEFORE_PASS].barriers.push_back(ref);
+				}
+				for (auto& batch : positions)
+					if (!batch.barriers.empty()) report.batches.push_back(batch);
+			}
+		}
+		report.flushesAfter = report.batches.size();
+	}
+
+	void HighlightBarrierBatches(PipelineGraph& graph, const BarrierBatchingReport& report)
+	{
+		for (const auto& batch : report.batches) {
+			if (batch.barriers.size() < 2) continue;
+			graph.MarkPass(batch.pass, Rectangle::HIGHLIGHT, std::to_string(batch.barriers.size())
+				+ (batch.position == BarrierBatch::BEFORE_PASS ? " barriers before" : " barriers after")
+				+ " this pass can be batched into one call");
+		}
+	}
+
+}
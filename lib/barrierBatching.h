@@ -0,0 +1,40 @@
+#ifndef BARRIER_BATCHING_H
+#define BARRIER_BATCHING_H
+
+#include "ppfg.h"
+
+/** 分析同一个pass提交的barrier能否合并为一次ResourceBarrier调用
+ * 按提交的pass以及提交的位置分组: 带BEGIN的barrier在pass之后提交，其余barrier在pass之前提交，
+ * 同一组内的barrier可以合并为一次调用；假设输入中每个barrier都是单独的一次调用，每次调用都会导致一次GPU flush */
+namespace PipelineProfilingGraph {
+
+	struct BarrierBatch {
+		enum Position : uint8_t {
+			BEFORE_PASS, /**< 在pass之前提交，包括IMMEDIACY与END */
+			AFTER_PASS, /**< 在pass之后提交，即split barrier的BEGIN */
+		};
+		PassLocate pass; /**< 提交这组barrier的pass */
+		Position position;
+		std::vector<BarrierRef> barriers; /**< 可以合并的barrier，按资源的索引排列 */
+	};
+
+	struct BarrierBatchingReport {
+		std::vector<BarrierBatch> batches; /**< 所有的分组，按pass以及位置排列 */
+		size_t flushesBefore; /**< 合并前的flush次数，即barrier的数量 */
+		size_t flushesAfter; /**< 合并后的flush次数，即分组的数量 */
+		/** 可以省去的flush所占的比例，没有barrier时为0 */
+		float Score() const {
+			return flushesBefore ? static_cast<float>(flushesBefore - flushesAfter) / static_cast<float>(flushesBefore) : 0.0f;
+		}
+	};
+
+	/** 对图中所有的barrier分组
+	 * @remark 使用Setup建立的查询索引，调用该函数前，必须保证graph的Setup被调用 */
+	void AnalyzeBarrierBatching(const PipelineGraph& graph, BarrierBatchingReport& report);
+	/** 在提交了多个可以合并的barrier的pass的描述中说明可以合并的数量，并突出显示这些pass
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightBarrierBatches(PipelineGraph& graph, const BarrierBatchingReport& report);
+
+}
+
+#endif // BARRIER_BATCHING_H
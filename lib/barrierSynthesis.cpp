@@ -0,0 +1,177 @@
+#include "barrierSynthesis.h"
+#include "passOrder.h"
+#include "resourceState.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		struct Access {
+			uint32_t rank; /**< pass在拓扑序中的位置 */
+			PassLocate pass;
+			uint16_t state;
+			bool write;
+		};
+
+		/** 一组可以在同一状态下完成的连续访问，[first, last]为其在访问数组中的范围 */
+		struct AccessGroup {
+			size_t first;
+			size_t last;
+			uint16_t state;
+			bool write;
+		};
+
+		/** 只读访问之间可以合并为一个组合状态，UNORDERED_ACCESS的读取只能与相同状态合并 */
+		bool canMerge(const AccessGroup& group, const Access& access) {
+			if (group.write || access.write) return false;
+			return group.state == access.state
+				|| ((group.state | access.state) & ~READ_ONLY_STATES) == 0;
+		}
+
+		std::string describeTransition(uint16_t before, uint16_t after) {
+			return DescribeResourceStates(before) + " -> " + DescribeResourceStates(after);
+		}
+
+		class ResourceBarrierSynthesizer {
+		public:
+			ResourceBarrierSynthesizer(const PassIndex& index, const std::vector<uint32_t>& ranks,
+				const BarrierSynthesisOptions& options)
+				: m_index(index), m_ranks(ranks), m_options(options) {}
+
+			bool Synthesize(const Resource& resource, std::vector<Barrier>& barriers, std::string* error) {
+				barriers.clear();
+				if (!collect(resource, error)) return false;
+				buildGroups();
+				if (resource.firstCreate != INVALID_PASS_LOCATE && m_options.aliasCreatedResources) {
+					barriers.push_back(Barrier(resource.firstCreate, "ALIASING",
+						Barrier::ALIASING_BARRIER | Barrier::IMMEDIACY));
+				}
+				if (m_groups.empty()) return true;
+				if (resource.firstCreate == INVALID_PASS_LOCATE && m_groups.size() > 1) {
+					/** 资源在帧之间保持状态，上一帧结束时处于最后一组的状态 */
+					const AccessGroup& first = m_groups.front();
+					uint16_t before = m_groups.back().state;
+					if (before != first.state) {
+						barriers.push_back(Barrier(m_accesses[first.first].pass, describeTransition(before, first.state).c_str(),
+							Barrier::TRANSITION_BARRIER | Barrier::IMMEDIACY, before, first.state));
+					}
+				}
+				for (size_t groupIdx = 1; groupIdx < m_groups.size(); ++groupIdx)
+					connect(m_groups[groupIdx - 1], m_groups[groupIdx], barriers);
+				return true;
+			}
+		private:
+			bool collect(const Resource& resource, std::string* error) {
+				m_accesses.clear();
+				auto add = [this](const PassLocate& pass, uint16_t state, bool write) {
+					if (!m_index.Contains(pass)) return false;
+					m_accesses.push_back({ m_ranks[m_index.ToId(pass)], pass, state, write });
+					return true;
+				};
+				bool succeed = true;
+				for (size_t readIdx = 0; readIdx < resource.readPasses.size(); ++readIdx)
+					succeed = add(resource.readPasses[readIdx], resource.GetReadState(readIdx), false) && succeed;
+				for (size_t writeIdx = 0; writeIdx < resource.writedPasses.size(); ++writeIdx)
+					succeed = add(resource.writedPasses[writeIdx], resource.GetWriteState(writeIdx), true) && succeed;
+				if (!succeed) {
+					if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+					return false;
+				}
+				std::sort(m_accesses.begin(), m_accesses.end(), [](const Access& lhs, const Access& rhs) {
+					return lhs.rank < rhs.rank;
+				});
+				/** 同一个pass的多次访问合并为一次，写入优先 */
+				size_t count = 0;
+				for (size_t accessIdx = 0; accessIdx < m_accesses.size(); ++accessIdx) {
+					const Access& access = m_accesses[accessIdx];
+					if (count != 0 && m_accesses[count - 1].rank == access.rank) {
+						Access& merged = m_accesses[count - 1];
+						if (access.write && !merged.write) merged = access;
+						else if (access.write == merged.write && !access.write) merged.state |= access.state;
+						continue;
+					}
+					m_accesses[count++] = access;
+				}
+				m_accesses.resize(count);
+				return true;
+			}
+			void buildGroups() {
+				m_groups.clear();
+				for (size_t accessIdx = 0; accessIdx < m_accesses.size(); ++accessIdx) {
+					const Access& access = m_accesses[accessIdx];
+					if (!m_groups.empty() && canMerge(m_groups.back(), access)) {
+						m_groups.back().last = accessIdx;
+						m_groups.back().state |= access.state;
+						continue;
+					}
+					m_groups.push_back({ accessIdx, accessIdx, access.state, access.write });
+				}
+			}
+			/** 生成从prev切换到next所需的barrier */
+			void connect(const AccessGroup& prev, const AccessGroup& next, std::vector<Barrier>& barriers) {
+				const PassLocate& consumer = m_accesses[next.first].pass;
+				if (prev.state == next.state) {
+					if ((next.state & STATE_UNORDERED_ACCESS) && (prev.write || next.write))
+						barriers.push_back(Barrier(consumer, "UAV", Barrier::UAV_BARRIER | Barrier::IMMEDIACY,
+							next.state, next.state));
+					return;
+				}
+				std::string desc = describeTransition(prev.state, next.state);
+				const PassLocate& producer = m_accesses[prev.last].pass;
+				if (m_options.splitBarriers && hasSlack(prev, consumer)) {
+					barriers.push_back(Barrier(producer, desc.c_str(),
+						Barrier::TRANSITION_BARRIER | Barrier::BEGIN, prev.state, next.state));
+					barriers.push_back(Barrier(consumer, desc.c_str(),
+						Barrier::TRANSITION_BARRIER | Barrier::END, prev.state, next.state));
+				}
+				else {
+					barriers.push_back(Barrier(consumer, desc.c_str(),
+						Barrier::TRANSITION_BARRIER | Barrier::IMMEDIACY, prev.state, next.state));
+				}
+			}
+			/** 前一组的所有访问都在consumer的queue上，并且与consumer之间至少隔了一个pass */
+			bool hasSlack(const AccessGroup& prev, const PassLocate& consumer) const {
+				for (size_t accessIdx = prev.first; accessIdx <= prev.last; ++accessIdx)
+					if (m_accesses[accessIdx].pass.queueIndex != consumer.queueIndex) return false;
+				return consumer.inqueueIndex > m_accesses[prev.last].pass.inqueueIndex + 1;
+			}
+		private:
+			const PassIndex& m_index;
+			const std::vector<uint32_t>& m_ranks;
+			const BarrierSynthesisOptions& m_options;
+			std::vector<Access> m_accesses; /**< 当前资源的访问，按拓扑序排列 */
+			std::vector<AccessGroup> m_groups;
+		};
+	}
+
+	bool SynthesizeBarriers(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		std::vector< std::vector<Barrier> >& barriers,
+		const BarrierSynthesisOptions& options, std::string* error)
+	{
+		PassIndex index(passMap);
+		std::vector<uint32_t> order;
+		if (!TopologicalOrder(passMap, index, order, error)) return false;
+		std::vector<uint32_t> ranks(order.size());
+		for (uint32_t rank = 0; rank < order.size(); ++rank)
+			ranks[order[rank]] = rank;
+
+		ResourceBarrierSynthesizer synthesizer(index, ranks, options);
+		barriers.resize(resMap.size());
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			if (!synthesizer.Synthesize(resMap[resIdx], barriers[resIdx], error)) return false;
+		return true;
+	}
+
+	bool SynthesizeBarriers(const std::vector<Queue>& passMap, std::vector<Resource>& resMap,
+		const BarrierSynthesisOptions& options, std::string* error)
+	{
+		std::vector< std::vector<Barrier> > barriers;
+		if (!SynthesizeBarriers(passMap, static_cast<const std::vector<Resource>&>(resMap), barriers, options, error))
+			return false;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			resMap[resIdx].barriers.swap(barriers[resIdx]);
+		return true;
+	}
+
+}
@@ -0,0 +1,39 @@
+#ifndef BARRIER_SYNTHESIS_H
+#define BARRIER_SYNTHESIS_H
+
+#include "ppfg.h"
+
+/** 根据每次读写时资源所处的状态自动生成barrier
+ * 资源的所有访问按pass的拓扑序排列，连续的只读访问合并为一组并使用组合后的状态，
+ * 相邻两组状态不同时需要TRANSITION_BARRIER，均为UNORDERED_ACCESS且至少一方写入时需要UAV_BARRIER
+ * 生成的结果可以与引擎实际提交的barrier进行比较 */
+namespace PipelineProfilingGraph {
+
+	struct BarrierSynthesisOptions {
+		/** 前一组的最后一个pass与下一组的第一个pass在同一queue上且中间隔有其他pass时，
+		 * 将TRANSITION_BARRIER拆分为BEGIN/END，否则在下一组的第一个pass上立即切换 */
+		bool splitBarriers = true;
+		/** 由pass创建的资源可能与其他资源共用内存，在创建它的pass上加入ALIASING_BARRIER */
+		bool aliasCreatedResources = true;
+	};
+
+	/** 为每个资源生成最少的barrier
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源，其中已有的barrier不会被使用
+	 * @param barriers 每个资源生成的barrier，与resMap一一对应
+	 * @param options 生成时的选项
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 资源引用了未知的pass或者fence之间存在环时返回false
+	 * @remark 一组访问跨越多个queue时，barrier放在组内拓扑序最靠前的pass上，
+	 * 一直存在的资源(没有创建它的pass)在帧之间保持状态，即第一组的初始状态为最后一组的状态 */
+	bool SynthesizeBarriers(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		std::vector< std::vector<Barrier> >& barriers,
+		const BarrierSynthesisOptions& options = BarrierSynthesisOptions(), std::string* error = nullptr);
+	/** 为每个资源生成最少的barrier，并替换资源中原有的barrier
+	 * @remark 参数同上 */
+	bool SynthesizeBarriers(const std::vector<Queue>& passMap, std::vector<Resource>& resMap,
+		const BarrierSynthesisOptions& options = BarrierSynthesisOptions(), std::string* error = nullptr);
+
+}
+
+#endif // BARRIER_SYNTHESIS_H
@@ -0,0 +1,406 @@
+#include "capture.h"
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PipelineProfilingGraph {
+
+	static_assert(sizeof(PassLocate) == 8, "PassLocate is stored directly in captures");
+	static_assert(sizeof(CaptureHeader) == 128, "unexpected CaptureHeader layout");
+	static_assert(sizeof(CapturePass) == 24, "unexpected CapturePass layout");
+	static_assert(sizeof(CaptureResource) == 64, "unexpected CaptureResource layout");
+	static_assert(sizeof(CaptureBarrier) == 24, "unexpected CaptureBarrier layout");
+
+	MappedFile::MappedFile() : m_data(nullptr), m_size(0)
+#ifdef _WIN32
+		, m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif
+	{}
+
+	MappedFile::~MappedFile() {
+		Close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::Open(const char* path) {
+		Close();
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+			Close();
+			return false;
+		}
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping) {
+			Close();
+			return false;
+		}
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data) {
+			Close();
+			return false;
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+		m_size = 0;
+	}
+#else
+	bool MappedFile::Open(const char* path) {
+		Close();
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close(fd);
+			return false;
+		}
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		/** 映射建立后即可关闭文件描述符 */
+		close(fd);
+		if (data == MAP_FAILED) return false;
+		madvise(data, static_cast<size_t>(info.st_size), MADV_WILLNEED);
+		m_data = data;
+		m_size = static_cast<size_t>(info.st_size);
+		return true;
+	}
+
+	void MappedFile::Close() {
+		if (m_data) munmap(const_cast<void*>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+#endif
+
+	namespace {
+		const uint64_t TABLE_ALIGNMENT = 8;
+
+		uint64_t alignUp(uint64_t value) {
+			return (value + TABLE_ALIGNMENT - 1) & ~(TABLE_ALIGNMENT - 1);
+		}
+
+		bool tableFits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size) {
+			if (offset % TABLE_ALIGNMENT != 0 || offset > size) return false;
+			return stride == 0 || count <= (size - offset) / stride;
+		}
+
+		/** 检查pass之间的依赖是否无环，pass依赖于同一queue上的前一个pass以及其fence等待的pass
+		 * pass按queue以及queue内的索引编号，各个表需要已经检查过 */
+		bool fencesAcyclic(const uint32_t* queues, uint32_t queueCount, const uint32_t* fenceOffsets,
+			const PassLocate* fences, uint32_t passCount) {
+			/** 后继以CSR的方式存储，queue内的后继即下一个编号，不需要存储 */
+			std::vector<uint32_t> inDegrees(passCount, 0);
+			std::vector<uint32_t> successorOffsets(passCount + 1, 0);
+			for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+				for (uint32_t passIdx = queues[queIdx]; passIdx < queues[queIdx + 1]; ++passIdx) {
+					inDegrees[passIdx] = (passIdx != queues[queIdx] ? 1 : 0) + fenceOffsets[passIdx + 1] - fenceOffsets[passIdx];
+					for (uint32_t fenceIdx = fenceOffsets[passIdx]; fenceIdx < fenceOffsets[passIdx + 1]; ++fenceIdx)
+						++successorOffsets[queues[fences[fenceIdx].queueIndex] + fences[fenceIdx].inqueueIndex + 1];
+				}
+			}
+			for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx)
+				successorOffsets[passIdx + 1] += successorOffsets[passIdx];
+			std::vector<uint32_t> successors(successorOffsets.back());
+			std::vector<uint32_t> cursor(successorOffsets.begin(), successorOffsets.end() - 1);
+			std::vector<uint8_t> queueLast(passCount, 0);
+			for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+				if (queues[queIdx] != queues[queIdx + 1]) queueLast[queues[queIdx + 1] - 1] = 1;
+				for (uint32_t passIdx = queues[queIdx]; passIdx < queues[queIdx + 1]; ++passIdx) {
+					for (uint32_t fenceIdx = fenceOffsets[passIdx]; fenceIdx < fenceOffsets[passIdx + 1]; ++fenceIdx)
+						successors[cursor[queues[fences[fenceIdx].queueIndex] + fences[fenceIdx].inqueueIndex]++] = passIdx;
+				}
+			}
+			std::vector<uint32_t> ready;
+			ready.reserve(passCount);
+			for (uint32_t passIdx = 0; passIdx < passCount; ++passIdx)
+				if (inDegrees[passIdx] == 0) ready.push_back(passIdx);
+			for (size_t head = 0; head < ready.size(); ++head) {
+				uint32_t passIdx = ready[head];
+				if (!queueLast[passIdx] && --inDegrees[passIdx + 1] == 0) ready.push_back(passIdx + 1);
+				for (uint32_t index = successorOffsets[passIdx]; index < successorOffsets[passIdx + 1]; ++index)
+					if (--inDegrees[successors[index]] == 0) ready.push_back(successors[index]);
+			}
+			return ready.size() == passCount;
+		}
+	}
+
+	bool CaptureView::Parse(const void* data, size_t size, std::string* error)
+	{
+		auto fail = [error](const char* reason) {
+			if (error) *error = reason;
+			return false;
+		};
+		m_data = static_cast<const uint8_t*>(data);
+		m_header = static_cast<const CaptureHeader*>(data);
+		if (reinterpret_cast<uintptr_t>(data) % TABLE_ALIGNMENT != 0) return fail("capture is not aligned");
+		if (size < sizeof(CaptureHeader)) return fail("capture is truncated");
+		const CaptureHeader& header = *m_header;
+		if (header.magic != CAPTURE_MAGIC) return fail("not a capture");
+		if (header.version != CAPTURE_VERSION) return fail("unsupported capture version");
+		if (header.passStride < sizeof(CapturePass) || header.resourceStride < sizeof(CaptureResource)
+			|| header.barrierStride < sizeof(CaptureBarrier))
+			return fail("capture records are too small");
+		if (header.totalSize > size) return fail("capture is truncated");
+		size = static_cast<size_t>(header.totalSize);
+		if (!tableFits(header.stringTableOffset, header.stringTableSize, 1, size)
+			|| !tableFits(header.queueTableOffset, header.queueCount + 1ULL, sizeof(uint32_t), size)
+			|| !tableFits(header.passTableOffset, header.passCount, header.passStride, size)
+			|| !tableFits(header.fenceOffsetTableOffset, header.passCount + 1ULL, sizeof(uint32_t), size)
+			|| !tableFits(header.fenceTableOffset, header.fenceCount, sizeof(PassLocate), size)
+			|| !tableFits(header.resourceTableOffset, header.resourceCount, header.resourceStride, size)
+			|| !tableFits(header.accessTableOffset, header.accessCount, sizeof(PassLocate), size)
+			|| !tableFits(header.barrierTableOffset, header.barrierCount, header.barrierStride, size))
+			return fail("capture table out of range");
+		if (header.stringTableSize == 0 || m_data[header.stringTableOffset + header.stringTableSize - 1] != '\0')
+			return fail("capture string table is not terminated");
+
+		m_queues = reinterpret_cast<const uint32_t*>(m_data + header.queueTableOffset);
+		m_fenceOffsets = reinterpret_cast<const uint32_t*>(m_data + header.fenceOffsetTableOffset);
+		m_fences = reinterpret_cast<const PassLocate*>(m_data + header.fenceTableOffset);
+		m_accesses = reinterpret_cast<const PassLocate*>(m_data + header.accessTableOffset);
+
+		/** 检查各个CSR表以及所有的索引 */
+		if (m_queues[0] != 0 || m_queues[header.queueCount] != header.passCount)
+			return fail("capture queue table is inconsistent");
+		for (QueueIdx queIdx = 0; queIdx < header.queueCount; ++queIdx)
+			if (m_queues[queIdx] > m_queues[queIdx + 1]) return fail("capture queue table is inconsistent");
+		if (m_fenceOffsets[0] != 0 || m_fenceOffsets[header.passCount] != header.fenceCount)
+			return fail("capture fence table is inconsistent");
+		for (uint32_t passIdx = 0; passIdx < header.passCount; ++passIdx)
+			if (m_fenceOffsets[passIdx] > m_fenceOffsets[passIdx + 1]) return fail("capture fence table is inconsistent");
+		auto validLocate = [this, &header](const PassLocate& locate) {
+			return locate.queueIndex < header.queueCount && locate.inqueueIndex < PassCount(locate.queueIndex);
+		};
+		auto validString = [&header](uint32_t offset) { return offset < header.stringTableSize; };
+		/** 同一queue中pass的帧索引不递减，并且小于帧的数量，每一帧至少有一个pass */
+		uint32_t frameCount = header.frameCount;
+		if (frameCount > header.passCount) return fail("capture frame count is invalid");
+		for (QueueIdx queIdx = 0; queIdx < header.queueCount; ++queIdx) {
+			FrameIdx lastFrame = 0;
+			for (uint32_t passIdx = m_queues[queIdx]; passIdx < m_queues[queIdx + 1]; ++passIdx) {
+				const CapturePass& pass = record<CapturePass>(header.passTableOffset, header.passStride, passIdx);
+				if (!validString(pass.nameOffset)) return fail("capture pass name out of range");
+				if (pass.frame < lastFrame || pass.frame >= frameCount) return fail("capture pass has an invalid frame");
+				lastFrame = pass.frame;
+			}
+		}
+		for (uint32_t fenceIdx = 0; fenceIdx < header.fenceCount; ++fenceIdx)
+			if (!validLocate(m_fences[fenceIdx])) return fail("capture fence refers to an unknown pass");
+		for (uint32_t accessIdx = 0; accessIdx < header.accessCount; ++accessIdx)
+			if (!validLocate(m_accesses[accessIdx])) return fail("capture access refers to an unknown pass");
+		for (uint32_t barrierIdx = 0; barrierIdx < header.barrierCount; ++barrierIdx) {
+			const CaptureBarrier& barrier = GetBarrier(barrierIdx);
+			if (!validLocate(barrier.submitPass) || !validString(barrier.descOffset))
+				return fail("capture barrier is invalid");
+		}
+		for (ResourceIdx resIdx = 0; resIdx < header.resourceCount; ++resIdx) {
+			const CaptureResource& resource = GetResource(resIdx);
+			bool valid = validString(resource.nameOffset)
+				&& (resource.firstCreate == INVALID_PASS_LOCATE || validLocate(resource.firstCreate))
+				&& (resource.lastDestroy == INVALID_PASS_LOCATE || validLocate(resource.lastDestroy))
+				&& static_cast<uint64_t>(resource.readBegin) + resource.readCount <= header.accessCount
+				&& static_cast<uint64_t>(resource.writeBegin) + resource.writeCount <= header.accessCount
+				&& static_cast<uint64_t>(resource.barrierBegin) + resource.barrierCount <= header.barrierCount
+				&& resource.heapType < HEAP_TYPE_COUNT;
+			if (!valid) return fail("capture resource is invalid");
+		}
+		/** fence之间存在环时Setup无法完成布局 */
+		if (!fencesAcyclic(m_queues, header.queueCount, m_fenceOffsets, m_fences, header.passCount))
+			return fail("fences form a cycle");
+		return true;
+	}
+
+	void CaptureView::BuildGraph(std::vector<Queue>& passMap, std::vector<Resource>& resMap) const
+	{
+		passMap.clear();
+		resMap.clear();
+		passMap.resize(m_header->queueCount);
+		for (QueueIdx queIdx = 0; queIdx < m_header->queueCount; ++queIdx) {
+			Queue& queue = passMap[queIdx];
+			uint32_t passCount = PassCount(queIdx);
+			queue.reserve(passCount);
+			for (PassIdx passIdx = 0; passIdx < passCount; ++passIdx) {
+				PassLocate locate = { queIdx, passIdx };
+				uint32_t fenceCount = 0;
+				const PassLocate* fences = PassFences(locate, fenceCount);
+				queue.push_back(Pass(PassName(locate), queIdx, passIdx,
+					FenceSignalPasses(fences, fences + fenceCount)));
+				const CapturePass& src = GetPass(locate);
+				queue.back().frame = src.frame;
+				queue.back().startTime = src.startTime;
+				queue.back().endTime = src.endTime;
+			}
+		}
+		resMap.resize(m_header->resourceCount);
+		for (ResourceIdx resIdx = 0; resIdx < m_header->resourceCount; ++resIdx) {
+			const CaptureResource& src = GetResource(resIdx);
+			Resource& dst = resMap[resIdx];
+			dst.name = String(src.nameOffset);
+			dst.frame = src.frame;
+			dst.firstCreate = src.firstCreate;
+			dst.lastDestroy = src.lastDestroy;
+			dst.size = src.size;
+			dst.alignment = src.alignment;
+			dst.heapType = src.heapType;
+			dst.readPasses.assign(m_accesses + src.readBegin, m_accesses + src.readBegin + src.readCount);
+			dst.writedPasses.assign(m_accesses + src.writeBegin, m_accesses + src.writeBegin + src.writeCount);
+			dst.barriers.reserve(src.barrierCount);
+			for (uint32_t barrierIdx = src.barrierBegin; barrierIdx < src.barrierBegin + src.barrierCount; ++barrierIdx) {
+				const CaptureBarrier& barrier = GetBarrier(barrierIdx);
+				dst.barriers.push_back(Barrier(barrier.submitPass, String(barrier.descOffset), barrier.flags));
+				dst.barriers.back().stateBefore = barrier.stateBefore;
+				dst.barriers.back().stateAfter = barrier.stateAfter;
+			}
+		}
+	}
+
+	void SerializeCapture(const std::vector<Queue>& passMap,
+		const std::vector<Resource>& resMap, std::vector<uint8_t>& capture)
+	{
+		CaptureHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = CAPTURE_MAGIC;
+		header.version = CAPTURE_VERSION;
+		header.queueCount = static_cast<uint32_t>(passMap.size());
+		header.passStride = sizeof(CapturePass);
+		header.resourceStride = sizeof(CaptureResource);
+		header.barrierStride = sizeof(CaptureBarrier);
+		header.resourceCount = static_cast<uint32_t>(resMap.size());
+
+		/** 相同的字符串只保存一次 */
+		std::string strings(1, '\0');
+		std::unordered_map<std::string, uint32_t> stringOffsets;
+		auto intern = [&strings, &stringOffsets](const std::string& str) {
+			auto inserted = stringOffsets.insert(std::make_pair(str, static_cast<uint32_t>(strings.size())));
+			if (inserted.second) strings.append(str.c_str(), str.size() + 1);
+			return inserted.first->second;
+		};
+
+		std::vector<uint32_t> queues(1, 0);
+		std::vector<CapturePass> passes;
+		std::vector<uint32_t> fenceOffsets(1, 0);
+		std::vector<PassLocate> fences;
+		for (const auto& queue : passMap) {
+			for (const auto& pass : queue) {
+				if (pass.frame >= header.frameCount) header.frameCount = pass.frame + 1;
+				passes.push_back({ intern(pass.name), pass.frame, pass.startTime, pass.endTime });
+				fences.insert(fences.end(), pass.depPasses.begin(), pass.depPasses.end());
+				fenceOffsets.push_back(static_cast<uint32_t>(fences.size()));
+			}
+			queues.push_back(static_cast<uint32_t>(passes.size()));
+		}
+		std::vector<CaptureResource> resources;
+		std::vector<PassLocate> accesses;
+		std::vector<CaptureBarrier> barriers;
+		resources.reserve(resMap.size());
+		for (const auto& resource : resMap) {
+			CaptureResource dst;
+			std::memset(&dst, 0, sizeof(dst));
+			dst.nameOffset = intern(resource.name);
+			dst.frame = resource.frame;
+			dst.firstCreate = resource.firstCreate;
+			dst.lastDestroy = resource.lastDestroy;
+			dst.readBegin = static_cast<uint32_t>(accesses.size());
+			dst.readCount = static_cast<uint32_t>(resource.readPasses.size());
+			accesses.insert(accesses.end(), resource.readPasses.begin(), resource.readPasses.end());
+			dst.writeBegin = static_cast<uint32_t>(accesses.size());
+			dst.writeCount = static_cast<uint32_t>(resource.writedPasses.size());
+			accesses.insert(accesses.end(), resource.writedPasses.begin(), resource.writedPasses.end());
+			dst.barrierBegin = static_cast<uint32_t>(barriers.size());
+			dst.barrierCount = static_cast<uint32_t>(resource.barriers.size());
+			dst.size = resource.size;
+			dst.alignment = resource.alignment;
+			dst.heapType = resource.heapType;
+			for (const auto& barrier : resource.barriers) {
+				CaptureBarrier encoded;
+				std::memset(&encoded, 0, sizeof(encoded));
+				encoded.submitPass = barrier.submitPass;
+				encoded.descOffset = intern(barrier.description);
+				encoded.flags = barrier.flags;
+				encoded.stateBefore = barrier.stateBefore;
+				encoded.stateAfter = barrier.stateAfter;
+				barriers.push_back(encoded);
+			}
+			resources.push_back(dst);
+		}
+		header.passCount = static_cast<uint32_t>(passes.size());
+		header.fenceCount = static_cast<uint32_t>(fences.size());
+		header.accessCount = static_cast<uint32_t>(accesses.size());
+		header.barrierCount = static_cast<uint32_t>(barriers.size());
+
+		/** 计算各个表的位置 */
+		uint64_t offset = sizeof(CaptureHeader);
+		auto place = [&offset](uint64_t& tableOffset, uint64_t tableSize) {
+			tableOffset = offset;
+			offset = alignUp(offset + tableSize);
+		};
+		header.stringTableSize = strings.size();
+		place(header.stringTableOffset, strings.size());
+		place(header.queueTableOffset, queues.size() * sizeof(uint32_t));
+		place(header.passTableOffset, passes.size() * sizeof(CapturePass));
+		place(header.fenceOffsetTableOffset, fenceOffsets.size() * sizeof(uint32_t));
+		place(header.fenceTableOffset, fences.size() * sizeof(PassLocate));
+		place(header.resourceTableOffset, resources.size() * sizeof(CaptureResource));
+		place(header.accessTableOffset, accesses.size() * sizeof(PassLocate));
+		place(header.barrierTableOffset, barriers.size() * sizeof(CaptureBarrier));
+		header.totalSize = offset;
+
+		capture.assign(static_cast<size_t>(offset), 0);
+		auto copy = [&capture](uint64_t tableOffset, const void* data, size_t size) {
+			if (size) std::memcpy(capture.data() + tableOffset, data, size);
+		};
+		copy(0, &header, sizeof(header));
+		copy(header.stringTableOffset, strings.data(), strings.size());
+		copy(header.queueTableOffset, queues.data(), queues.size() * sizeof(uint32_t));
+		copy(header.passTableOffset, passes.data(), passes.size() * sizeof(CapturePass));
+		copy(header.fenceOffsetTableOffset, fenceOffsets.data(), fenceOffsets.size() * sizeof(uint32_t));
+		copy(header.fenceTableOffset, fences.data(), fences.size() * sizeof(PassLocate));
+		copy(header.resourceTableOffset, resources.data(), resources.size() * sizeof(CaptureResource));
+		copy(header.accessTableOffset, accesses.data(), accesses.size() * sizeof(PassLocate));
+		copy(header.barrierTableOffset, barriers.data(), barriers.size() * sizeof(CaptureBarrier));
+	}
+
+	bool SaveCapture(const PipelineGraph& graph, const char* path)
+	{
+		std::vector<uint8_t> capture;
+		SerializeCapture(graph.GetPassMap(), graph.GetResourceMap(), capture);
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file) return false;
+		bool succeed = std::fwrite(capture.data(), 1, capture.size(), file) == capture.size();
+		succeed = (std::fclose(file) == 0) && succeed;
+		return succeed;
+	}
+
+	bool LoadCapture(const char* path, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error)
+	{
+		MappedFile file;
+		if (!file.Open(path)) {
+			if (error) *error = std::string("cannot map ") + path;
+			return false;
+		}
+		CaptureView view;
+		if (!view.Parse(file.Data(), file.Size(), error)) return false;
+		view.BuildGraph(passMap, resMap);
+		return true;
+	}
+
+}
@@ -0,0 +1,180 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "ppfg.h"
+
+/** 二进制capture格式，布局与PipelineGraph内部的数组一一对应，可以直接mmap后使用
+ * 所有数值均为小端序，各个表的起始位置按8字节对齐:
+ *   CaptureHeader
+ *   字符串表: 以'\0'结尾的字符串依次排列，名称以其在表中的偏移引用
+ *   queue表: uint32_t[queueCount + 1]，queue i的pass为pass表中[queue[i], queue[i+1])
+ *   pass表: CapturePass[passCount]，按queue以及queue内的索引排列
+ *   fence偏移表: uint32_t[passCount + 1]，pass i等待的pass为fence表中[fenceOffset[i], fenceOffset[i+1]) (CSR)
+ *   fence表: PassLocate[fenceCount]
+ *   资源表: CaptureResource[resourceCount]
+ *   访问表: PassLocate[accessCount]，资源的读写pass
+ *   barrier表: CaptureBarrier[barrierCount]
+ * 各个表的记录大小保存在header中，新版本只会在记录末尾追加字段 */
+namespace PipelineProfilingGraph {
+
+	const uint32_t CAPTURE_MAGIC = 0x47465050U; /**< "PPFG" */
+	const uint32_t CAPTURE_VERSION = 1;
+
+	struct CaptureHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t queueCount;
+		uint32_t passCount;
+		uint32_t fenceCount;
+		uint32_t resourceCount;
+		uint32_t accessCount;
+		uint32_t barrierCount;
+		uint32_t passStride; /**< CapturePass的大小 */
+		uint32_t resourceStride; /**< CaptureResource的大小 */
+		uint32_t barrierStride; /**< CaptureBarrier的大小 */
+		uint32_t frameCount; /**< 帧的数量，所有pass的帧索引都小于该值 */
+		uint64_t totalSize; /**< 整个capture的大小 */
+		uint64_t stringTableOffset;
+		uint64_t stringTableSize;
+		uint64_t queueTableOffset;
+		uint64_t passTableOffset;
+		uint64_t fenceOffsetTableOffset;
+		uint64_t fenceTableOffset;
+		uint64_t resourceTableOffset;
+		uint64_t accessTableOffset;
+		uint64_t barrierTableOffset;
+	};
+
+	struct CapturePass {
+		uint32_t nameOffset; /**< 名称在字符串表中的偏移 */
+		FrameIdx frame; /**< 该pass所属的帧 */
+		uint64_t startTime; /**< 见Pass::startTime */
+		uint64_t endTime; /**< 见Pass::endTime */
+	};
+
+	struct CaptureResource {
+		uint32_t nameOffset; /**< 名称在字符串表中的偏移 */
+		FrameIdx frame; /**< 该资源所属的帧 */
+		PassLocate firstCreate;
+		PassLocate lastDestroy;
+		uint32_t readBegin; /**< 读取该资源的pass在访问表中的起始位置 */
+		uint32_t readCount;
+		uint32_t writeBegin; /**< 写入该资源的pass在访问表中的起始位置 */
+		uint32_t writeCount;
+		uint32_t barrierBegin; /**< 该资源的barrier在barrier表中的起始位置 */
+		uint32_t barrierCount;
+		uint64_t size; /**< 见Resource::size */
+		uint32_t alignment; /**< 见Resource::alignment */
+		uint8_t heapType; /**< 见HeapType */
+		uint8_t padding[3];
+	};
+
+	struct CaptureBarrier {
+		PassLocate submitPass;
+		uint32_t descOffset; /**< 描述在字符串表中的偏移 */
+		uint8_t flags; /**< 见Barrier::Flag */
+		uint8_t padding[3];
+		uint16_t stateBefore; /**< 见ResourceState */
+		uint16_t stateAfter; /**< 见ResourceState */
+		uint32_t reserved;
+	};
+
+	/** 只读的文件映射 */
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		/** 映射整个文件
+		 * @return 是否映射成功 */
+		bool Open(const char* path);
+		void Close();
+		const void* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+	private:
+		const void* m_data; /**< 映射的起始位置 */
+		size_t m_size; /**< 映射的大小 */
+#ifdef _WIN32
+		void* m_file; /**< 文件句柄 */
+		void* m_mapping; /**< 映射对象的句柄 */
+#endif
+	};
+
+	/** 直接在capture的内存上访问其中的各个表，不做任何拷贝
+	 * @remark CaptureView不持有内存，使用期间必须保证内存有效 */
+	class CaptureView {
+	public:
+		CaptureView() : m_data(nullptr), m_header(nullptr) {}
+		/** 检查并解析capture，索引越界、帧索引无效或者fence之间存在环时失败
+		 * @param data capture的起始位置，需要8字节对齐
+		 * @param size capture的大小
+		 * @param error 解析失败时的错误信息，可以为空
+		 * @return 是否解析成功 */
+		bool Parse(const void* data, size_t size, std::string* error = nullptr);
+
+		const CaptureHeader& Header() const { return *m_header; }
+		uint32_t QueueCount() const { return m_header->queueCount; }
+		/** 某个queue中pass的数量 */
+		uint32_t PassCount(QueueIdx queIdx) const { return m_queues[queIdx + 1] - m_queues[queIdx]; }
+		const CapturePass& GetPass(const PassLocate& locate) const {
+			return record<CapturePass>(m_header->passTableOffset, m_header->passStride,
+				m_queues[locate.queueIndex] + locate.inqueueIndex);
+		}
+		const char* PassName(const PassLocate& locate) const { return String(GetPass(locate).nameOffset); }
+		/** 某个pass等待的所有pass
+		 * @param count 返回等待的pass的数量
+		 * @return 指向fence表中的第一个pass */
+		const PassLocate* PassFences(const PassLocate& locate, uint32_t& count) const {
+			uint32_t passIdx = m_queues[locate.queueIndex] + locate.inqueueIndex;
+			count = m_fenceOffsets[passIdx + 1] - m_fenceOffsets[passIdx];
+			return m_fences + m_fenceOffsets[passIdx];
+		}
+		uint32_t ResourceCount() const { return m_header->resourceCount; }
+		const CaptureResource& GetResource(ResourceIdx resIdx) const {
+			return record<CaptureResource>(m_header->resourceTableOffset, m_header->resourceStride, resIdx);
+		}
+		/** 访问表中的第index个pass位置 */
+		const PassLocate* Accesses(uint32_t index) const { return m_accesses + index; }
+		const CaptureBarrier& GetBarrier(uint32_t index) const {
+			return record<CaptureBarrier>(m_header->barrierTableOffset, m_header->barrierStride, index);
+		}
+		const char* String(uint32_t offset) const {
+			return reinterpret_cast<const char*>(m_data + m_header->stringTableOffset) + offset;
+		}
+
+		/** 根据capture构建渲染图的输入
+		 * @remark 名称需要保存在std::string中，边表以整段的方式拷贝到各个vector中 */
+		void BuildGraph(std::vector<Queue>& passMap, std::vector<Resource>& resMap) const;
+	private:
+		template<typename T>
+		const T& record(uint64_t tableOffset, uint32_t stride, uint32_t index) const {
+			return *reinterpret_cast<const T*>(m_data + tableOffset + static_cast<uint64_t>(stride) * index);
+		}
+	private:
+		const uint8_t* m_data; /**< capture的起始位置 */
+		const CaptureHeader* m_header;
+		const uint32_t* m_queues; /**< queue表 */
+		const uint32_t* m_fenceOffsets; /**< fence偏移表 */
+		const PassLocate* m_fences; /**< fence表 */
+		const PassLocate* m_accesses; /**< 访问表 */
+	};
+
+	/** 将渲染图的输入编码为capture
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param capture 编码结果，原有内容会被替换 */
+	void SerializeCapture(const std::vector<Queue>& passMap,
+		const std::vector<Resource>& resMap, std::vector<uint8_t>& capture);
+	/** 将渲染图保存为capture文件
+	 * @return 是否保存成功 */
+	bool SaveCapture(const PipelineGraph& graph, const char* path);
+	/** 映射capture文件并读取渲染图的输入
+	 * @param error 读取失败时的错误信息，可以为空
+	 * @return 是否读取成功 */
+	bool LoadCapture(const char* path, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error = nullptr);
+
+}
+
+#endif // CAPTURE_H
@@ -0,0 +1,212 @@
+#include "captureStream.h"
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+		const uint64_t FRAME_ALIGNMENT = 8;
+		const uint8_t PADDING[FRAME_ALIGNMENT] = { 0 };
+
+		/** 获取文件从当前位置到末尾的字节数，读写位置保持不变 */
+		bool remainingFileSize(std::FILE* file, uint64_t& size) {
+#ifdef _WIN32
+			__int64 current = _ftelli64(file);
+			if (current < 0 || _fseeki64(file, 0, SEEK_END) != 0) return false;
+			__int64 end = _ftelli64(file);
+			bool succeed = _fseeki64(file, current, SEEK_SET) == 0;
+#else
+			off_t current = ftello(file);
+			if (current < 0 || fseeko(file, 0, SEEK_END) != 0) return false;
+			off_t end = ftello(file);
+			bool succeed = fseeko(file, current, SEEK_SET) == 0;
+#endif
+			if (!succeed || end < current) return false;
+			size = static_cast<uint64_t>(end - current);
+			return true;
+		}
+	}
+
+	bool IsCaptureStream(const char* path)
+	{
+		std::FILE* file = std::fopen(path, "rb");
+		if (!file) return false;
+		CaptureStreamHeader header;
+		bool isStream = std::fread(&header, sizeof(header), 1, file) == 1
+			&& header.magic == CAPTURE_STREAM_MAGIC;
+		std::fclose(file);
+		return isStream;
+	}
+
+	bool CaptureStreamWriter::Open(const char* path)
+	{
+		Close();
+		m_file = std::fopen(path, "wb");
+		if (!m_file) return false;
+		CaptureStreamHeader header = { CAPTURE_STREAM_MAGIC, CAPTURE_STREAM_VERSION };
+		m_frameCount = 0;
+		return std::fwrite(&header, sizeof(header), 1, m_file) == 1;
+	}
+
+	bool CaptureStreamWriter::Append(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap)
+	{
+		if (!m_file) return false;
+		SerializeCapture(passMap, resMap, m_buffer);
+		uint64_t size = m_buffer.size();
+		size_t padding = static_cast<size_t>((FRAME_ALIGNMENT - size % FRAME_ALIGNMENT) % FRAME_ALIGNMENT);
+		bool succeed = std::fwrite(&size, sizeof(size), 1, m_file) == 1
+			&& std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size()
+			&& std::fwrite(PADDING, 1, padding, m_file) == padding;
+		if (succeed) ++m_frameCount;
+		return succeed;
+	}
+
+	bool CaptureStreamWriter::Close()
+	{
+		if (!m_file) return true;
+		bool succeed = std::fclose(m_file) == 0;
+		m_file = nullptr;
+		return succeed;
+	}
+
+	CaptureStreamReader::CaptureStreamReader()
+		: m_file(nullptr), m_readSlot(0), m_endOfStream(false), m_stop(false), m_frameCount(0),
+		m_remainingSize(0), m_maxFrameSize(DEFAULT_MAX_STREAM_FRAME_SIZE)
+	{
+		for (uint32_t slot = 0; slot < SLOT_COUNT; ++slot)
+			m_states[slot] = SLOT_EMPTY;
+	}
+
+	bool CaptureStreamReader::Open(const char* path, std::string* error)
+	{
+		Close();
+		m_file = std::fopen(path, "rb");
+		if (!m_file) {
+			if (error) *error = std::string("cannot open ") + path;
+			return false;
+		}
+		CaptureStreamHeader header;
+		if (std::fread(&header, sizeof(header), 1, m_file) != 1 || header.magic != CAPTURE_STREAM_MAGIC
+			|| header.version == 0 || header.version > CAPTURE_STREAM_VERSION) {
+			if (error) *error = std::string(path) + " is not a capture stream";
+			std::fclose(m_file);
+			m_file = nullptr;
+			return false;
+		}
+		if (!remainingFileSize(m_file, m_remainingSize)) {
+			if (error) *error = std::string("cannot read ") + path;
+			std::fclose(m_file);
+			m_file = nullptr;
+			return false;
+		}
+		for (uint32_t slot = 0; slot < SLOT_COUNT; ++slot)
+			m_states[slot] = SLOT_EMPTY;
+		m_readSlot = 0;
+		m_endOfStream = false;
+		m_stop = false;
+		m_error.clear();
+		m_frameCount = 0;
+		m_thread = std::thread(&CaptureStreamReader::readAhead, this);
+		return true;
+	}
+
+	void CaptureStreamReader::readAhead()
+	{
+		uint32_t slot = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond.wait(lock, [this, slot]() { return m_stop || m_states[slot] == SLOT_EMPTY; });
+				if (m_stop) return;
+			}
+			/** 缓冲为空时只有预读线程会访问它，因此读取过程不需要持有锁 */
+			std::vector<uint8_t>& buffer = m_slots[slot];
+			uint64_t size = 0;
+			std::string error;
+			bool endOfStream = false;
+			if (std::fread(&size, sizeof(size), 1, m_file) != 1) {
+				endOfStream = true;
+				if (std::ferror(m_file)) error = "read error";
+			}
+			else {
+				m_remainingSize -= std::min<uint64_t>(sizeof(size), m_remainingSize);
+				/** 分配之前先检查大小，损坏的大小不会导致巨大的分配 */
+				if (size > m_remainingSize || size > m_maxFrameSize) {
+					endOfStream = true;
+					error = "corrupt frame size";
+				}
+			}
+			if (!endOfStream) {
+				uint64_t paddedSize = (size + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+				m_remainingSize -= std::min(paddedSize, m_remainingSize);
+				buffer.resize(static_cast<size_t>(paddedSize));
+				if (std::fread(buffer.data(), 1, buffer.size(), m_file) != buffer.size()) {
+					endOfStream = true;
+					error = "truncated frame";
+				}
+				buffer.resize(static_cast<size_t>(size));
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (endOfStream) {
+					m_endOfStream = true;
+					m_error = error;
+				}
+				else {
+					m_states[slot] = SLOT_FULL;
+				}
+			}
+			m_cond.notify_all();
+			if (endOfStream) return;
+			slot = (slot + 1) % SLOT_COUNT;
+		}
+	}
+
+	bool CaptureStreamReader::Next(PipelineGraph& graph, std::string* error)
+	{
+		if (!m_file) return false;
+		uint32_t slot = m_readSlot;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this, slot]() { return m_states[slot] == SLOT_FULL || m_endOfStream; });
+			if (m_states[slot] != SLOT_FULL) {
+				if (error && !m_error.empty()) *error = m_error;
+				return false;
+			}
+		}
+		/** 缓冲已满时只有当前线程会访问它，解码的同时预读线程填充另一个缓冲 */
+		CaptureView view;
+		bool succeed = view.Parse(m_slots[slot].data(), m_slots[slot].size(), error);
+		if (succeed) {
+			view.BuildGraph(m_passMap, m_resMap);
+			graph.Reset(m_passMap, m_resMap);
+			++m_frameCount;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_states[slot] = SLOT_EMPTY;
+		}
+		m_cond.notify_all();
+		m_readSlot = (slot + 1) % SLOT_COUNT;
+		return succeed;
+	}
+
+	void CaptureStreamReader::Close()
+	{
+		if (m_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cond.notify_all();
+			m_thread.join();
+		}
+		if (m_file) {
+			std::fclose(m_file);
+			m_file = nullptr;
+		}
+	}
+
+}
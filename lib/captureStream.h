@@ -0,0 +1,103 @@
+#ifndef CAPTURE_STREAM_H
+#define CAPTURE_STREAM_H
+
+#include "capture.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+/** 多帧的capture流文件，格式为:
+ *   CaptureStreamHeader
+ *   若干帧，每一帧为: uint64_t size，紧跟size字节的capture(见capture.h)，按8字节对齐补齐
+ * 读取时每次只在内存中保留一帧，读取下一帧的I/O与当前帧的解码同时进行 */
+namespace PipelineProfilingGraph {
+
+	const uint32_t CAPTURE_STREAM_MAGIC = 0x53465050U; /**< "PPFS" */
+	const uint32_t CAPTURE_STREAM_VERSION = 1;
+	/** 读取时默认允许的单帧capture的最大字节数 */
+	const uint64_t DEFAULT_MAX_STREAM_FRAME_SIZE = 1ULL << 30;
+
+	struct CaptureStreamHeader {
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	/** 判断某个文件是否是capture流 */
+	bool IsCaptureStream(const char* path);
+
+	class CaptureStreamWriter {
+	public:
+		CaptureStreamWriter() : m_file(nullptr), m_frameCount(0) {}
+		~CaptureStreamWriter() { Close(); }
+		CaptureStreamWriter(const CaptureStreamWriter&) = delete;
+		CaptureStreamWriter& operator=(const CaptureStreamWriter&) = delete;
+		/** 创建capture流文件，已有的文件会被覆盖 */
+		bool Open(const char* path);
+		/** 向流中追加一帧 */
+		bool Append(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap);
+		bool Append(const PipelineGraph& graph) {
+			return Append(graph.GetPassMap(), graph.GetResourceMap());
+		}
+		/** 关闭文件
+		 * @return 所有数据是否成功写入 */
+		bool Close();
+		uint64_t FrameCount() const { return m_frameCount; }
+	private:
+		std::FILE* m_file;
+		std::vector<uint8_t> m_buffer; /**< 编码用的缓冲，在帧之间复用 */
+		uint64_t m_frameCount;
+	};
+
+	class CaptureStreamReader {
+	public:
+		CaptureStreamReader();
+		~CaptureStreamReader() { Close(); }
+		CaptureStreamReader(const CaptureStreamReader&) = delete;
+		CaptureStreamReader& operator=(const CaptureStreamReader&) = delete;
+		/** 打开capture流文件，并开始预读第一帧
+		 * @param error 打开失败时的错误信息，可以为空 */
+		bool Open(const char* path, std::string* error = nullptr);
+		/** 读取下一帧到graph中
+		 * @param graph 用于接收该帧的图，图中原有的内容会被替换
+		 * @param error 读取失败时的错误信息，可以为空
+		 * @return 是否读到了新的一帧，读到文件末尾或者出错时返回false
+		 * @remark 读取后需要调用graph的Setup */
+		bool Next(PipelineGraph& graph, std::string* error = nullptr);
+		/** 停止预读并关闭文件 */
+		void Close();
+		/** 设置单帧capture的最大字节数，超过该值的帧视为损坏，预读的内存因此不会超过该值的两倍
+		 * @remark 需要在Open之前调用 */
+		void SetMaxFrameSize(uint64_t maxFrameSize) { m_maxFrameSize = maxFrameSize; }
+		/** 已经读取的帧的数量 */
+		uint64_t FrameCount() const { return m_frameCount; }
+	private:
+		/** 预读线程，交替填充两个缓冲 */
+		void readAhead();
+	private:
+		enum SlotState {
+			SLOT_EMPTY,
+			SLOT_FULL,
+		};
+		static const uint32_t SLOT_COUNT = 2;
+
+		std::FILE* m_file;
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_cond;
+		std::vector<uint8_t> m_slots[SLOT_COUNT]; /**< 预读的帧，大小只会增长到最大的一帧 */
+		SlotState m_states[SLOT_COUNT];
+		uint32_t m_readSlot; /**< 下一帧所在的缓冲 */
+		bool m_endOfStream; /**< 预读线程已经读到文件末尾 */
+		bool m_stop; /**< 通知预读线程退出 */
+		std::string m_error; /**< 预读线程遇到的错误 */
+		std::vector<Queue> m_passMap; /**< 与图交换的pass容器，在帧之间复用 */
+		std::vector<Resource> m_resMap; /**< 与图交换的资源容器，在帧之间复用 */
+		uint64_t m_frameCount;
+		uint64_t m_remainingSize; /**< 文件中尚未被预读线程读取的字节数 */
+		uint64_t m_maxFrameSize;
+	};
+
+}
+
+#endif // CAPTURE_STREAM_H
@@ -0,0 +1,113 @@
+#include "criticalPath.h"
+#include "passOrder.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	bool FindCriticalPath(const std::vector<Queue>& passMap, CriticalPathResult& result,
+		std::string* error)
+	{
+		result.path.clear();
+		result.length = 0;
+		result.timed = false;
+		result.untimedPasses = 0;
+		PassIndex index(passMap);
+		std::vector<uint32_t> order;
+		if (!TopologicalOrder(passMap, index, order, error)) return false;
+
+		/** 纳秒与pass的数量不能混在一起，只要有pass记录了时间，没有记录的pass就按0计算 */
+		const uint32_t passCount = index.PassCount();
+		std::vector<uint64_t> durations(passCount, 0);
+		for (uint32_t id = 0; id < passCount; ++id) {
+			PassLocate locate = index.ToLocate(id);
+			const Pass& pass = passMap[locate.queueIndex][locate.inqueueIndex];
+			if (pass.HasTiming()) {
+				durations[id] = pass.endTime - pass.startTime;
+				result.timed = true;
+			}
+			else {
+				++result.untimedPasses;
+			}
+		}
+		if (!result.timed) {
+			std::fill(durations.begin(), durations.end(), 1);
+			result.untimedPasses = 0;
+		}
+
+		/** 正向: 最早开始时间为所有前驱最早结束时间的最大值，同时记录决定该值的前驱 */
+		std::vector<uint64_t> earliest(passCount, 0);
+		std::vector<uint32_t> criticalPred(passCount, INVALID_INDEX);
+		uint32_t last = INVALID_INDEX;
+		for (uint32_t id : order) {
+			PassLocate locate = index.ToLocate(id);
+			auto relax = [&](uint32_t pred) {
+				uint64_t finish = earliest[pred] + durations[pred];
+				if (criticalPred[id] == INVALID_INDEX || finish > earliest[id]) {
+					earliest[id] = finish;
+					criticalPred[id] = pred;
+				}
+			};
+			if (locate.inqueueIndex != 0) relax(id - 1);
+			for (const auto& signal : passMap[locate.queueIndex][locate.inqueueIndex].depPasses)
+				relax(index.ToId(signal));
+			uint64_t finish = earliest[id] + durations[id];
+			if (last == INVALID_INDEX || finish > result.length) {
+				result.length = finish;
+				last = id;
+			}
+		}
+
+		/** 逆向: 最晚结束时间为所有后继最晚开始时间的最小值，没有后继时为路径长度 */
+		std::vector<uint64_t> latestFinish(passCount, result.length);
+		for (size_t orderIdx = order.size(); orderIdx-- > 0;) {
+			uint32_t id = order[orderIdx];
+			PassLocate locate = index.ToLocate(id);
+			uint64_t latestStart = latestFinish[id] - durations[id];
+			if (locate.inqueueIndex != 0 && latestStart < latestFinish[id - 1])
+				latestFinish[id - 1] = latestStart;
+			for (const auto& signal : passMap[locate.queueIndex][locate.inqueueIndex].depPasses) {
+				uint32_t signalId = index.ToId(signal);
+				if (latestStart < latestFinish[signalId]) latestFinish[signalId] = latestStart;
+			}
+		}
+
+		result.earliestStart.resize(passMap.size());
+		result.slack.resize(passMap.size());
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			uint32_t begin = index.QueueBegin(queIdx), end = index.QueueEnd(queIdx);
+			result.earliestStart[queIdx].assign(earliest.begin() + begin, earliest.begin() + end);
+			result.slack[queIdx].resize(end - begin);
+			for (uint32_t id = begin; id < end; ++id)
+				result.slack[queIdx][id - begin] = latestFinish[id] - durations[id] - earliest[id];
+		}
+		for (uint32_t id = last; id != INVALID_INDEX; id = criticalPred[id])
+			result.path.push_back(index.ToLocate(id));
+		std::reverse(result.path.begin(), result.path.end());
+		return true;
+	}
+
+	void HighlightCriticalPath(PipelineGraph& graph, const CriticalPathResult& result)
+	{
+		const auto& passMap = graph.GetPassMap();
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx) {
+				uint64_t slack = result.slack[queIdx][passIdx];
+				if (slack != 0) graph.MarkPass({ queIdx, passIdx }, 0, "slack " + std::to_string(slack));
+			}
+		}
+		for (size_t pathIdx = 0; pathIdx < result.path.size(); ++pathIdx) {
+			const PassLocate& pass = result.path[pathIdx];
+			graph.MarkPass(pass, Rectangle::HIGHLIGHT, "critical path");
+			if (pathIdx == 0) continue;
+			/** 路径上相邻的两个pass不在同一queue上时，两者之间一定是fence */
+			const PassLocate& prev = result.path[pathIdx - 1];
+			if (prev.queueIndex == pass.queueIndex) continue;
+			Arrow arrow = graph.GetFenceArrow(prev, pass);
+			arrow.type = Arrow::CRITICAL;
+			arrow.desc = "critical path: " + passMap[prev.queueIndex][prev.inqueueIndex].name
+				+ " -> " + passMap[pass.queueIndex][pass.inqueueIndex].name;
+			graph.AddOverlay(arrow);
+		}
+	}
+
+}
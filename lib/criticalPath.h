@@ -0,0 +1,35 @@
+#ifndef CRITICAL_PATH_H
+#define CRITICAL_PATH_H
+
+#include "ppfg.h"
+
+/** 关键路径分析
+ * pass依赖于同一queue上的前一个pass以及其fence等待的pass，在这个DAG上按拓扑序计算每个pass的最早开始时间，
+ * 再按逆拓扑序计算最晚开始时间，两者之差即松弛时间；松弛时间为0的pass位于关键路径上
+ * 路径长度只包含pass的持续时间，不包含pass之间的空闲；所有pass都没有记录时间时每个pass的持续时间为1，
+ * 路径长度即pass的数量，否则以纳秒为单位，没有记录时间的pass的持续时间为0 */
+namespace PipelineProfilingGraph {
+
+	struct CriticalPathResult {
+		std::vector<PassLocate> path; /**< 关键路径上的pass，按执行的先后排列 */
+		uint64_t length; /**< 关键路径的长度，即整个图在依赖约束下的最短执行时间 */
+		bool timed; /**< 是否有pass记录了时间，为true时长度与时间的单位为纳秒，否则为pass的数量 */
+		uint32_t untimedPasses; /**< timed为true时没有记录时间、按持续时间0计算的pass的数量 */
+		std::vector< std::vector<uint64_t> > earliestStart; /**< 每个pass的最早开始时间，与passMap的形状相同 */
+		std::vector< std::vector<uint64_t> > slack; /**< 每个pass的松弛时间，与passMap的形状相同 */
+	};
+
+	/** 计算关键路径
+	 * @param passMap 渲染图中所有的pass
+	 * @param result 计算的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return fence引用了未知的pass或者fence之间存在环时返回false */
+	bool FindCriticalPath(const std::vector<Queue>& passMap, CriticalPathResult& result,
+		std::string* error = nullptr);
+	/** 在图中突出显示关键路径上的pass以及路径经过的fence，其余pass的描述中加入其松弛时间
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightCriticalPath(PipelineGraph& graph, const CriticalPathResult& result);
+
+}
+
+#endif // CRITICAL_PATH_H
@@ -0,0 +1,365 @@
+#include "fenceInference.h"
+#include "passOrder.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 以CSR方式存储的依赖，pass i等待的pass为sources中[offsets[i], offsets[i+1]) */
+		struct IncomingEdges {
+			std::vector<uint32_t> offsets;
+			std::vector<uint32_t> sources;
+		};
+
+		/** 按拓扑序计算每个pass的vector clock，同时标记不能由其他依赖推出的依赖
+		 * clock中第q项为queue q上能到达该pass的最后一个pass的索引加1，0表示没有
+		 * @param order 同时满足queue内顺序与edges的拓扑序
+		 * @param kept 每条依赖是否需要保留 */
+		void reduceTransitively(const PassIndex& index, const std::vector<uint32_t>& order,
+			const IncomingEdges& edges, std::vector<uint8_t>& kept, std::vector<uint32_t>& clocks)
+		{
+			const uint32_t queueCount = index.QueueCount();
+			clocks.assign(static_cast<size_t>(index.PassCount()) * queueCount, 0);
+			kept.assign(edges.sources.size(), 0);
+			/** 每个queue上只需要保留索引最大的依赖，candidates记录其在edges中的位置 */
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> candidateOfQueue(queueCount, INVALID_INDEX);
+			for (uint32_t id : order) {
+				PassLocate locate = index.ToLocate(id);
+				uint32_t* clock = clocks.data() + static_cast<size_t>(id) * queueCount;
+				if (locate.inqueueIndex != 0)
+					std::copy(clock - queueCount, clock, clock);
+
+				candidates.clear();
+				for (uint32_t edgeIdx = edges.offsets[id]; edgeIdx < edges.offsets[id + 1]; ++edgeIdx) {
+					PassLocate signal = index.ToLocate(edges.sources[edgeIdx]);
+					/** 同一queue上的依赖以及前一个pass已经能到达的依赖都可以由queue内的顺序推出 */
+					if (signal.queueIndex == locate.queueIndex || clock[signal.queueIndex] > signal.inqueueIndex)
+						continue;
+					uint32_t& slot = candidateOfQueue[signal.queueIndex];
+					if (slot == INVALID_INDEX) {
+						slot = static_cast<uint32_t>(candidates.size());
+						candidates.push_back(edgeIdx);
+					}
+					else if (edges.sources[candidates[slot]] < edges.sources[edgeIdx]) {
+						candidates[slot] = edgeIdx;
+					}
+				}
+				for (uint32_t edgeIdx : candidates)
+					candidateOfQueue[index.ToLocate(edges.sources[edgeIdx]).queueIndex] = INVALID_INDEX;
+
+				/** 能被其他候选依赖到达的依赖是多余的，图中无环，两个候选不会相互到达 */
+				for (uint32_t edgeIdx : candidates) {
+					PassLocate signal = index.ToLocate(edges.sources[edgeIdx]);
+					bool implied = false;
+					for (uint32_t otherIdx : candidates) {
+						const uint32_t* other = clocks.data() + static_cast<size_t>(edges.sources[otherIdx]) * queueCount;
+						if (otherIdx != edgeIdx && other[signal.queueIndex] > signal.inqueueIndex) {
+							implied = true;
+							break;
+						}
+					}
+					if (implied) continue;
+					kept[edgeIdx] = 1;
+					const uint32_t* source = clocks.data() + static_cast<size_t>(edges.sources[edgeIdx]) * queueCount;
+					for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx)
+						clock[queIdx] = std::max(clock[queIdx], source[queIdx]);
+				}
+				clock[locate.queueIndex] = locate.inqueueIndex + 1;
+			}
+		}
+
+		/** 逐个去掉输入中的fence，并检查输入是否仍然保证最少集合中的依赖
+		 * 去掉fence后只从等待方开始沿queue内的顺序与fence按拓扑序重新计算vector clock，
+		 * clock不变的pass不会继续传播，因此代价只与受影响的pass数量有关 */
+		class FenceRemoval {
+		public:
+			/** @param minimal 最少集合中的(wait, signal)，按wait有序 */
+			FenceRemoval(const PassIndex& index, const std::vector<uint32_t>& ranks, const IncomingEdges& edges,
+				const std::vector<uint32_t>& clocks, const std::vector< std::pair<uint32_t, uint32_t> >& minimal)
+				: m_index(index), m_ranks(ranks), m_edges(edges), m_minimal(minimal), m_clocks(clocks),
+				m_removed(edges.sources.size(), 0), m_queued(index.PassCount(), 0), m_clock(index.QueueCount()) {
+				/** 由等待方的CSR得到每个pass的fence接收方 */
+				m_outOffsets.assign(index.PassCount() + 1, 0);
+				for (uint32_t source : edges.sources)
+					++m_outOffsets[source + 1];
+				for (uint32_t id = 0; id < index.PassCount(); ++id)
+					m_outOffsets[id + 1] += m_outOffsets[id];
+				m_outTargets.resize(edges.sources.size());
+				std::vector<uint32_t> cursor(m_outOffsets.begin(), m_outOffsets.end() - 1);
+				for (uint32_t wait = 0; wait < index.PassCount(); ++wait)
+					for (uint32_t edgeIdx = edges.offsets[wait]; edgeIdx < edges.offsets[wait + 1]; ++edgeIdx)
+						m_outTargets[cursor[edges.sources[edgeIdx]]++] = wait;
+			}
+
+			/** 去掉一个能由其他fence推出的fence，不影响任何clock */
+			void RemoveImplied(uint32_t edgeIdx) { m_removed[edgeIdx] = 1; }
+			/** 尝试去掉wait上的某个fence，输入不再保证最少集合中的某个依赖时恢复该fence
+			 * @param replacement 恢复时为失去保证的依赖
+			 * @return 是否去掉了该fence */
+			bool TryRemove(uint32_t wait, uint32_t edgeIdx, FenceEdge& replacement) {
+				m_removed[edgeIdx] = 1;
+				propagate(wait);
+				bool lost = false;
+				for (const auto& change : m_changes) {
+					uint32_t id = change.first;
+					const uint32_t* before = m_saved.data() + static_cast<size_t>(change.second) * m_index.QueueCount();
+					auto found = std::lower_bound(m_minimal.begin(), m_minimal.end(), std::make_pair(id, 0U));
+					for (; !lost && found != m_minimal.end() && found->first == id; ++found) {
+						PassLocate signal = m_index.ToLocate(found->second);
+						if (before[signal.queueIndex] > signal.inqueueIndex && clock(id)[signal.queueIndex] <= signal.inqueueIndex) {
+							replacement = { signal, m_index.ToLocate(id) };
+							lost = true;
+						}
+					}
+					if (lost) break;
+				}
+				if (!lost) return true;
+				m_removed[edgeIdx] = 0;
+				for (const auto& change : m_changes) {
+					const uint32_t* before = m_saved.data() + static_cast<size_t>(change.second) * m_index.QueueCount();
+					std::copy(before, before + m_index.QueueCount(), clock(change.first));
+				}
+				return false;
+			}
+		private:
+			uint32_t* clock(uint32_t id) { return m_clocks.data() + static_cast<size_t>(id) * m_index.QueueCount(); }
+			/** 从start开始重新计算clock，变化的pass及其原来的clock记录在m_changes与m_saved中 */
+			void propagate(uint32_t start) {
+				const uint32_t queueCount = m_index.QueueCount();
+				m_changes.clear();
+				m_saved.clear();
+				auto later = [this](uint32_t lhs, uint32_t rhs) { return m_ranks[lhs] > m_ranks[rhs]; };
+				auto enqueue = [this, &later](uint32_t id) {
+					if (m_queued[id]) return;
+					m_queued[id] = 1;
+					m_pending.push_back(id);
+					std::push_heap(m_pending.begin(), m_pending.end(), later);
+				};
+				enqueue(start);
+				while (!m_pending.empty()) {
+					std::pop_heap(m_pending.begin(), m_pending.end(), later);
+					uint32_t id = m_pending.back();
+					m_pending.pop_back();
+					m_queued[id] = 0;
+					PassLocate locate = m_index.ToLocate(id);
+					uint32_t* current = clock(id);
+					if (locate.inqueueIndex != 0)
+						std::copy(current - queueCount, current, m_clock.begin());
+					else
+						std::fill(m_clock.begin(), m_clock.end(), 0);
+					for (uint32_t edgeIdx = m_edges.offsets[id]; edgeIdx < m_edges.offsets[id + 1]; ++edgeIdx) {
+						if (m_removed[edgeIdx]) continue;
+						const uint32_t* source = clock(m_edges.sources[edgeIdx]);
+						for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx)
+							m_clock[queIdx] = std::max(m_clock[queIdx], source[queIdx]);
+					}
+					m_clock[locate.queueIndex] = locate.inqueueIndex + 1;
+					if (std::equal(m_clock.begin(), m_clock.end(), current)) continue;
+					m_changes.push_back(std::make_pair(id, static_cast<uint32_t>(m_changes.size())));
+					m_saved.insert(m_saved.end(), current, current + queueCount);
+					std::copy(m_clock.begin(), m_clock.end(), current);
+					if (id + 1 < m_index.QueueEnd(locate.queueIndex)) enqueue(id + 1);
+					for (uint32_t outIdx = m_outOffsets[id]; outIdx < m_outOffsets[id + 1]; ++outIdx)
+						enqueue(m_outTargets[outIdx]);
+				}
+			}
+		private:
+			const PassIndex& m_index;
+			const std::vector<uint32_t>& m_ranks;
+			const IncomingEdges& m_edges;
+			const std::vector< std::pair<uint32_t, uint32_t> >& m_minimal;
+			std::vector<uint32_t> m_clocks; /**< 去掉已经去掉的fence之后的vector clock */
+			std::vector<uint8_t> m_removed; /**< 每条依赖是否已经去掉 */
+			std::vector<uint32_t> m_outOffsets;
+			std::vector<uint32_t> m_outTargets;
+			std::vector<uint8_t> m_queued;
+			std::vector<uint32_t> m_pending; /**< 按拓扑序排列的小根堆 */
+			std::vector< std::pair<uint32_t, uint32_t> > m_changes; /**< 上一次传播中clock变化的pass，以及原来的clock在m_saved中的位置 */
+			std::vector<uint32_t> m_saved;
+			std::vector<uint32_t> m_clock;
+		};
+
+		/** 根据(wait, signal)对构建CSR，重复的依赖会被保留 */
+		void buildIncomingEdges(uint32_t passCount, std::vector< std::pair<uint32_t, uint32_t> >& pairs,
+			IncomingEdges& edges)
+		{
+			std::sort(pairs.begin(), pairs.end());
+			edges.offsets.assign(passCount + 1, 0);
+			edges.sources.resize(pairs.size());
+			for (size_t pairIdx = 0; pairIdx < pairs.size(); ++pairIdx) {
+				++edges.offsets[pairs[pairIdx].first + 1];
+				edges.sources[pairIdx] = pairs[pairIdx].second;
+			}
+			for (uint32_t id = 0; id < passCount; ++id)
+				edges.offsets[id + 1] += edges.offsets[id];
+		}
+
+		/** 资源访问之间的冲突，只记录不同queue之间的依赖 */
+		class HazardCollector {
+		public:
+			HazardCollector(const PassIndex& index, const std::vector<uint32_t>& ranks)
+				: m_index(index), m_ranks(ranks), m_readSinceWrite(index.QueueCount(), INVALID_INDEX) {}
+
+			bool Collect(const Resource& resource, std::vector< std::pair<uint32_t, uint32_t> >& hazards) {
+				m_accesses.clear();
+				for (const auto& read : resource.readPasses) {
+					if (!m_index.Contains(read)) return false;
+					m_accesses.push_back({ m_ranks[m_index.ToId(read)], m_index.ToId(read), false });
+				}
+				for (const auto& write : resource.writedPasses) {
+					if (!m_index.Contains(write)) return false;
+					m_accesses.push_back({ m_ranks[m_index.ToId(write)], m_index.ToId(write), true });
+				}
+				std::sort(m_accesses.begin(), m_accesses.end(), [](const Access& lhs, const Access& rhs) {
+					return lhs.rank != rhs.rank ? lhs.rank < rhs.rank : lhs.write > rhs.write;
+				});
+
+				uint32_t lastWrite = INVALID_INDEX;
+				uint32_t lastPass = INVALID_INDEX;
+				for (const Access& access : m_accesses) {
+					/** 同一个pass的多次访问按一次处理，写入排在前面 */
+					if (access.pass == lastPass) continue;
+					lastPass = access.pass;
+					QueueIdx queIdx = m_index.ToLocate(access.pass).queueIndex;
+					if (lastWrite != INVALID_INDEX && m_index.ToLocate(lastWrite).queueIndex != queIdx)
+						hazards.push_back(std::make_pair(access.pass, lastWrite));
+					if (!access.write) {
+						if (m_readSinceWrite[queIdx] == INVALID_INDEX) m_dirtyQueues.push_back(queIdx);
+						m_readSinceWrite[queIdx] = access.pass;
+						continue;
+					}
+					/** 每个queue上只需要依赖上一次写入之后的最后一次读取 */
+					for (QueueIdx readQueue : m_dirtyQueues) {
+						if (readQueue != queIdx)
+							hazards.push_back(std::make_pair(access.pass, m_readSinceWrite[readQueue]));
+						m_readSinceWrite[readQueue] = INVALID_INDEX;
+					}
+					m_dirtyQueues.clear();
+					lastWrite = access.pass;
+				}
+				for (QueueIdx readQueue : m_dirtyQueues)
+					m_readSinceWrite[readQueue] = INVALID_INDEX;
+				m_dirtyQueues.clear();
+				return true;
+			}
+		private:
+			struct Access {
+				uint32_t rank;
+				uint32_t pass;
+				bool write;
+			};
+			const PassIndex& m_index;
+			const std::vector<uint32_t>& m_ranks;
+			std::vector<Access> m_accesses;
+			std::vector<uint32_t> m_readSinceWrite; /**< 每个queue上一次写入之后的最后一次读取 */
+			std::vector<QueueIdx> m_dirtyQueues; /**< m_readSinceWrite中有效的queue */
+		};
+	}
+
+	bool InferFences(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		FenceInferenceResult& result, std::string* error)
+	{
+		result.minimalFences.clear();
+		result.redundantFences.clear();
+		result.missingFences.clear();
+		result.inputFenceCount = 0;
+
+		PassIndex index(passMap);
+		std::vector<uint32_t> order;
+		if (!TopologicalOrder(passMap, index, order, error)) return false;
+		const uint32_t passCount = index.PassCount();
+		const uint32_t queueCount = index.QueueCount();
+		std::vector<uint32_t> ranks(passCount);
+		for (uint32_t rank = 0; rank < passCount; ++rank)
+			ranks[order[rank]] = rank;
+
+		/** 输入中的fence自身的传递约简 */
+		std::vector< std::pair<uint32_t, uint32_t> > pairs;
+		for (const auto& queue : passMap) {
+			for (const auto& pass : queue) {
+				for (const auto& dep : pass.depPasses)
+					pairs.push_back(std::make_pair(index.ToId(pass.locate), index.ToId(dep)));
+				result.inputFenceCount += pass.depPasses.size();
+			}
+		}
+		IncomingEdges inputEdges;
+		buildIncomingEdges(passCount, pairs, inputEdges);
+		std::vector<uint8_t> inputKept;
+		std::vector<uint32_t> inputClocks;
+		reduceTransitively(index, order, inputEdges, inputKept, inputClocks);
+
+		/** 读写冲突的依赖总是从拓扑序靠前的pass指向靠后的pass，因此order同样是其拓扑序 */
+		pairs.clear();
+		HazardCollector collector(index, ranks);
+		for (const auto& resource : resMap) {
+			if (!collector.Collect(resource, pairs)) {
+				if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+		}
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+		IncomingEdges hazardEdges;
+		buildIncomingEdges(passCount, pairs, hazardEdges);
+		std::vector<uint8_t> hazardKept;
+		std::vector<uint32_t> hazardClocks;
+		reduceTransitively(index, order, hazardEdges, hazardKept, hazardClocks);
+
+		std::vector< std::pair<uint32_t, uint32_t> > minimal;
+		for (uint32_t wait = 0; wait < passCount; ++wait) {
+			for (uint32_t edgeIdx = hazardEdges.offsets[wait]; edgeIdx < hazardEdges.offsets[wait + 1]; ++edgeIdx) {
+				if (!hazardKept[edgeIdx]) continue;
+				uint32_t signal = hazardEdges.sources[edgeIdx];
+				minimal.push_back(std::make_pair(wait, signal));
+				FenceEdge fence = { index.ToLocate(signal), index.ToLocate(wait) };
+				result.minimalFences.push_back(fence);
+				const uint32_t* clock = inputClocks.data() + static_cast<size_t>(wait) * queueCount;
+				if (clock[fence.signal.queueIndex] <= fence.signal.inqueueIndex)
+					result.missingFences.push_back(fence);
+			}
+		}
+		/** minimal按(wait, signal)有序，可以直接二分查找 */
+		std::vector<uint32_t> redundantEdges;
+		for (uint32_t wait = 0; wait < passCount; ++wait) {
+			for (uint32_t edgeIdx = inputEdges.offsets[wait]; edgeIdx < inputEdges.offsets[wait + 1]; ++edgeIdx) {
+				uint32_t signal = inputEdges.sources[edgeIdx];
+				/** 同一个fence重复出现时只有第一个可能是必需的 */
+				bool duplicated = edgeIdx != inputEdges.offsets[wait] && inputEdges.sources[edgeIdx - 1] == signal;
+				if (!duplicated && std::binary_search(minimal.begin(), minimal.end(), std::make_pair(wait, signal)))
+					continue;
+				RedundantFence redundant;
+				redundant.fence = { index.ToLocate(signal), index.ToLocate(wait) };
+				redundant.reason = inputKept[edgeIdx] && !duplicated ? RedundantFence::UNNEEDED : RedundantFence::IMPLIED;
+				redundant.replacement = { INVALID_PASS_LOCATE, INVALID_PASS_LOCATE };
+				result.redundantFences.push_back(redundant);
+				redundantEdges.push_back(edgeIdx);
+			}
+		}
+		/** 不能被其他fence推出的fence可能是某个冲突唯一的保证：先去掉所有能推出的fence，再逐个尝试去掉其余的fence，
+		 * 去掉后输入不再保证最少集合中的某个依赖时保留该fence并标记为REPLACEABLE，
+		 * 因此所有IMPLIED与UNNEEDED的fence可以同时去掉 */
+		FenceRemoval removal(index, ranks, inputEdges, inputClocks, minimal);
+		for (size_t redundantIdx = 0; redundantIdx < redundantEdges.size(); ++redundantIdx)
+			if (result.redundantFences[redundantIdx].reason == RedundantFence::IMPLIED)
+				removal.RemoveImplied(redundantEdges[redundantIdx]);
+		for (size_t redundantIdx = 0; redundantIdx < redundantEdges.size(); ++redundantIdx) {
+			RedundantFence& redundant = result.redundantFences[redundantIdx];
+			if (redundant.reason == RedundantFence::UNNEEDED
+				&& !removal.TryRemove(index.ToId(redundant.fence.wait), redundantEdges[redundantIdx], redundant.replacement))
+				redundant.reason = RedundantFence::REPLACEABLE;
+		}
+		return true;
+	}
+
+	void ReplaceFences(std::vector<Queue>& passMap, const std::vector<FenceEdge>& fences)
+	{
+		for (auto& queue : passMap)
+			for (auto& pass : queue)
+				pass.depPasses.clear();
+		for (const auto& fence : fences)
+			passMap[fence.wait.queueIndex][fence.wait.inqueueIndex].depPasses.push_back(fence.signal);
+	}
+
+}
@@ -0,0 +1,49 @@
+#ifndef FENCE_INFERENCE_H
+#define FENCE_INFERENCE_H
+
+#include "ppfg.h"
+
+/** 根据资源的读写推导queue之间必需的fence
+ * 资源的访问按输入图的拓扑序排列，不同queue上的写后读、读后写、写后写都需要依赖，
+ * 之后去掉可以由queue内的顺序以及其他fence推出的依赖，得到最少的fence集合 */
+namespace PipelineProfilingGraph {
+
+	/** 一个fence: wait需要等待signal完成 */
+	struct FenceEdge {
+		PassLocate signal;
+		PassLocate wait;
+	};
+
+	struct RedundantFence {
+		enum Reason : uint8_t {
+			IMPLIED, /**< 可以由queue内的顺序以及输入中的其他fence推出，或者与其他fence重复 */
+			UNNEEDED, /**< 去掉该fence以及所有IMPLIED和之前的UNNEEDED的fence后，输入仍然保证最少集合中的所有依赖 */
+			REPLACEABLE, /**< 输入依靠该fence保证某个读写冲突，可以用replacement代替 */
+		};
+		FenceEdge fence;
+		Reason reason;
+		FenceEdge replacement; /**< REPLACEABLE时为依靠该fence保证的最少集合中的fence */
+	};
+
+	struct FenceInferenceResult {
+		std::vector<FenceEdge> minimalFences; /**< 由读写冲突推导出的最少fence */
+		std::vector<RedundantFence> redundantFences; /**< 输入中不属于最少集合的fence，其中IMPLIED与UNNEEDED的fence可以同时去掉 */
+		std::vector<FenceEdge> missingFences; /**< 最少集合中没有被输入的fence保证的依赖，即输入中存在的数据竞争 */
+		size_t inputFenceCount; /**< 输入中fence的数量 */
+	};
+
+	/** 推导最少的fence集合并与输入中的fence进行比较
+	 * @param passMap 渲染图中所有的pass，其中的fence决定了资源访问的先后
+	 * @param resMap 渲染图中所有的资源
+	 * @param result 推导的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 图中引用了未知的pass或者fence之间存在环时返回false */
+	bool InferFences(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		FenceInferenceResult& result, std::string* error = nullptr);
+	/** 用给定的fence替换所有pass上原有的fence
+	 * @remark 调用后需要重新构造PipelineGraph */
+	void ReplaceFences(std::vector<Queue>& passMap, const std::vector<FenceEdge>& fences);
+
+}
+
+#endif // FENCE_INFERENCE_H
@@ -0,0 +1,258 @@
+#include "frameAggregation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	const double FrameAggregator::HITCH_RATIO = 2.0;
+
+	P2Quantile::P2Quantile(double quantile) : m_quantile(quantile), m_count(0)
+	{
+		const double desired[5] = { 1.0, 1.0 + 2.0 * quantile, 1.0 + 4.0 * quantile, 3.0 + 2.0 * quantile, 5.0 };
+		const double increments[5] = { 0.0, quantile / 2.0, quantile, (1.0 + quantile) / 2.0, 1.0 };
+		for (int marker = 0; marker < 5; ++marker) {
+			m_heights[marker] = 0.0;
+			m_positions[marker] = marker + 1.0;
+			m_desired[marker] = desired[marker];
+			m_increments[marker] = increments[marker];
+		}
+	}
+
+	void P2Quantile::Add(double value)
+	{
+		/** 前5个样本直接保存，排序后作为标记的初始高度 */
+		if (m_count < 5) {
+			m_heights[m_count++] = value;
+			if (m_count == 5) std::sort(m_heights, m_heights + 5);
+			return;
+		}
+		++m_count;
+		int cell;
+		if (value < m_heights[0]) {
+			m_heights[0] = value;
+			cell = 0;
+		}
+		else if (value >= m_heights[4]) {
+			m_heights[4] = value;
+			cell = 3;
+		}
+		else {
+			cell = 0;
+			while (value >= m_heights[cell + 1]) ++cell;
+		}
+		for (int marker = cell + 1; marker < 5; ++marker)
+			m_positions[marker] += 1.0;
+		for (int marker = 0; marker < 5; ++marker)
+			m_desired[marker] += m_increments[marker];
+		/** 中间的标记偏离期望位置超过1时移动一格，优先使用抛物线插值，不单调时退化为线性插值 */
+		for (int marker = 1; marker < 4; ++marker) {
+			double offset = m_desired[marker] - m_positions[marker];
+			if ((offset >= 1.0 && m_positions[marker + 1] - m_positions[marker] > 1.0)
+				|| (offset <= -1.0 && m_positions[marker - 1] - m_positions[marker] < -1.0)) {
+				double sign = offset > 0.0 ? 1.0 : -1.0;
+				double height = parabolicHelper(marker, sign);
+				if (m_heights[marker - 1] < height && height < m_heights[marker + 1]) {
+					m_heights[marker] = height;
+				}
+				else {
+					int neighbor = marker + static_cast<int>(sign);
+					m_heights[marker] += sign * (m_heights[neighbor] - m_heights[marker])
+						/ (m_positions[neighbor] - m_positions[marker]);
+				}
+				m_positions[marker] += sign;
+			}
+		}
+	}
+
+	double P2Quantile::parabolicHelper(int index, double sign) const
+	{
+		const double* q = m_heights;
+		const double* n = m_positions;
+		return q[index] + sign / (n[index + 1] - n[index - 1])
+			* ((n[index] - n[index - 1] + sign) * (q[index + 1] - q[index]) / (n[index + 1] - n[index])
+				+ (n[index + 1] - n[index] - sign) * (q[index] - q[index - 1]) / (n[index] - n[index - 1]));
+	}
+
+	double P2Quantile::Get() const
+	{
+		if (m_count == 0) return 0.0;
+		if (m_count >= 5) return m_heights[2];
+		double samples[5];
+		std::copy(m_heights, m_heights + m_count, samples);
+		std::sort(samples, samples + m_count);
+		size_t rank = static_cast<size_t>(std::floor(m_quantile * static_cast<double>(m_count - 1) + 0.5));
+		return samples[std::min(rank, static_cast<size_t>(m_count - 1))];
+	}
+
+	void FrameAggregator::AddFrame(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap)
+	{
+		if (m_frameCount++ == 0) {
+			m_passMap = passMap;
+			m_resMap = resMap;
+			m_offsets.assign(1, 0);
+			for (const auto& queue : m_passMap)
+				m_offsets.push_back(m_offsets.back() + static_cast<uint32_t>(queue.size()));
+			m_stats.assign(m_offsets.back(), PassDurationStats());
+		}
+		uint64_t frameStart = INVALID_TIMESTAMP;
+		for (const auto& queue : passMap)
+			for (const auto& pass : queue)
+				if (pass.HasTiming()) frameStart = std::min(frameStart, pass.startTime);
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx) {
+				const Pass& pass = passMap[queIdx][passIdx];
+				if (queIdx >= m_passMap.size() || passIdx >= m_passMap[queIdx].size()
+					|| m_passMap[queIdx][passIdx].name != pass.name) {
+					++m_unmatchedPasses;
+					continue;
+				}
+				if (!pass.HasTiming()) continue;
+				PassDurationStats& stats = m_stats[m_offsets[queIdx] + passIdx];
+				uint64_t duration = pass.endTime - pass.startTime;
+				stats.min = stats.count ? std::min(stats.min, duration) : duration;
+				stats.max = stats.count ? std::max(stats.max, duration) : duration;
+				++stats.count;
+				stats.mean += (static_cast<double>(duration) - stats.mean) / static_cast<double>(stats.count);
+				stats.p50.Add(static_cast<double>(duration));
+				stats.p99.Add(static_cast<double>(duration));
+				stats.startOffset.Add(static_cast<double>(pass.startTime - frameStart));
+			}
+		}
+	}
+
+	void FrameAggregator::AddFrames(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap)
+	{
+		std::vector<ResourceIdx> resources(resMap.size());
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			resources[resIdx] = resIdx;
+		std::stable_sort(resources.begin(), resources.end(), [&resMap](ResourceIdx lhs, ResourceIdx rhs) {
+			return resMap[lhs].frame < resMap[rhs].frame;
+		});
+		size_t resCursor = 0;
+		/** 当前帧在各个queue中的pass为[begins[q], ends[q]) */
+		std::vector<PassIdx> begins(passMap.size(), 0);
+		std::vector<PassIdx> ends(passMap.size(), 0);
+		std::vector<Queue> framePasses(passMap.size());
+		std::vector<Resource> frameResources;
+		auto local = [&](const PassLocate& locate) {
+			if (locate.queueIndex >= passMap.size() || locate.inqueueIndex < begins[locate.queueIndex]
+				|| locate.inqueueIndex >= ends[locate.queueIndex])
+				return INVALID_PASS_LOCATE;
+			return PassLocate{ locate.queueIndex, locate.inqueueIndex - begins[locate.queueIndex] };
+		};
+		/** 去掉其他帧中的访问，states与passes一一对应 */
+		auto localAccesses = [&local](std::vector<PassLocate>& passes, std::vector<uint16_t>& states) {
+			size_t kept = 0;
+			for (size_t index = 0; index < passes.size(); ++index) {
+				PassLocate locate = local(passes[index]);
+				if (locate == INVALID_PASS_LOCATE) continue;
+				passes[kept] = locate;
+				if (index < states.size()) states[kept] = states[index];
+				++kept;
+			}
+			passes.resize(kept);
+			if (states.size() > kept) states.resize(kept);
+		};
+
+		while (true) {
+			/** 下一帧为各个queue剩余的pass中最小的帧索引 */
+			FrameIdx frame = INVALID_INDEX;
+			bool hasPass = false;
+			for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+				if (ends[queIdx] >= passMap[queIdx].size()) continue;
+				frame = hasPass ? std::min(frame, passMap[queIdx][ends[queIdx]].frame) : passMap[queIdx][ends[queIdx]].frame;
+				hasPass = true;
+			}
+			if (!hasPass) break;
+			for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+				begins[queIdx] = ends[queIdx];
+				while (ends[queIdx] < passMap[queIdx].size() && passMap[queIdx][ends[queIdx]].frame == frame)
+					++ends[queIdx];
+			}
+			for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+				const Queue& queue = passMap[queIdx];
+				framePasses[queIdx].assign(queue.begin() + begins[queIdx], queue.begin() + ends[queIdx]);
+				for (auto& pass : framePasses[queIdx]) {
+					pass.locate = local(pass.locate);
+					size_t kept = 0;
+					for (const auto& signal : pass.depPasses) {
+						PassLocate locate = local(signal);
+						if (locate != INVALID_PASS_LOCATE) pass.depPasses[kept++] = locate;
+					}
+					pass.depPasses.resize(kept);
+				}
+			}
+			/** 只有第一帧的资源会作为图的结构 */
+			frameResources.clear();
+			while (resCursor < resources.size() && resMap[resources[resCursor]].frame <= frame) {
+				const Resource& src = resMap[resources[resCursor++]];
+				if (m_frameCount != 0 || src.frame != frame) continue;
+				frameResources.push_back(src);
+				Resource& dst = frameResources.back();
+				dst.firstCreate = local(dst.firstCreate);
+				dst.lastDestroy = local(dst.lastDestroy);
+				localAccesses(dst.readPasses, dst.readStates);
+				localAccesses(dst.writedPasses, dst.writeStates);
+				size_t kept = 0;
+				for (auto& barrier : dst.barriers) {
+					barrier.submitPass = local(barrier.submitPass);
+					if (barrier.submitPass == INVALID_PASS_LOCATE) continue;
+					if (&dst.barriers[kept] != &barrier) dst.barriers[kept] = std::move(barrier);
+					++kept;
+				}
+				dst.barriers.resize(kept);
+			}
+			AddFrame(framePasses, frameResources);
+		}
+	}
+
+	void FrameAggregator::BuildMedianGraph(std::vector<Queue>& passMap, std::vector<Resource>& resMap) const
+	{
+		passMap = m_passMap;
+		resMap = m_resMap;
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx) {
+				Pass& pass = passMap[queIdx][passIdx];
+				const PassDurationStats& stats = m_stats[m_offsets[queIdx] + passIdx];
+				if (stats.count == 0) {
+					pass.startTime = pass.endTime = INVALID_TIMESTAMP;
+					continue;
+				}
+				pass.startTime = static_cast<uint64_t>(stats.startOffset.Get() + 0.5);
+				pass.endTime = pass.startTime + static_cast<uint64_t>(stats.p50.Get() + 0.5);
+			}
+		}
+	}
+
+	void FrameAggregator::AddWhiskers(PipelineGraph& graph) const
+	{
+		const double nsPerUnit = graph.GetNsPerUnit();
+		const auto& passMap = graph.GetPassMap();
+		for (QueueIdx queIdx = 0; queIdx < passMap.size() && queIdx < m_passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size() && passIdx < m_passMap[queIdx].size(); ++passIdx) {
+				const PassDurationStats& stats = m_stats[m_offsets[queIdx] + passIdx];
+				if (stats.count == 0) continue;
+				PassLocate locate = { queIdx, passIdx };
+				double p50 = stats.p50.Get(), p99 = stats.p99.Get();
+				char note[160];
+				std::snprintf(note, sizeof(note), "%llu frames: min %.3f us, mean %.3f us, p50 %.3f us, p99 %.3f us, max %.3f us",
+					static_cast<unsigned long long>(stats.count), static_cast<double>(stats.min) / 1000.0,
+					stats.mean / 1000.0, p50 / 1000.0, p99 / 1000.0, static_cast<double>(stats.max) / 1000.0);
+				bool hitch = p50 > 0.0 && p99 >= p50 * HITCH_RATIO;
+				graph.MarkPass(locate, hitch ? Rectangle::HIGHLIGHT : 0, note);
+				if (nsPerUnit <= 0.0 || p99 <= p50) continue;
+				/** 须线从中位数的结束位置延伸到p99的结束位置，位于pass的垂直中线上 */
+				const Rectangle& rect = graph.GetPassRect(locate);
+				float y = rect.leftUpPoint.y + rect.height / 2.0f;
+				Arrow whisker;
+				whisker.type = Arrow::WHISKER;
+				whisker.inflexionPoint.push_back({ rect.leftUpPoint.x + static_cast<float>(p50 / nsPerUnit), y });
+				whisker.inflexionPoint.push_back({ rect.leftUpPoint.x + static_cast<float>(p99 / nsPerUnit), y });
+				whisker.desc = note;
+				graph.AddOverlay(whisker);
+			}
+		}
+	}
+
+}
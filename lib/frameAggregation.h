@@ -0,0 +1,84 @@
+#ifndef FRAME_AGGREGATION_H
+#define FRAME_AGGREGATION_H
+
+#include "ppfg.h"
+
+/** 把结构相同的多帧渲染图汇总成每个pass持续时间的分布
+ * 第一帧确定图的结构，之后每一帧中与其位置相同并且名称相同的pass参与统计，其余的pass只计数；
+ * 分位数使用P²算法估计，每个pass占用的内存与帧数无关 */
+namespace PipelineProfilingGraph {
+
+	/** 用P²算法(Jain & Chlamtac, 1985)在线估计某个分位数，只保存5个标记 */
+	class P2Quantile {
+	public:
+		/** @param quantile 需要估计的分位数，取值为(0, 1) */
+		explicit P2Quantile(double quantile = 0.5);
+		void Add(double value);
+		/** 当前的估计值，样本少于5个时为精确值，没有样本时为0 */
+		double Get() const;
+		uint64_t Count() const { return m_count; }
+	private:
+		/** 按P²的抛物线公式调整第index个标记的高度 */
+		double parabolicHelper(int index, double sign) const;
+	private:
+		double m_quantile;
+		uint64_t m_count;
+		double m_heights[5]; /**< 各个标记的高度，即估计的最小值、p/2、p、(1+p)/2分位数以及最大值 */
+		double m_positions[5]; /**< 各个标记实际的位置 */
+		double m_desired[5]; /**< 各个标记期望的位置 */
+		double m_increments[5]; /**< 每个样本使期望位置增加的量 */
+	};
+
+	/** 某个pass在所有帧中的持续时间的分布，单位为纳秒 */
+	struct PassDurationStats {
+		PassDurationStats() : count(0), min(0), max(0), mean(0.0), p50(0.5), p99(0.99), startOffset(0.5) {}
+		uint64_t count; /**< 记录了时间的帧数 */
+		uint64_t min;
+		uint64_t max;
+		double mean;
+		P2Quantile p50;
+		P2Quantile p99;
+		P2Quantile startOffset; /**< 相对于该帧最早的pass的开始时间的中位数，用于放置代表帧中的pass */
+	};
+
+	class FrameAggregator {
+	public:
+		FrameAggregator() : m_frameCount(0), m_unmatchedPasses(0) {}
+		/** 加入一帧，第一帧的pass与资源作为图的结构 */
+		void AddFrame(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap);
+		/** 加入一张由多帧拼接成的图(例如多帧的capture)，按Pass::frame拆分后逐帧加入
+		 * 跨帧的fence以及对其他帧中pass的引用会被去掉，没有pass的帧会被跳过
+		 * @remark 要求同一queue中pass的帧索引不递减 */
+		void AddFrames(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap);
+		/** 加入的帧数 */
+		uint64_t FrameCount() const { return m_frameCount; }
+		/** 在第一帧中找不到位置与名称都相同的pass的数量，累计所有帧 */
+		uint64_t UnmatchedPasses() const { return m_unmatchedPasses; }
+		/** 作为结构的第一帧中的pass */
+		const std::vector<Queue>& GetPassMap() const { return m_passMap; }
+		/** 某个pass的统计结果，位置为第一帧中的位置 */
+		const PassDurationStats& GetStats(const PassLocate& locate) const {
+			return m_stats[m_offsets[locate.queueIndex] + locate.inqueueIndex];
+		}
+		/** 生成代表帧: 结构与第一帧相同，每个pass从其开始时间的中位数开始，持续时间为中位数
+		 * @param passMap 代表帧中所有的pass
+		 * @param resMap 代表帧中所有的资源 */
+		void BuildMedianGraph(std::vector<Queue>& passMap, std::vector<Resource>& resMap) const;
+		/** 在代表帧的每个pass上绘制从中位数到p99的须线，p99达到中位数HITCH_RATIO倍的pass突出显示，
+		 * 所有pass的描述中加入其分布
+		 * @remark graph必须由BuildMedianGraph的结果构造，并按时间布局，调用该函数前，必须保证graph的Setup被调用 */
+		void AddWhiskers(PipelineGraph& graph) const;
+
+		static const double HITCH_RATIO;
+	private:
+		std::vector<Queue> m_passMap; /**< 第一帧的pass */
+		std::vector<Resource> m_resMap; /**< 第一帧的资源 */
+		std::vector<uint32_t> m_offsets; /**< 每个queue中第一个pass在m_stats中的位置 */
+		std::vector<PassDurationStats> m_stats;
+		uint64_t m_frameCount;
+		uint64_t m_unmatchedPasses;
+	};
+
+}
+
+#endif // FRAME_AGGREGATION_H
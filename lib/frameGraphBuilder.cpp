@@ -0,0 +1,198 @@
+#include "frameGraphBuilder.h"
+
+namespace PipelineProfilingGraph {
+
+	void FrameGraphBuilder::Reserve(uint32_t passCount, uint32_t resourceCount, uint32_t accessCount,
+		uint32_t fenceCount, uint32_t barrierCount, uint32_t nameBytes)
+	{
+		m_passes.reserve(passCount);
+		m_resources.reserve(resourceCount);
+		m_lifetimes.reserve(resourceCount);
+		m_accesses.reserve(accessCount);
+		m_fences.reserve(fenceCount);
+		m_barriers.reserve(barrierCount);
+		m_names.reserve(nameBytes);
+	}
+
+	void FrameGraphBuilder::Clear()
+	{
+		m_names.clear();
+		m_queueSizes.clear();
+		m_passes.clear();
+		m_fences.clear();
+		m_timings.clear();
+		m_resources.clear();
+		m_lifetimes.clear();
+		m_memories.clear();
+		m_accesses.clear();
+		m_barriers.clear();
+	}
+
+	bool FrameGraphBuilder::validate(std::string* error) const
+	{
+		const uint32_t passCount = static_cast<uint32_t>(m_passes.size());
+		const uint32_t resourceCount = static_cast<uint32_t>(m_resources.size());
+		/** 先统计所有无效的记录，再报告第一个 */
+		uint32_t invalidFences = 0, invalidTimings = 0, invalidLifetimes = 0, invalidMemories = 0;
+		uint32_t invalidAccesses = 0, invalidBarriers = 0;
+		for (const auto& fence : m_fences)
+			invalidFences += (fence.signal >= passCount) | (fence.wait >= passCount) | (fence.signal == fence.wait);
+		for (const auto& timing : m_timings)
+			invalidTimings += (timing.pass >= passCount) | (timing.end < timing.start);
+		for (const auto& lifetime : m_lifetimes)
+			invalidLifetimes += (lifetime.resource >= resourceCount)
+				| (lifetime.create >= passCount && lifetime.create != INVALID_INDEX)
+				| (lifetime.destroy >= passCount && lifetime.destroy != INVALID_INDEX);
+		for (const auto& memory : m_memories)
+			invalidMemories += (memory.resource >= resourceCount) | (memory.heapType >= HEAP_TYPE_COUNT)
+				| ((memory.alignment & (memory.alignment - 1)) != 0);
+		for (const auto& access : m_accesses)
+			invalidAccesses += (access.resource >= resourceCount) | (access.pass >= passCount);
+		for (const auto& barrier : m_barriers)
+			invalidBarriers += (barrier.resource >= resourceCount) | (barrier.pass >= passCount);
+		if (invalidFences + invalidTimings + invalidLifetimes + invalidMemories + invalidAccesses + invalidBarriers == 0) {
+			/** fence之间存在环时Setup无法完成布局 */
+			if (fencesAcyclic()) return true;
+			if (error) *error = "fences form a cycle";
+			return false;
+		}
+		if (error) {
+			*error = "invalid handles: " + std::to_string(invalidFences) + " fences, "
+				+ std::to_string(invalidTimings) + " timings, "
+				+ std::to_string(invalidLifetimes) + " lifetimes, "
+				+ std::to_string(invalidMemories) + " memories, "
+				+ std::to_string(invalidAccesses) + " accesses, "
+				+ std::to_string(invalidBarriers) + " barriers";
+		}
+		return false;
+	}
+
+	bool FrameGraphBuilder::fencesAcyclic() const
+	{
+		const uint32_t passCount = static_cast<uint32_t>(m_passes.size());
+		/** 同一queue中的pass按句柄的顺序添加，queue内的后继即该queue中的下一个句柄 */
+		std::vector<uint32_t> inDegrees(passCount, 0);
+		std::vector<uint32_t> nextInQueue(passCount, INVALID_INDEX);
+		std::vector<uint32_t> lastInQueue(m_queueSizes.size(), INVALID_INDEX);
+		for (uint32_t pass = 0; pass < passCount; ++pass) {
+			uint32_t& last = lastInQueue[m_passes[pass].queue];
+			if (last != INVALID_INDEX) {
+				nextInQueue[last] = pass;
+				++inDegrees[pass];
+			}
+			last = pass;
+		}
+		std::vector<uint32_t> fenceOffsets(passCount + 1, 0);
+		for (const auto& fence : m_fences) {
+			++fenceOffsets[fence.signal + 1];
+			++inDegrees[fence.wait];
+		}
+		for (uint32_t pass = 0; pass < passCount; ++pass)
+			fenceOffsets[pass + 1] += fenceOffsets[pass];
+		std::vector<uint32_t> fenceTargets(m_fences.size());
+		std::vector<uint32_t> cursor(fenceOffsets.begin(), fenceOffsets.end() - 1);
+		for (const auto& fence : m_fences)
+			fenceTargets[cursor[fence.signal]++] = fence.wait;
+
+		std::vector<uint32_t> ready;
+		ready.reserve(passCount);
+		for (uint32_t pass = 0; pass < passCount; ++pass)
+			if (inDegrees[pass] == 0) ready.push_back(pass);
+		for (size_t head = 0; head < ready.size(); ++head) {
+			uint32_t pass = ready[head];
+			if (nextInQueue[pass] != INVALID_INDEX && --inDegrees[nextInQueue[pass]] == 0)
+				ready.push_back(nextInQueue[pass]);
+			for (uint32_t fenceIdx = fenceOffsets[pass]; fenceIdx < fenceOffsets[pass + 1]; ++fenceIdx)
+				if (--inDegrees[fenceTargets[fenceIdx]] == 0) ready.push_back(fenceTargets[fenceIdx]);
+		}
+		return ready.size() == passCount;
+	}
+
+	bool FrameGraphBuilder::Build(std::vector<Queue>& passMap, std::vector<Resource>& resMap,
+		std::string* error) const
+	{
+		if (!validate(error)) return false;
+		auto locate = [this](uint32_t pass) {
+			if (pass == INVALID_INDEX) return INVALID_PASS_LOCATE;
+			return PassLocate{ m_passes[pass].queue, m_passes[pass].inqueueIndex };
+		};
+
+		/** 先统计每个pass的fence数量，使每个依赖数组只分配一次 */
+		std::vector<uint32_t> fenceCounts(m_passes.size(), 0);
+		for (const auto& fence : m_fences)
+			++fenceCounts[fence.wait];
+		passMap.clear();
+		passMap.resize(m_queueSizes.size());
+		for (QueueIdx queIdx = 0; queIdx < m_queueSizes.size(); ++queIdx)
+			passMap[queIdx].reserve(m_queueSizes[queIdx]);
+		for (uint32_t passId = 0; passId < m_passes.size(); ++passId) {
+			const PassRecord& record = m_passes[passId];
+			FenceSignalPasses deps;
+			deps.reserve(fenceCounts[passId]);
+			passMap[record.queue].push_back(Pass(m_names.c_str() + record.nameOffset,
+				record.queue, record.inqueueIndex, std::move(deps)));
+		}
+		for (const auto& fence : m_fences) {
+			const PassRecord& wait = m_passes[fence.wait];
+			passMap[wait.queue][wait.inqueueIndex].depPasses.push_back(locate(fence.signal));
+		}
+		for (const auto& timing : m_timings) {
+			const PassRecord& record = m_passes[timing.pass];
+			Pass& pass = passMap[record.queue][record.inqueueIndex];
+			pass.startTime = timing.start;
+			pass.endTime = timing.end;
+		}
+
+		resMap.clear();
+		resMap.resize(m_resources.size());
+		std::vector<uint32_t> readCounts(m_resources.size(), 0), writeCounts(m_resources.size(), 0);
+		std::vector<uint32_t> barrierCounts(m_resources.size(), 0);
+		for (const auto& access : m_accesses)
+			++(access.type == ACCESS_READ ? readCounts : writeCounts)[access.resource];
+		for (const auto& barrier : m_barriers)
+			++barrierCounts[barrier.resource];
+		for (ResourceIdx resIdx = 0; resIdx < m_resources.size(); ++resIdx) {
+			Resource& resource = resMap[resIdx];
+			resource.name = m_names.c_str() + m_resources[resIdx].nameOffset;
+			resource.firstCreate = INVALID_PASS_LOCATE;
+			resource.lastDestroy = INVALID_PASS_LOCATE;
+			resource.size = 0;
+			resource.alignment = 0;
+			resource.heapType = HEAP_DEFAULT;
+			resource.readPasses.reserve(readCounts[resIdx]);
+			resource.writedPasses.reserve(writeCounts[resIdx]);
+			resource.readStates.reserve(readCounts[resIdx]);
+			resource.writeStates.reserve(writeCounts[resIdx]);
+			resource.barriers.reserve(barrierCounts[resIdx]);
+		}
+		for (const auto& lifetime : m_lifetimes) {
+			resMap[lifetime.resource].firstCreate = locate(lifetime.create);
+			resMap[lifetime.resource].lastDestroy = locate(lifetime.destroy);
+		}
+		for (const auto& memory : m_memories) {
+			Resource& resource = resMap[memory.resource];
+			resource.size = memory.size;
+			resource.alignment = memory.alignment;
+			resource.heapType = memory.heapType;
+		}
+		for (const auto& access : m_accesses) {
+			Resource& resource = resMap[access.resource];
+			bool read = access.type == ACCESS_READ;
+			(read ? resource.readPasses : resource.writedPasses).push_back(locate(access.pass));
+			(read ? resource.readStates : resource.writeStates).push_back(access.state);
+		}
+		for (const auto& barrier : m_barriers) {
+			resMap[barrier.resource].barriers.push_back(Barrier(locate(barrier.pass),
+				m_names.c_str() + barrier.descOffset, barrier.flags, barrier.stateBefore, barrier.stateAfter));
+		}
+		return true;
+	}
+
+	bool FrameGraphBuilder::Build(PipelineGraph& graph, std::string* error)
+	{
+		if (!Build(m_passMap, m_resMap, error)) return false;
+		graph.Reset(m_passMap, m_resMap);
+		return true;
+	}
+
+}
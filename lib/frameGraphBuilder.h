@@ -0,0 +1,169 @@
+#ifndef FRAME_GRAPH_BUILDER_H
+#define FRAME_GRAPH_BUILDER_H
+
+#include "ppfg.h"
+
+/** 以句柄的方式构建渲染图，调用方不需要自己计算PassLocate
+ * 所有的添加操作只是向预留好的扁平数组中追加记录，索引的检查统一在Build时进行 */
+namespace PipelineProfilingGraph {
+
+	/** pass的句柄，由FrameGraphBuilder::AddPass返回 */
+	struct PassHandle {
+		uint32_t id;
+	};
+	/** 资源的句柄，由FrameGraphBuilder::AddResource返回 */
+	struct ResourceHandle {
+		uint32_t id;
+	};
+	/** 无效的句柄，可用于表示资源一直存在或一直未被删除 */
+	const PassHandle INVALID_PASS_HANDLE = { INVALID_INDEX };
+
+	class FrameGraphBuilder {
+	public:
+		FrameGraphBuilder() {}
+		/** 预留各个数组的容量，避免构建过程中重新分配内存
+		 * @param passCount pass的数量
+		 * @param resourceCount 资源的数量
+		 * @param accessCount 资源读写的数量
+		 * @param fenceCount fence的数量
+		 * @param barrierCount barrier的数量
+		 * @param nameBytes 所有名称以及描述的总长度 */
+		void Reserve(uint32_t passCount, uint32_t resourceCount, uint32_t accessCount,
+			uint32_t fenceCount, uint32_t barrierCount, uint32_t nameBytes = 0);
+		/** 清空已添加的内容，保留已分配的内存 */
+		void Clear();
+
+		/** 在某个queue的末尾添加一个pass */
+		PassHandle AddPass(QueueIdx queue, const char* name) {
+			if (queue >= m_queueSizes.size()) m_queueSizes.resize(queue + 1, 0);
+			m_passes.push_back({ queue, m_queueSizes[queue]++, storeName(name) });
+			return { static_cast<uint32_t>(m_passes.size() - 1) };
+		}
+		/** 添加一个fence: wait需要等待signal完成 */
+		void AddFence(PassHandle signal, PassHandle wait) {
+			m_fences.push_back({ signal.id, wait.id });
+		}
+		/** 设置pass在GPU上的起止时间戳(纳秒)，用于按时间布局 */
+		void SetPassTime(PassHandle pass, uint64_t start, uint64_t end) {
+			m_timings.push_back({ pass.id, start, end });
+		}
+		/** 添加一个资源，其生命周期默认覆盖整个图 */
+		ResourceHandle AddResource(const char* name) {
+			m_resources.push_back({ storeName(name) });
+			return { static_cast<uint32_t>(m_resources.size() - 1) };
+		}
+		/** 设置资源的生命周期
+		 * @param create 创建该资源的pass，INVALID_PASS_HANDLE表示一直存在
+		 * @param destroy 删除该资源的pass，INVALID_PASS_HANDLE表示一直未被删除 */
+		void SetLifetime(ResourceHandle resource, PassHandle create, PassHandle destroy) {
+			m_lifetimes.push_back({ resource.id, create.id, destroy.id });
+		}
+		/** 设置资源占用的内存
+		 * @param size 资源占用的字节数
+		 * @param alignment 资源在堆中的对齐字节数，为0或者2的幂
+		 * @param heapType 资源所在的堆，见HeapType */
+		void SetMemory(ResourceHandle resource, uint64_t size, uint32_t alignment = 0, uint8_t heapType = HEAP_DEFAULT) {
+			m_memories.push_back({ resource.id, alignment, size, heapType });
+		}
+		/** @param state 读取时资源所处的状态，见ResourceState */
+		void Read(ResourceHandle resource, PassHandle pass, uint16_t state = DEFAULT_READ_STATE) {
+			m_accesses.push_back({ resource.id, pass.id, state, ACCESS_READ });
+		}
+		/** @param state 写入时资源所处的状态，见ResourceState */
+		void Write(ResourceHandle resource, PassHandle pass, uint16_t state = DEFAULT_WRITE_STATE) {
+			m_accesses.push_back({ resource.id, pass.id, state, ACCESS_WRITE });
+		}
+		/** 添加一个barrier
+		 * @param flags 由Barrier::Flag通过or操作设置
+		 * @param before TRANSITION_BARRIER切换前的状态
+		 * @param after TRANSITION_BARRIER切换后的状态 */
+		void AddBarrier(ResourceHandle resource, PassHandle submit, const char* desc, uint8_t flags,
+			uint16_t before = STATE_COMMON, uint16_t after = STATE_COMMON) {
+			m_barriers.push_back({ resource.id, submit.id, storeName(desc), flags, before, after });
+		}
+
+		/** 检查所有句柄并生成渲染图的输入，句柄无效或者fence之间存在环时失败
+		 * @param error 检查失败时的错误信息，可以为空
+		 * @return 是否构建成功，失败时passMap和resMap不会被修改 */
+		bool Build(std::vector<Queue>& passMap, std::vector<Resource>& resMap,
+			std::string* error = nullptr) const;
+		/** 检查所有句柄并将结果放入graph中
+		 * @remark 构建后需要调用graph的Setup */
+		bool Build(PipelineGraph& graph, std::string* error = nullptr);
+	private:
+		uint32_t storeName(const char* name) {
+			uint32_t offset = static_cast<uint32_t>(m_names.size());
+			m_names.append(name ? name : "");
+			m_names.push_back('\0');
+			return offset;
+		}
+		/** 检查所有记录中的句柄，以及fence之间没有环 */
+		bool validate(std::string* error) const;
+		/** pass依赖于同一queue上的前一个pass以及其fence等待的pass，检查这些依赖是否无环
+		 * @remark 要求所有的句柄都有效 */
+		bool fencesAcyclic() const;
+	private:
+		enum AccessType : uint8_t {
+			ACCESS_READ,
+			ACCESS_WRITE,
+		};
+		struct PassRecord {
+			QueueIdx queue;
+			PassIdx inqueueIndex;
+			uint32_t nameOffset;
+		};
+		struct FenceRecord {
+			uint32_t signal;
+			uint32_t wait;
+		};
+		struct TimingRecord {
+			uint32_t pass;
+			uint64_t start;
+			uint64_t end;
+		};
+		struct ResourceRecord {
+			uint32_t nameOffset;
+		};
+		struct LifetimeRecord {
+			uint32_t resource;
+			uint32_t create;
+			uint32_t destroy;
+		};
+		struct MemoryRecord {
+			uint32_t resource;
+			uint32_t alignment;
+			uint64_t size;
+			uint8_t heapType;
+		};
+		struct AccessRecord {
+			uint32_t resource;
+			uint32_t pass;
+			uint16_t state;
+			AccessType type;
+		};
+		struct BarrierRecord {
+			uint32_t resource;
+			uint32_t pass;
+			uint32_t descOffset;
+			uint8_t flags;
+			uint16_t stateBefore;
+			uint16_t stateAfter;
+		};
+
+		std::string m_names; /**< 所有名称以及描述，以'\0'分隔 */
+		std::vector<PassIdx> m_queueSizes; /**< 各个queue中pass的数量 */
+		std::vector<PassRecord> m_passes;
+		std::vector<FenceRecord> m_fences;
+		std::vector<TimingRecord> m_timings;
+		std::vector<ResourceRecord> m_resources;
+		std::vector<LifetimeRecord> m_lifetimes;
+		std::vector<MemoryRecord> m_memories;
+		std::vector<AccessRecord> m_accesses;
+		std::vector<BarrierRecord> m_barriers;
+		std::vector<Queue> m_passMap; /**< Build(PipelineGraph&)时与图交换的容器 */
+		std::vector<Resource> m_resMap; /**< Build(PipelineGraph&)时与图交换的容器 */
+	};
+
+}
+
+#endif // FRAME_GRAPH_BUILDER_H
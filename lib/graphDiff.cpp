@@ -0,0 +1,535 @@
+#include "graphDiff.h"
+#include "passOrder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 两个整数序列的最长公共子序列，使用Myers的O(ND)算法，
+		 * 每次从两端同时搜索找到中间的分割点，再分别处理两侧，只需要线性的空间 */
+		class SequenceAligner {
+		public:
+			/** @param matches 接收对齐的元素在a与b中的索引，不保证顺序 */
+			void Align(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b,
+				std::vector< std::pair<uint32_t, uint32_t> >& matches) {
+				matches.clear();
+				m_a = a.data();
+				m_b = b.data();
+				struct Range {
+					int aBegin, aEnd, bBegin, bEnd;
+				};
+				/** 使用显式的栈代替递归 */
+				std::vector<Range> stack(1, Range{ 0, static_cast<int>(a.size()), 0, static_cast<int>(b.size()) });
+				while (!stack.empty()) {
+					Range range = stack.back();
+					stack.pop_back();
+					while (range.aBegin < range.aEnd && range.bBegin < range.bEnd && m_a[range.aBegin] == m_b[range.bBegin])
+						matches.push_back(std::make_pair(range.aBegin++, range.bBegin++));
+					while (range.aBegin < range.aEnd && range.bBegin < range.bEnd && m_a[range.aEnd - 1] == m_b[range.bEnd - 1])
+						matches.push_back(std::make_pair(--range.aEnd, --range.bEnd));
+					if (range.aBegin == range.aEnd || range.bBegin == range.bEnd) continue;
+					int x, y;
+					if (!bisectHelper(range.aBegin, range.aEnd, range.bBegin, range.bEnd, x, y)) continue;
+					stack.push_back(Range{ range.aBegin, range.aBegin + x, range.bBegin, range.bBegin + y });
+					stack.push_back(Range{ range.aBegin + x, range.aEnd, range.bBegin + y, range.bEnd });
+				}
+			}
+		private:
+			/** 找到最短编辑路径上的一个中间点(x, y)，坐标相对于范围的起点
+			 * @return 两侧没有相同的元素时返回false */
+			bool bisectHelper(int aBegin, int aEnd, int bBegin, int bEnd, int& splitX, int& splitY) {
+				const uint32_t* a = m_a + aBegin;
+				const uint32_t* b = m_b + bBegin;
+				const int lengthA = aEnd - aBegin;
+				const int lengthB = bEnd - bBegin;
+				const int maxD = (lengthA + lengthB + 1) / 2;
+				const int offset = maxD;
+				const int length = 2 * maxD + 2;
+				m_forward.assign(length, -1);
+				m_backward.assign(length, -1);
+				m_forward[offset + 1] = 0;
+				m_backward[offset + 1] = 0;
+				const int delta = lengthA - lengthB;
+				/** delta为奇数时正向的路径先与反向的路径相遇 */
+				const bool front = (delta & 1) != 0;
+				/** 越过图的右侧或下侧的对角线不再搜索 */
+				int forwardStart = 0, forwardEnd = 0, backwardStart = 0, backwardEnd = 0;
+				for (int d = 0; d < maxD; ++d) {
+					for (int k = -d + forwardStart; k <= d - forwardEnd; k += 2) {
+						int index = offset + k;
+						int x = (k == -d || (k != d && m_forward[index - 1] < m_forward[index + 1]))
+							? m_forward[index + 1] : m_forward[index - 1] + 1;
+						int y = x - k;
+						while (x < lengthA && y < lengthB && a[x] == b[y]) {
+							++x;
+							++y;
+						}
+						m_forward[index] = x;
+						if (x > lengthA) {
+							forwardEnd += 2;
+						}
+						else if (y > lengthB) {
+							forwardStart += 2;
+						}
+						else if (front) {
+							int backwardIndex = offset + delta - k;
+							if (backwardIndex >= 0 && backwardIndex < length && m_backward[backwardIndex] != -1
+								&& x >= lengthA - m_backward[backwardIndex]) {
+								splitX = x;
+								splitY = y;
+								return true;
+							}
+						}
+					}
+					for (int k = -d + backwardStart; k <= d - backwardEnd; k += 2) {
+						int index = offset + k;
+						int x = (k == -d || (k != d && m_backward[index - 1] < m_backward[index + 1]))
+							? m_backward[index + 1] : m_backward[index - 1] + 1;
+						int y = x - k;
+						while (x < lengthA && y < lengthB && a[lengthA - x - 1] == b[lengthB - y - 1]) {
+							++x;
+							++y;
+						}
+						m_backward[index] = x;
+						if (x > lengthA) {
+							backwardEnd += 2;
+						}
+						else if (y > lengthB) {
+							backwardStart += 2;
+						}
+						else if (!front) {
+							int forwardIndex = offset + delta - k;
+							if (forwardIndex >= 0 && forwardIndex < length && m_forward[forwardIndex] != -1) {
+								int forwardX = m_forward[forwardIndex];
+								if (forwardX >= lengthA - x) {
+									splitX = forwardX;
+									splitY = offset + forwardX - forwardIndex;
+									return true;
+								}
+							}
+						}
+					}
+				}
+				return false;
+			}
+		private:
+			const uint32_t* m_a;
+			const uint32_t* m_b;
+			std::vector<int> m_forward; /**< 正向搜索中每条对角线到达的最远的x */
+			std::vector<int> m_backward; /**< 反向搜索中每条对角线到达的最远的x，从序列的末尾算起 */
+		};
+
+		/** 图中所有fence以及资源引用的pass是否存在 */
+		bool validateHelper(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+			const PassIndex& index, const char* graphName, std::string* error) {
+			for (const auto& queue : passMap) {
+				for (const auto& pass : queue) {
+					for (const auto& dep : pass.depPasses) {
+						if (index.Contains(dep)) continue;
+						if (error) *error = std::string(graphName) + " graph: pass " + pass.name + " waits for an unknown pass";
+						return false;
+					}
+				}
+			}
+			for (const auto& resource : resMap) {
+				bool valid = (resource.firstCreate == INVALID_PASS_LOCATE || index.Contains(resource.firstCreate))
+					&& (resource.lastDestroy == INVALID_PASS_LOCATE || index.Contains(resource.lastDestroy));
+				for (const auto& pass : resource.readPasses) valid = valid && index.Contains(pass);
+				for (const auto& pass : resource.writedPasses) valid = valid && index.Contains(pass);
+				for (const auto& barrier : resource.barriers) valid = valid && index.Contains(barrier.submitPass);
+				if (valid) continue;
+				if (error) *error = std::string(graphName) + " graph: resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+			return true;
+		}
+
+		uint64_t durationHelper(const Pass& pass) {
+			return pass.HasTiming() ? pass.endTime - pass.startTime : INVALID_TIMESTAMP;
+		}
+
+		uint64_t spanHelper(const std::vector<Queue>& passMap) {
+			uint64_t start = INVALID_TIMESTAMP, end = 0;
+			for (const auto& queue : passMap) {
+				for (const auto& pass : queue) {
+					if (!pass.HasTiming()) continue;
+					start = std::min(start, pass.startTime);
+					end = std::max(end, pass.endTime);
+				}
+			}
+			return start == INVALID_TIMESTAMP ? 0 : end - start;
+		}
+
+		/** 用于比较barrier的键，提交的pass为合并后的pass编号 */
+		struct BarrierKey {
+			uint32_t pass;
+			uint16_t stateBefore;
+			uint16_t stateAfter;
+			uint8_t flags;
+			uint32_t barrierIdx; /**< barrier在资源中的索引，不参与比较 */
+			bool operator<(const BarrierKey& rhs) const {
+				if (pass != rhs.pass) return pass < rhs.pass;
+				if (flags != rhs.flags) return flags < rhs.flags;
+				if (stateBefore != rhs.stateBefore) return stateBefore < rhs.stateBefore;
+				return stateAfter < rhs.stateAfter;
+			}
+		};
+
+		std::string microseconds(uint64_t ns) {
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.3f", static_cast<double>(ns) / 1000.0);
+			return text;
+		}
+
+	}
+
+	bool DiffGraphs(const std::vector<Queue>& oldPassMap, const std::vector<Resource>& oldResMap,
+		const std::vector<Queue>& newPassMap, const std::vector<Resource>& newResMap,
+		GraphDiff& diff, std::string* error)
+	{
+		PassIndex oldIndex(oldPassMap), newIndex(newPassMap);
+		std::vector<uint32_t> order;
+		/** 合并后的图只使用新图中的fence，新图没有环时合并后的图也没有环 */
+		if (!TopologicalOrder(newPassMap, newIndex, order, error)) return false;
+		if (!validateHelper(oldPassMap, oldResMap, oldIndex, "old", error)
+			|| !validateHelper(newPassMap, newResMap, newIndex, "new", error))
+			return false;
+
+		/** 把名称换成整数，对齐时只比较整数 */
+		std::unordered_map<std::string, uint32_t> nameIds;
+		auto nameId = [&nameIds](const std::string& name) {
+			return nameIds.insert(std::make_pair(name, static_cast<uint32_t>(nameIds.size()))).first->second;
+		};
+		std::vector<uint32_t> oldNames(oldIndex.PassCount()), newNames(newIndex.PassCount());
+		for (uint32_t id = 0; id < oldIndex.PassCount(); ++id) {
+			PassLocate locate = oldIndex.ToLocate(id);
+			oldNames[id] = nameId(oldPassMap[locate.queueIndex][locate.inqueueIndex].name);
+		}
+		for (uint32_t id = 0; id < newIndex.PassCount(); ++id) {
+			PassLocate locate = newIndex.ToLocate(id);
+			newNames[id] = nameId(newPassMap[locate.queueIndex][locate.inqueueIndex].name);
+		}
+
+		/** 同一queue中对齐的pass */
+		std::vector<uint32_t> oldToNew(oldIndex.PassCount(), INVALID_INDEX), newToOld(newIndex.PassCount(), INVALID_INDEX);
+		std::vector<uint8_t> aligned(newIndex.PassCount(), 0);
+		SequenceAligner aligner;
+		std::vector< std::pair<uint32_t, uint32_t> > matches;
+		const QueueIdx commonQueues = std::min(oldIndex.QueueCount(), newIndex.QueueCount());
+		for (QueueIdx queIdx = 0; queIdx < commonQueues; ++queIdx) {
+			std::vector<uint32_t> a(oldNames.begin() + oldIndex.QueueBegin(queIdx), oldNames.begin() + oldIndex.QueueEnd(queIdx));
+			std::vector<uint32_t> b(newNames.begin() + newIndex.QueueBegin(queIdx), newNames.begin() + newIndex.QueueEnd(queIdx));
+			aligner.Align(a, b, matches);
+			for (const auto& match : matches) {
+				uint32_t oldId = oldIndex.QueueBegin(queIdx) + match.first;
+				uint32_t newId = newIndex.QueueBegin(queIdx) + match.second;
+				oldToNew[oldId] = newId;
+				newToOld[newId] = oldId;
+				aligned[newId] = 1;
+			}
+		}
+		/** 剩下的pass中名称相同的按出现顺序配对 */
+		struct NameQueue {
+			std::vector<uint32_t> ids;
+			size_t next;
+		};
+		std::unordered_map<uint32_t, NameQueue> unmatchedOld;
+		for (uint32_t id = 0; id < oldIndex.PassCount(); ++id) {
+			if (oldToNew[id] != INVALID_INDEX) continue;
+			NameQueue& pending = unmatchedOld[oldNames[id]];
+			if (pending.ids.empty()) pending.next = 0;
+			pending.ids.push_back(id);
+		}
+		for (uint32_t id = 0; id < newIndex.PassCount(); ++id) {
+			if (newToOld[id] != INVALID_INDEX) continue;
+			auto pending = unmatchedOld.find(newNames[id]);
+			if (pending == unmatchedOld.end() || pending->second.next == pending->second.ids.size()) continue;
+			uint32_t oldId = pending->second.ids[pending->second.next++];
+			oldToNew[oldId] = id;
+			newToOld[id] = oldId;
+		}
+
+		/** 按对齐的顺序合并每个queue */
+		diff.passMap.assign(std::max(oldIndex.QueueCount(), newIndex.QueueCount()), Queue());
+		diff.oldPasses.clear();
+		diff.newPasses.clear();
+		diff.passChanges.clear();
+		diff.oldDurations.clear();
+		diff.newDurations.clear();
+		diff.addedPasses = diff.removedPasses = diff.movedPasses = 0;
+		std::vector<uint32_t> oldToMerged(oldIndex.PassCount(), INVALID_INDEX), newToMerged(newIndex.PassCount(), INVALID_INDEX);
+		for (QueueIdx queIdx = 0; queIdx < diff.passMap.size(); ++queIdx) {
+			Queue& queue = diff.passMap[queIdx];
+			uint32_t oldId = queIdx < oldIndex.QueueCount() ? oldIndex.QueueBegin(queIdx) : 0;
+			uint32_t oldEnd = queIdx < oldIndex.QueueCount() ? oldIndex.QueueEnd(queIdx) : 0;
+			uint32_t newId = queIdx < newIndex.QueueCount() ? newIndex.QueueBegin(queIdx) : 0;
+			uint32_t newEnd = queIdx < newIndex.QueueCount() ? newIndex.QueueEnd(queIdx) : 0;
+			auto emit = [&](uint32_t fromOld, uint32_t fromNew) {
+				uint32_t mergedId = static_cast<uint32_t>(diff.oldPasses.size());
+				PassLocate oldLocate = fromOld == INVALID_INDEX ? INVALID_PASS_LOCATE : oldIndex.ToLocate(fromOld);
+				PassLocate newLocate = fromNew == INVALID_INDEX ? INVALID_PASS_LOCATE : newIndex.ToLocate(fromNew);
+				const Pass* oldPass = fromOld == INVALID_INDEX ? nullptr : &oldPassMap[oldLocate.queueIndex][oldLocate.inqueueIndex];
+				const Pass* newPass = fromNew == INVALID_INDEX ? nullptr : &newPassMap[newLocate.queueIndex][newLocate.inqueueIndex];
+				queue.push_back(newPass ? *newPass : *oldPass);
+				Pass& pass = queue.back();
+				pass.locate = { queIdx, static_cast<PassIdx>(queue.size() - 1) };
+				pass.depPasses.clear();
+				pass.frame = 0;
+				pass.processed = false;
+				/** 被删除的pass的时间属于旧图，不参与按时间布局 */
+				if (!newPass) pass.startTime = pass.endTime = INVALID_TIMESTAMP;
+				diff.oldPasses.push_back(oldLocate);
+				diff.newPasses.push_back(newLocate);
+				diff.oldDurations.push_back(oldPass ? durationHelper(*oldPass) : INVALID_TIMESTAMP);
+				diff.newDurations.push_back(newPass ? durationHelper(*newPass) : INVALID_TIMESTAMP);
+				uint8_t change = !oldPass ? GraphDiff::PASS_ADDED : !newPass ? GraphDiff::PASS_REMOVED
+					: aligned[fromNew] ? GraphDiff::PASS_MATCHED : GraphDiff::PASS_MOVED;
+				diff.passChanges.push_back(change);
+				diff.addedPasses += change == GraphDiff::PASS_ADDED;
+				diff.removedPasses += change == GraphDiff::PASS_REMOVED;
+				diff.movedPasses += change == GraphDiff::PASS_MOVED;
+				if (oldPass) oldToMerged[fromOld] = mergedId;
+				if (newPass) newToMerged[fromNew] = mergedId;
+			};
+			while (oldId < oldEnd || newId < newEnd) {
+				if (oldId < oldEnd && (oldToNew[oldId] == INVALID_INDEX || !aligned[oldToNew[oldId]])) {
+					/** 移动了的pass只出现在新的位置 */
+					if (oldToNew[oldId] == INVALID_INDEX) emit(oldId, INVALID_INDEX);
+					++oldId;
+				}
+				else if (newId < newEnd && !aligned[newId]) {
+					emit(newToOld[newId], newId);
+					++newId;
+				}
+				else {
+					emit(oldId++, newId++);
+				}
+			}
+		}
+		for (uint32_t oldId = 0; oldId < oldIndex.PassCount(); ++oldId)
+			if (oldToMerged[oldId] == INVALID_INDEX) oldToMerged[oldId] = newToMerged[oldToNew[oldId]];
+
+		PassIndex mergedIndex(diff.passMap);
+		auto oldToMergedLocate = [&](const PassLocate& locate) {
+			return locate == INVALID_PASS_LOCATE ? locate : mergedIndex.ToLocate(oldToMerged[oldIndex.ToId(locate)]);
+		};
+		auto newToMergedLocate = [&](const PassLocate& locate) {
+			return locate == INVALID_PASS_LOCATE ? locate : mergedIndex.ToLocate(newToMerged[newIndex.ToId(locate)]);
+		};
+
+		/** fence只使用新图中的，两张图中都存在的pass之间的fence才记录变化 */
+		diff.fences.clear();
+		std::vector<uint32_t> oldDeps, newDeps;
+		for (uint32_t mergedId = 0; mergedId < mergedIndex.PassCount(); ++mergedId) {
+			PassLocate locate = mergedIndex.ToLocate(mergedId);
+			Pass& pass = diff.passMap[locate.queueIndex][locate.inqueueIndex];
+			const PassLocate& newLocate = diff.newPasses[mergedId];
+			const PassLocate& oldLocate = diff.oldPasses[mergedId];
+			if (newLocate == INVALID_PASS_LOCATE) continue;
+			for (const auto& dep : newPassMap[newLocate.queueIndex][newLocate.inqueueIndex].depPasses)
+				pass.depPasses.push_back(newToMergedLocate(dep));
+			if (oldLocate == INVALID_PASS_LOCATE) continue;
+			auto collect = [&](std::vector<uint32_t>& deps, const FenceSignalPasses& signals, bool fromOld) {
+				deps.clear();
+				for (const auto& signal : signals) {
+					uint32_t signalId = fromOld ? oldToMerged[oldIndex.ToId(signal)] : newToMerged[newIndex.ToId(signal)];
+					if (diff.oldPasses[signalId] != INVALID_PASS_LOCATE && diff.newPasses[signalId] != INVALID_PASS_LOCATE)
+						deps.push_back(signalId);
+				}
+				std::sort(deps.begin(), deps.end());
+				deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+			};
+			collect(oldDeps, oldPassMap[oldLocate.queueIndex][oldLocate.inqueueIndex].depPasses, true);
+			collect(newDeps, newPassMap[newLocate.queueIndex][newLocate.inqueueIndex].depPasses, false);
+			size_t oldPos = 0, newPos = 0;
+			while (oldPos < oldDeps.size() || newPos < newDeps.size()) {
+				if (newPos == newDeps.size() || (oldPos < oldDeps.size() && oldDeps[oldPos] < newDeps[newPos])) {
+					diff.fences.push_back({ mergedIndex.ToLocate(oldDeps[oldPos++]), locate, false });
+				}
+				else if (oldPos == oldDeps.size() || newDeps[newPos] < oldDeps[oldPos]) {
+					diff.fences.push_back({ mergedIndex.ToLocate(newDeps[newPos++]), locate, true });
+				}
+				else {
+					++oldPos;
+					++newPos;
+				}
+			}
+		}
+
+		/** 资源按名称以及同名资源的出现顺序配对 */
+		std::unordered_map<std::string, NameQueue> oldResources;
+		for (ResourceIdx resIdx = 0; resIdx < oldResMap.size(); ++resIdx) {
+			NameQueue& pending = oldResources[oldResMap[resIdx].name];
+			if (pending.ids.empty()) pending.next = 0;
+			pending.ids.push_back(resIdx);
+		}
+		auto remapResource = [](Resource& resource, const std::function<PassLocate(const PassLocate&)>& remap) {
+			resource.firstCreate = remap(resource.firstCreate);
+			resource.lastDestroy = remap(resource.lastDestroy);
+			for (auto& pass : resource.readPasses) pass = remap(pass);
+			for (auto& pass : resource.writedPasses) pass = remap(pass);
+			for (auto& barrier : resource.barriers) barrier.submitPass = remap(barrier.submitPass);
+			resource.frame = 0;
+		};
+		std::function<PassLocate(const PassLocate&)> remapOld = oldToMergedLocate, remapNew = newToMergedLocate;
+		diff.resMap.clear();
+		diff.resourceOrigins.clear();
+		diff.barriers.clear();
+		diff.addedResources = diff.removedResources = 0;
+		std::vector<uint8_t> oldMatched(oldResMap.size(), 0);
+		std::vector<BarrierKey> oldKeys, newKeys;
+		for (ResourceIdx resIdx = 0; resIdx < newResMap.size(); ++resIdx) {
+			ResourceIdx mergedIdx = static_cast<ResourceIdx>(diff.resMap.size());
+			diff.resMap.push_back(newResMap[resIdx]);
+			remapResource(diff.resMap.back(), remapNew);
+			auto pending = oldResources.find(newResMap[resIdx].name);
+			if (pending == oldResources.end() || pending->second.next == pending->second.ids.size()) {
+				diff.resourceOrigins.push_back({ INVALID_INDEX, resIdx });
+				++diff.addedResources;
+				continue;
+			}
+			ResourceIdx oldIdx = pending->second.ids[pending->second.next++];
+			oldMatched[oldIdx] = 1;
+			diff.resourceOrigins.push_back({ oldIdx, resIdx });
+			auto collect = [&](std::vector<BarrierKey>& keys, const Resource& resource, const std::vector<uint32_t>& toMerged,
+				const PassIndex& index) {
+				keys.clear();
+				for (uint32_t barrierIdx = 0; barrierIdx < resource.barriers.size(); ++barrierIdx) {
+					const Barrier& barrier = resource.barriers[barrierIdx];
+					keys.push_back({ toMerged[index.ToId(barrier.submitPass)], barrier.stateBefore, barrier.stateAfter,
+						barrier.flags, barrierIdx });
+				}
+				std::sort(keys.begin(), keys.end());
+			};
+			collect(oldKeys, oldResMap[oldIdx], oldToMerged, oldIndex);
+			collect(newKeys, newResMap[resIdx], newToMerged, newIndex);
+			auto record = [&](const Resource& resource, const BarrierKey& key, bool added) {
+				Barrier barrier = resource.barriers[key.barrierIdx];
+				barrier.submitPass = mergedIndex.ToLocate(key.pass);
+				diff.barriers.push_back({ mergedIdx, barrier, added });
+			};
+			size_t oldPos = 0, newPos = 0;
+			while (oldPos < oldKeys.size() || newPos < newKeys.size()) {
+				if (newPos == newKeys.size() || (oldPos < oldKeys.size() && oldKeys[oldPos] < newKeys[newPos]))
+					record(oldResMap[oldIdx], oldKeys[oldPos++], false);
+				else if (oldPos == oldKeys.size() || newKeys[newPos] < oldKeys[oldPos])
+					record(newResMap[resIdx], newKeys[newPos++], true);
+				else {
+					++oldPos;
+					++newPos;
+				}
+			}
+		}
+		for (ResourceIdx oldIdx = 0; oldIdx < oldResMap.size(); ++oldIdx) {
+			if (oldMatched[oldIdx]) continue;
+			diff.resMap.push_back(oldResMap[oldIdx]);
+			remapResource(diff.resMap.back(), remapOld);
+			diff.resourceOrigins.push_back({ oldIdx, INVALID_INDEX });
+			++diff.removedResources;
+		}
+		diff.oldSpan = spanHelper(oldPassMap);
+		diff.newSpan = spanHelper(newPassMap);
+		return true;
+	}
+
+	void HighlightGraphDiff(PipelineGraph& graph, const GraphDiff& diff)
+	{
+		const auto& passMap = graph.GetPassMap();
+		PassIndex mergedIndex(passMap);
+		std::vector<uint32_t> timed; /**< 两张图中都记录了时间的pass的编号 */
+		uint32_t mergedId = 0;
+		char note[160];
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx, ++mergedId) {
+				PassLocate locate = { queIdx, passIdx };
+				const PassLocate& oldLocate = diff.oldPasses[mergedId];
+				switch (diff.passChanges[mergedId]) {
+				case GraphDiff::PASS_ADDED:
+					graph.MarkPass(locate, Rectangle::ADDED, "added");
+					break;
+				case GraphDiff::PASS_REMOVED:
+					graph.MarkPass(locate, Rectangle::REMOVED, "removed");
+					break;
+				case GraphDiff::PASS_MOVED:
+					std::snprintf(note, sizeof(note), "moved from queue %u #%u", oldLocate.queueIndex, oldLocate.inqueueIndex);
+					graph.MarkPass(locate, Rectangle::HIGHLIGHT, note);
+					break;
+				default:
+					break;
+				}
+				uint64_t oldDuration = diff.oldDurations[mergedId], newDuration = diff.newDurations[mergedId];
+				if (oldDuration == INVALID_TIMESTAMP || newDuration == INVALID_TIMESTAMP) continue;
+				timed.push_back(mergedId);
+				double change = static_cast<double>(newDuration) - static_cast<double>(oldDuration);
+				std::snprintf(note, sizeof(note), "duration %s us -> %s us (%+.3f us, %+.1f%%)",
+					microseconds(oldDuration).c_str(), microseconds(newDuration).c_str(), change / 1000.0,
+					oldDuration ? change / static_cast<double>(oldDuration) * 100.0 : 0.0);
+				graph.MarkPass(locate, 0, note);
+			}
+		}
+
+		for (const auto& fence : diff.fences) {
+			Arrow arrow = graph.GetFenceArrow(fence.signal, fence.wait);
+			arrow.type = fence.added ? Arrow::FENCE_ADDED : Arrow::FENCE_REMOVED;
+			arrow.desc = std::string(fence.added ? "added fence: " : "removed fence: ")
+				+ passMap[fence.signal.queueIndex][fence.signal.inqueueIndex].name + " -> "
+				+ passMap[fence.wait.queueIndex][fence.wait.inqueueIndex].name;
+			graph.AddOverlay(arrow);
+		}
+		for (ResourceIdx resIdx = 0; resIdx < diff.resourceOrigins.size(); ++resIdx) {
+			if (diff.resourceOrigins[resIdx].oldIdx == INVALID_INDEX)
+				graph.MarkResource(resIdx, Rectangle::ADDED, "added");
+			else if (diff.resourceOrigins[resIdx].newIdx == INVALID_INDEX)
+				graph.MarkResource(resIdx, Rectangle::REMOVED, "removed");
+		}
+		for (const auto& change : diff.barriers) {
+			const Pass& pass = passMap[change.barrier.submitPass.queueIndex][change.barrier.submitPass.inqueueIndex];
+			graph.MarkResource(change.resource, Rectangle::HIGHLIGHT, std::string(change.added ? "added barrier " : "removed barrier ")
+				+ change.barrier.description + " at " + pass.name);
+		}
+
+		/** 汇总以及持续时间变化最大的pass */
+		auto absoluteChange = [&diff](uint32_t id) {
+			return std::llabs(static_cast<long long>(diff.newDurations[id]) - static_cast<long long>(diff.oldDurations[id]));
+		};
+		const size_t TABLE_ROWS = 10;
+		size_t rows = std::min(timed.size(), TABLE_ROWS);
+		std::partial_sort(timed.begin(), timed.begin() + rows, timed.end(), [&](uint32_t lhs, uint32_t rhs) {
+			return absoluteChange(lhs) > absoluteChange(rhs);
+		});
+		size_t addedFences = 0, addedBarriers = 0;
+		for (const auto& fence : diff.fences) addedFences += fence.added;
+		for (const auto& barrier : diff.barriers) addedBarriers += barrier.added;
+		std::vector<std::string> lines;
+		char line[256];
+		std::snprintf(line, sizeof(line), "passes +%zu -%zu moved %zu, resources +%zu -%zu, fences +%zu -%zu, barriers +%zu -%zu",
+			diff.addedPasses, diff.removedPasses, diff.movedPasses, diff.addedResources, diff.removedResources,
+			addedFences, diff.fences.size() - addedFences, addedBarriers, diff.barriers.size() - addedBarriers);
+		lines.push_back(line);
+		std::snprintf(line, sizeof(line), "timed span %s us -> %s us", microseconds(diff.oldSpan).c_str(),
+			microseconds(diff.newSpan).c_str());
+		lines.push_back(line);
+		if (rows) {
+			std::snprintf(line, sizeof(line), "%-24s %12s %12s %12s", "pass", "old(us)", "new(us)", "delta(us)");
+			lines.push_back(line);
+		}
+		for (size_t row = 0; row < rows; ++row) {
+			uint32_t id = timed[row];
+			PassLocate locate = mergedIndex.ToLocate(id);
+			double change = static_cast<double>(diff.newDurations[id]) - static_cast<double>(diff.oldDurations[id]);
+			std::snprintf(line, sizeof(line), "%-24.24s %12s %12s %+12.3f",
+				passMap[locate.queueIndex][locate.inqueueIndex].name.c_str(),
+				microseconds(diff.oldDurations[id]).c_str(), microseconds(diff.newDurations[id]).c_str(), change / 1000.0);
+			lines.push_back(line);
+		}
+		float top = graph.GetContentBottom() + QUEUE_PADDING;
+		for (size_t lineIdx = 0; lineIdx < lines.size(); ++lineIdx)
+			graph.AddOverlay(Label{ { LEFT_MARGIN, top + lineIdx * LABEL_LINE_HEIGHT }, lines[lineIdx] });
+	}
+
+}
@@ -0,0 +1,78 @@
+#ifndef GRAPH_DIFF_H
+#define GRAPH_DIFF_H
+
+#include "ppfg.h"
+
+/** 比较两张渲染图，找出增加、删除与移动的pass，变化的fence与barrier，以及每个pass持续时间的变化
+ * 同一queue中的pass按名称做序列对齐(Myers差分算法，使用线性空间的分治实现)，对齐上的pass视为同一个pass；
+ * 之后剩下的pass中名称相同的按出现顺序配对，视为移动了位置；资源按名称以及同名资源的出现顺序配对
+ * 比较的结果是一张合并后的图: 每个queue中按对齐的顺序包含两张图中所有的pass，被删除的pass插在其原来的位置，
+ * 移动的pass只出现在新的位置；fence只使用新图中的fence，被删除的fence只以箭头画出，保证合并后的图没有环 */
+namespace PipelineProfilingGraph {
+
+	/** 合并后的资源在两张图中对应的资源 */
+	struct DiffOrigin {
+		ResourceIdx oldIdx; /**< 在旧图中的索引，不存在时为INVALID_INDEX */
+		ResourceIdx newIdx; /**< 在新图中的索引，不存在时为INVALID_INDEX */
+	};
+
+	/** 两张图中都存在的两个pass之间增加或删除的fence，位置为合并后的图中的位置 */
+	struct FenceChange {
+		PassLocate signal;
+		PassLocate wait;
+		bool added; /**< 为false时表示被删除 */
+	};
+
+	/** 两张图中都存在的资源上增加或删除的barrier */
+	struct BarrierChange {
+		ResourceIdx resource; /**< 合并后的图中的资源索引 */
+		Barrier barrier; /**< 变化的barrier，提交的pass为合并后的图中的位置 */
+		bool added; /**< 为false时表示被删除 */
+	};
+
+	struct GraphDiff {
+		enum PassChange : uint8_t {
+			PASS_MATCHED, /**< 两张图中位置对齐的pass */
+			PASS_MOVED, /**< 两张图中都存在，但是不在对齐的位置上，例如换了queue或者调整了顺序 */
+			PASS_ADDED, /**< 只存在于新图中 */
+			PASS_REMOVED, /**< 只存在于旧图中 */
+		};
+		std::vector<Queue> passMap; /**< 合并后的pass，可以直接用于构造PipelineGraph */
+		std::vector<Resource> resMap; /**< 合并后的资源，新图中的资源在前，被删除的资源在后 */
+		std::vector<PassLocate> oldPasses; /**< 以合并后的pass编号(见PassIndex)为索引的在旧图中的位置，不存在时为INVALID_PASS_LOCATE */
+		std::vector<PassLocate> newPasses; /**< 以合并后的pass编号为索引的在新图中的位置，不存在时为INVALID_PASS_LOCATE */
+		std::vector<DiffOrigin> resourceOrigins; /**< 以合并后的资源索引为索引 */
+		std::vector<uint8_t> passChanges; /**< 以合并后的pass编号为索引的PassChange */
+		std::vector<uint64_t> oldDurations; /**< 以合并后的pass编号为索引的旧图中的持续时间，没有记录时为INVALID_TIMESTAMP */
+		std::vector<uint64_t> newDurations; /**< 以合并后的pass编号为索引的新图中的持续时间，没有记录时为INVALID_TIMESTAMP */
+		uint64_t oldSpan; /**< 旧图中最早的开始时间到最晚的结束时间，没有记录时间的pass时为0 */
+		uint64_t newSpan; /**< 新图中最早的开始时间到最晚的结束时间 */
+		std::vector<FenceChange> fences;
+		std::vector<BarrierChange> barriers;
+		size_t addedPasses;
+		size_t removedPasses;
+		size_t movedPasses;
+		size_t addedResources;
+		size_t removedResources;
+	};
+
+	/** 比较两张渲染图
+	 * @param oldPassMap 旧图中所有的pass
+	 * @param oldResMap 旧图中所有的资源
+	 * @param newPassMap 新图中所有的pass
+	 * @param newResMap 新图中所有的资源
+	 * @param diff 比较的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 图中引用了未知的pass或者新图的fence之间存在环时返回false */
+	bool DiffGraphs(const std::vector<Queue>& oldPassMap, const std::vector<Resource>& oldResMap,
+		const std::vector<Queue>& newPassMap, const std::vector<Resource>& newResMap,
+		GraphDiff& diff, std::string* error = nullptr);
+	/** 在合并后的图中标出比较的结果: 增加与删除的pass和资源分别使用ADDED与REMOVED标记，移动的pass突出显示，
+	 * 增加与删除的fence画成箭头，barrier有变化的资源突出显示，pass与资源的描述中加入具体的变化，
+	 * 并在图的下方加入汇总以及持续时间变化最大的pass
+	 * @remark graph必须由diff中合并后的图构造，调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightGraphDiff(PipelineGraph& graph, const GraphDiff& diff);
+
+}
+
+#endif // GRAPH_DIFF_H
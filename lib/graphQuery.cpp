@@ -0,0 +1,129 @@
+#include "ppfg.h"
+
+/** PipelineGraph中查询索引的建立与查询 */
+namespace PipelineProfilingGraph {
+
+	void PipelineGraph::buildQueryIndexHelper()
+	{
+		m_queryPassOffsets.assign(1, 0);
+		for (const auto& queue : m_passMap)
+			m_queryPassOffsets.push_back(m_queryPassOffsets.back() + static_cast<uint32_t>(queue.size()));
+		const uint32_t passCount = m_queryPassOffsets.back();
+		auto passId = [this](const PassLocate& locate) {
+			return m_queryPassOffsets[locate.queueIndex] + locate.inqueueIndex;
+		};
+
+		/** 先统计每个pass的访问数量，按资源的顺序填入后再合并同一资源的多次访问 */
+		m_passAccessOffsets.assign(passCount + 1, 0);
+		m_passBarrierOffsets.assign(passCount + 1, 0);
+		for (const auto& resource : m_resourceMap) {
+			for (const auto& read : resource.readPasses) ++m_passAccessOffsets[passId(read) + 1];
+			for (const auto& write : resource.writedPasses) ++m_passAccessOffsets[passId(write) + 1];
+			if (resource.firstCreate != INVALID_PASS_LOCATE) ++m_passAccessOffsets[passId(resource.firstCreate) + 1];
+			if (resource.lastDestroy != INVALID_PASS_LOCATE) ++m_passAccessOffsets[passId(resource.lastDestroy) + 1];
+			for (const auto& barrier : resource.barriers) ++m_passBarrierOffsets[passId(barrier.submitPass) + 1];
+		}
+		for (uint32_t id = 0; id < passCount; ++id) {
+			m_passAccessOffsets[id + 1] += m_passAccessOffsets[id];
+			m_passBarrierOffsets[id + 1] += m_passBarrierOffsets[id];
+		}
+		m_passAccesses.resize(m_passAccessOffsets.back());
+		m_passBarriers.resize(m_passBarrierOffsets.back());
+		std::vector<uint32_t> accessCursor(m_passAccessOffsets.begin(), m_passAccessOffsets.end() - 1);
+		std::vector<uint32_t> barrierCursor(m_passBarrierOffsets.begin(), m_passBarrierOffsets.end() - 1);
+		for (ResourceIdx resIdx = 0; resIdx < m_resourceMap.size(); ++resIdx) {
+			const Resource& resource = m_resourceMap[resIdx];
+			auto add = [&](const PassLocate& locate, uint8_t access) {
+				m_passAccesses[accessCursor[passId(locate)]++] = { resIdx, access };
+			};
+			for (const auto& read : resource.readPasses) add(read, PassResourceAccess::READ);
+			for (const auto& write : resource.writedPasses) add(write, PassResourceAccess::WRITE);
+			if (resource.firstCreate != INVALID_PASS_LOCATE) add(resource.firstCreate, PassResourceAccess::CREATE);
+			if (resource.lastDestroy != INVALID_PASS_LOCATE) add(resource.lastDestroy, PassResourceAccess::DESTROY);
+			for (uint32_t barrierIdx = 0; barrierIdx < resource.barriers.size(); ++barrierIdx)
+				m_passBarriers[barrierCursor[passId(resource.barriers[barrierIdx].submitPass)]++] = { resIdx, barrierIdx };
+		}
+		/** 同一资源的访问在每个pass的列表中是相邻的 */
+		uint32_t count = 0;
+		for (uint32_t id = 0; id < passCount; ++id) {
+			uint32_t begin = m_passAccessOffsets[id], end = m_passAccessOffsets[id + 1];
+			m_passAccessOffsets[id] = count;
+			for (uint32_t accessIdx = begin; accessIdx < end; ++accessIdx) {
+				const PassResourceAccess& access = m_passAccesses[accessIdx];
+				if (count != m_passAccessOffsets[id] && m_passAccesses[count - 1].resource == access.resource)
+					m_passAccesses[count - 1].access |= access.access;
+				else
+					m_passAccesses[count++] = access;
+			}
+		}
+		m_passAccessOffsets[passCount] = count;
+		m_passAccesses.resize(count);
+
+		/** 名称索引: 哈希表记录第一个同名元素，其余同名元素串成链表，倒序插入使链表保持升序 */
+		m_passNames.clear();
+		m_passNames.reserve(passCount);
+		m_nextSamePassName.assign(passCount, INVALID_INDEX);
+		for (QueueIdx queIdx = static_cast<QueueIdx>(m_passMap.size()); queIdx-- > 0;) {
+			for (PassIdx passIdx = static_cast<PassIdx>(m_passMap[queIdx].size()); passIdx-- > 0;) {
+				uint32_t id = m_queryPassOffsets[queIdx] + passIdx;
+				auto inserted = m_passNames.insert(std::make_pair(m_passMap[queIdx][passIdx].name, id));
+				if (!inserted.second) {
+					m_nextSamePassName[id] = inserted.first->second;
+					inserted.first->second = id;
+				}
+			}
+		}
+		m_resourceNames.clear();
+		m_resourceNames.reserve(m_resourceMap.size());
+		m_nextSameResourceName.assign(m_resourceMap.size(), INVALID_INDEX);
+		for (ResourceIdx resIdx = static_cast<ResourceIdx>(m_resourceMap.size()); resIdx-- > 0;) {
+			auto inserted = m_resourceNames.insert(std::make_pair(m_resourceMap[resIdx].name, resIdx));
+			if (!inserted.second) {
+				m_nextSameResourceName[resIdx] = inserted.first->second;
+				inserted.first->second = resIdx;
+			}
+		}
+	}
+
+	uint32_t PipelineGraph::findNameHelper(const std::unordered_map<std::string, uint32_t>& heads,
+		const char* name) const
+	{
+		auto found = heads.find(name ? name : "");
+		return found == heads.end() ? INVALID_INDEX : found->second;
+	}
+
+	PassLocate PipelineGraph::FindPass(const char* name) const
+	{
+		uint32_t id = findNameHelper(m_passNames, name);
+		if (id == INVALID_INDEX) return INVALID_PASS_LOCATE;
+		/** 同名链表中的第一个即位置最靠前的pass */
+		for (QueueIdx queIdx = 0; ; ++queIdx)
+			if (id < m_queryPassOffsets[queIdx + 1]) return { queIdx, id - m_queryPassOffsets[queIdx] };
+	}
+
+	bool PipelineGraph::FindPasses(const char* name, std::vector<PassLocate>& passes) const
+	{
+		passes.clear();
+		QueueIdx queIdx = 0;
+		for (uint32_t id = findNameHelper(m_passNames, name); id != INVALID_INDEX; id = m_nextSamePassName[id]) {
+			while (id >= m_queryPassOffsets[queIdx + 1]) ++queIdx;
+			passes.push_back({ queIdx, id - m_queryPassOffsets[queIdx] });
+		}
+		return !passes.empty();
+	}
+
+	ResourceIdx PipelineGraph::FindResource(const char* name) const
+	{
+		return findNameHelper(m_resourceNames, name);
+	}
+
+	bool PipelineGraph::FindResources(const char* name, std::vector<ResourceIdx>& resources) const
+	{
+		resources.clear();
+		for (uint32_t resIdx = findNameHelper(m_resourceNames, name); resIdx != INVALID_INDEX;
+			resIdx = m_nextSameResourceName[resIdx])
+			resources.push_back(resIdx);
+		return !resources.empty();
+	}
+
+}
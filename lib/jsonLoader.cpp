@@ -0,0 +1,387 @@
+#include "jsonLoader.h"
+#include "jsonReader.h"
+#include "passOrder.h"
+#include "resourceState.h"
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		struct FlagName {
+			const char* name;
+			uint8_t flag;
+		};
+		const FlagName FLAG_NAMES[] = {
+			{ "TRANSITION_BARRIER", Barrier::TRANSITION_BARRIER },
+			{ "ALIASING_BARRIER", Barrier::ALIASING_BARRIER },
+			{ "UAV_BARRIER", Barrier::UAV_BARRIER },
+			{ "IMMEDIACY", Barrier::IMMEDIACY },
+			{ "BEGIN", Barrier::BEGIN },
+			{ "END", Barrier::END },
+		};
+
+		/** 边读取token边写入pass与资源，不保存中间结构 */
+		class GraphJsonParser {
+		public:
+			GraphJsonParser(char* buffer, size_t size, std::vector<Queue>& passMap,
+				std::vector<Resource>& resMap)
+				: m_reader(buffer, size), m_passMap(passMap), m_resMap(resMap) {}
+
+			bool Parse() {
+				if (m_reader.Next() != JsonReader::BEGIN_OBJECT) return fail("expect an object");
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_OBJECT) break;
+					if (token != JsonReader::STRING) return fail("expect a key");
+					if (m_reader.StringEquals("queues")) {
+						if (!parseQueues()) return false;
+					}
+					else if (m_reader.StringEquals("resources")) {
+						if (!parseResources()) return false;
+					}
+					else if (!m_reader.SkipValue(m_reader.Next())) {
+						return fail("invalid value");
+					}
+				}
+				return true;
+			}
+			const std::string& Error() const { return m_error; }
+		private:
+			bool fail(const char* reason) {
+				m_error = std::string(reason) + " at line " + std::to_string(m_reader.Line())
+					+ " (offset " + std::to_string(m_reader.Offset()) + ")";
+				return false;
+			}
+			bool expect(JsonReader::Token expected, const char* reason) {
+				return m_reader.Next() == expected ? true : fail(reason);
+			}
+			/** 读取一个不超过maxValue的非负整数，负数、小数以及超出范围的数值都视为错误 */
+			bool expectUInt(const char* reason, uint64_t maxValue = UINT64_MAX) {
+				return m_reader.Next() == JsonReader::NUMBER && isUInt(maxValue) ? true : fail(reason);
+			}
+			bool isUInt(uint64_t maxValue) const {
+				return m_reader.IsUInt() && m_reader.UInt() <= maxValue;
+			}
+			/** 读取[queue, index]形式的pass位置，允许为null */
+			bool parseLocate(JsonReader::Token first, PassLocate& locate) {
+				if (first == JsonReader::NULL_VALUE) {
+					locate = INVALID_PASS_LOCATE;
+					return true;
+				}
+				if (first != JsonReader::BEGIN_ARRAY) return fail("expect a pass locate");
+				if (!expectUInt("expect a queue index", INVALID_INDEX - 1)) return false;
+				locate.queueIndex = static_cast<QueueIdx>(m_reader.UInt());
+				if (!expectUInt("expect a pass index", INVALID_INDEX - 1)) return false;
+				locate.inqueueIndex = static_cast<PassIdx>(m_reader.UInt());
+				return expect(JsonReader::END_ARRAY, "expect end of pass locate");
+			}
+			bool parseLocateArray(std::vector<PassLocate>& locates) {
+				if (!expect(JsonReader::BEGIN_ARRAY, "expect an array of pass locates")) return false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					PassLocate locate;
+					if (!parseLocate(token, locate)) return false;
+					locates.push_back(locate);
+				}
+			}
+			bool parseQueues() {
+				if (!expect(JsonReader::BEGIN_ARRAY, "expect an array of queues")) return false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::BEGIN_ARRAY) return fail("expect an array of passes");
+					QueueIdx queIdx = static_cast<QueueIdx>(m_passMap.size());
+					m_passMap.push_back(Queue());
+					while (true) {
+						token = m_reader.Next();
+						if (token == JsonReader::END_ARRAY) break;
+						if (token != JsonReader::BEGIN_OBJECT) return fail("expect a pass");
+						if (!parsePass(queIdx)) return false;
+					}
+				}
+			}
+			bool parsePass(QueueIdx queIdx) {
+				Queue& queue = m_passMap[queIdx];
+				queue.push_back(Pass("", queIdx, static_cast<PassIdx>(queue.size()), FenceSignalPasses()));
+				Pass& pass = queue.back();
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_OBJECT) {
+						/** 起止时间必须同时给出 */
+						if ((pass.startTime == INVALID_TIMESTAMP) != (pass.endTime == INVALID_TIMESTAMP)
+							|| (pass.startTime != INVALID_TIMESTAMP && pass.endTime < pass.startTime))
+							return fail("invalid pass timing");
+						return true;
+					}
+					if (token != JsonReader::STRING) return fail("expect a key");
+					if (m_reader.StringEquals("name")) {
+						if (!expect(JsonReader::STRING, "expect a pass name")) return false;
+						pass.name.assign(m_reader.String(), m_reader.StringSize());
+					}
+					else if (m_reader.StringEquals("fences")) {
+						if (!parseLocateArray(pass.depPasses)) return false;
+					}
+					else if (m_reader.StringEquals("start")) {
+						if (!expectUInt("expect a start timestamp")) return false;
+						pass.startTime = m_reader.UInt();
+					}
+					else if (m_reader.StringEquals("end")) {
+						if (!expectUInt("expect an end timestamp")) return false;
+						pass.endTime = m_reader.UInt();
+					}
+					else if (!m_reader.SkipValue(m_reader.Next())) {
+						return fail("invalid value");
+					}
+				}
+			}
+			bool parseResources() {
+				if (!expect(JsonReader::BEGIN_ARRAY, "expect an array of resources")) return false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::BEGIN_OBJECT) return fail("expect a resource");
+					m_resMap.push_back(Resource());
+					Resource& resource = m_resMap.back();
+					resource.firstCreate = INVALID_PASS_LOCATE;
+					resource.lastDestroy = INVALID_PASS_LOCATE;
+					if (!parseResource(resource)) return false;
+				}
+			}
+			bool parseResource(Resource& resource) {
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_OBJECT) return true;
+					if (token != JsonReader::STRING) return fail("expect a key");
+					bool succeed = true;
+					if (m_reader.StringEquals("name")) {
+						succeed = expect(JsonReader::STRING, "expect a resource name");
+						if (succeed) resource.name.assign(m_reader.String(), m_reader.StringSize());
+					}
+					else if (m_reader.StringEquals("create"))
+						succeed = parseLocate(m_reader.Next(), resource.firstCreate);
+					else if (m_reader.StringEquals("destroy"))
+						succeed = parseLocate(m_reader.Next(), resource.lastDestroy);
+					else if (m_reader.StringEquals("reads"))
+						succeed = parseLocateArray(resource.readPasses);
+					else if (m_reader.StringEquals("writes"))
+						succeed = parseLocateArray(resource.writedPasses);
+					else if (m_reader.StringEquals("readStates"))
+						succeed = parseStateArray(resource.readStates);
+					else if (m_reader.StringEquals("writeStates"))
+						succeed = parseStateArray(resource.writeStates);
+					else if (m_reader.StringEquals("barriers"))
+						succeed = parseBarriers(resource.barriers);
+					else if (m_reader.StringEquals("size")) {
+						succeed = expectUInt("expect a resource size");
+						if (succeed) resource.size = m_reader.UInt();
+					}
+					else if (m_reader.StringEquals("alignment")) {
+						succeed = expectUInt("expect a resource alignment", UINT32_MAX);
+						if (succeed) resource.alignment = static_cast<uint32_t>(m_reader.UInt());
+						if (succeed && (resource.alignment & (resource.alignment - 1)) != 0)
+							succeed = fail("alignment should be a power of two");
+					}
+					else if (m_reader.StringEquals("heap"))
+						succeed = parseHeapType(m_reader.Next(), resource.heapType);
+					else if (!m_reader.SkipValue(m_reader.Next()))
+						succeed = fail("invalid value");
+					if (!succeed) return false;
+				}
+			}
+			bool parseBarriers(std::vector<Barrier>& barriers) {
+				if (!expect(JsonReader::BEGIN_ARRAY, "expect an array of barriers")) return false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::BEGIN_OBJECT) return fail("expect a barrier");
+					barriers.push_back(Barrier(INVALID_PASS_LOCATE, "", 0));
+					Barrier& barrier = barriers.back();
+					while (true) {
+						token = m_reader.Next();
+						if (token == JsonReader::END_OBJECT) break;
+						if (token != JsonReader::STRING) return fail("expect a key");
+						if (m_reader.StringEquals("pass")) {
+							if (!parseLocate(m_reader.Next(), barrier.submitPass)) return false;
+						}
+						else if (m_reader.StringEquals("desc")) {
+							if (!expect(JsonReader::STRING, "expect a barrier description")) return false;
+							barrier.description.assign(m_reader.String(), m_reader.StringSize());
+						}
+						else if (m_reader.StringEquals("flags")) {
+							if (!parseFlags(barrier.flags)) return false;
+						}
+						else if (m_reader.StringEquals("before")) {
+							if (!parseState(m_reader.Next(), barrier.stateBefore)) return false;
+						}
+						else if (m_reader.StringEquals("after")) {
+							if (!parseState(m_reader.Next(), barrier.stateAfter)) return false;
+						}
+						else if (!m_reader.SkipValue(m_reader.Next())) {
+							return fail("invalid value");
+						}
+					}
+					if (barrier.submitPass == INVALID_PASS_LOCATE) return fail("barrier without submit pass");
+				}
+			}
+			bool parseFlags(uint8_t& flags) {
+				JsonReader::Token token = m_reader.Next();
+				if (token == JsonReader::NUMBER) {
+					if (!isUInt(UINT8_MAX)) return fail("expect barrier flags");
+					flags = static_cast<uint8_t>(m_reader.UInt());
+					return true;
+				}
+				if (token != JsonReader::BEGIN_ARRAY) return fail("expect barrier flags");
+				flags = 0;
+				while (true) {
+					token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::STRING) return fail("expect a barrier flag name");
+					bool found = false;
+					for (const auto& flagName : FLAG_NAMES) {
+						if (m_reader.StringEquals(flagName.name)) {
+							flags |= flagName.flag;
+							found = true;
+							break;
+						}
+					}
+					if (!found) return fail("unknown barrier flag");
+				}
+			}
+			/** 读取资源状态，可以是"SHADER_RESOURCE|DEPTH_READ"形式的名称、名称数组或者ResourceState的数值 */
+			bool parseState(JsonReader::Token token, uint16_t& state) {
+				if (token == JsonReader::NUMBER) {
+					if (!isUInt(UINT16_MAX)) return fail("expect a resource state");
+					state = static_cast<uint16_t>(m_reader.UInt());
+					return true;
+				}
+				state = STATE_COMMON;
+				bool isArray = token == JsonReader::BEGIN_ARRAY;
+				if (isArray) token = m_reader.Next();
+				while (token == JsonReader::STRING) {
+					const char* name = m_reader.String();
+					const char* end = name + m_reader.StringSize();
+					while (name <= end) {
+						const char* separator = name;
+						while (separator < end && *separator != '|') ++separator;
+						uint16_t single = STATE_COMMON;
+						if (!FindResourceState(name, static_cast<size_t>(separator - name), single))
+							return fail("unknown resource state");
+						state |= single;
+						name = separator + 1;
+					}
+					if (!isArray) return true;
+					token = m_reader.Next();
+				}
+				return isArray && token == JsonReader::END_ARRAY ? true : fail("expect a resource state");
+			}
+			/** 读取堆类型，可以是HEAP_TYPE_NAMES中的名称或者HeapType的数值 */
+			bool parseHeapType(JsonReader::Token token, uint8_t& heapType) {
+				if (token == JsonReader::NUMBER && isUInt(HEAP_TYPE_COUNT - 1)) {
+					heapType = static_cast<uint8_t>(m_reader.UInt());
+					return true;
+				}
+				if (token == JsonReader::STRING) {
+					for (uint8_t type = 0; type < HEAP_TYPE_COUNT; ++type) {
+						if (m_reader.StringEquals(HEAP_TYPE_NAMES[type])) {
+							heapType = type;
+							return true;
+						}
+					}
+				}
+				return fail("unknown heap type");
+			}
+			bool parseStateArray(std::vector<uint16_t>& states) {
+				if (!expect(JsonReader::BEGIN_ARRAY, "expect an array of resource states")) return false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					uint16_t state = STATE_COMMON;
+					if (!parseState(token, state)) return false;
+					states.push_back(state);
+				}
+			}
+		private:
+			JsonReader m_reader;
+			std::vector<Queue>& m_passMap;
+			std::vector<Resource>& m_resMap;
+			std::string m_error;
+		};
+
+		/** 检查读取到的pass位置是否都在图中，以及fence之间没有环 */
+		bool validateLocates(const std::vector<Queue>& passMap,
+			const std::vector<Resource>& resMap, std::string& error) {
+			auto valid = [&passMap](const PassLocate& locate) {
+				return locate.queueIndex < passMap.size()
+					&& locate.inqueueIndex < passMap[locate.queueIndex].size();
+			};
+			for (const auto& queue : passMap) {
+				for (const auto& pass : queue) {
+					for (const auto& dep : pass.depPasses) {
+						if (!valid(dep)) {
+							error = "pass " + pass.name + " has a fence on an unknown pass";
+							return false;
+						}
+					}
+				}
+			}
+			for (const auto& resource : resMap) {
+				bool succeed = (resource.firstCreate == INVALID_PASS_LOCATE || valid(resource.firstCreate))
+					&& (resource.lastDestroy == INVALID_PASS_LOCATE || valid(resource.lastDestroy));
+				for (const auto& read : resource.readPasses) succeed = succeed && valid(read);
+				for (const auto& write : resource.writedPasses) succeed = succeed && valid(write);
+				for (const auto& barrier : resource.barriers) succeed = succeed && valid(barrier.submitPass);
+				if (!succeed) {
+					error = "resource " + resource.name + " refers to an unknown pass";
+					return false;
+				}
+				if ((!resource.readStates.empty() && resource.readStates.size() != resource.readPasses.size())
+					|| (!resource.writeStates.empty() && resource.writeStates.size() != resource.writedPasses.size())) {
+					error = "resource " + resource.name + " has states that do not match its accesses";
+					return false;
+				}
+			}
+			/** fence之间存在环时Setup无法完成布局 */
+			std::vector<uint32_t> order;
+			return TopologicalOrder(passMap, PassIndex(passMap), order, &error);
+		}
+	}
+
+	bool ParseGraphJson(char* buffer, size_t size, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error)
+	{
+		passMap.clear();
+		resMap.clear();
+		GraphJsonParser parser(buffer, size, passMap, resMap);
+		std::string message;
+		bool succeed = parser.Parse();
+		if (!succeed) message = parser.Error();
+		else succeed = validateLocates(passMap, resMap, message);
+		if (!succeed && error) *error = message;
+		return succeed;
+	}
+
+	bool LoadGraphJson(const char* path, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error)
+	{
+		std::FILE* file = std::fopen(path, "rb");
+		if (!file) {
+			if (error) *error = std::string("cannot open ") + path;
+			return false;
+		}
+		/** 一次性读入整个文件，末尾补'\0' */
+		std::fseek(file, 0, SEEK_END);
+		long size = std::ftell(file);
+		std::fseek(file, 0, SEEK_SET);
+		std::vector<char> buffer(size > 0 ? static_cast<size_t>(size) + 1 : 1, '\0');
+		size_t readSize = size > 0 ? std::fread(buffer.data(), 1, static_cast<size_t>(size), file) : 0;
+		std::fclose(file);
+		if (size < 0 || readSize != static_cast<size_t>(size)) {
+			if (error) *error = std::string("cannot read ") + path;
+			return false;
+		}
+		return ParseGraphJson(buffer.data(), readSize, passMap, resMap, error);
+	}
+
+}
@@ -0,0 +1,50 @@
+#ifndef JSON_LOADER_H
+#define JSON_LOADER_H
+
+#include "ppfg.h"
+
+/** 从JSON文件中读取渲染图
+ * 文件格式如下(未列出的字段会被忽略，pass的位置统一用[queue索引, queue内索引]表示):
+ * {
+ *   "queues": [                             // 每个queue是一个pass数组，pass在数组中的顺序即其在queue中的索引
+ *     [ { "name": "G-Buffer", "start": 1000, "end": 2500 },   // start/end: 可选，GPU上的起止时间戳(纳秒)
+ *       { "name": "lighting", "fences": [[1, 0]] } ],   // fences: 该pass等待的pass
+ *     [ { "name": "SSAO", "fences": [[0, 0]] } ]
+ *   ],
+ *   "resources": [
+ *     { "name": "Depth",
+ *       "create": [0, 0],                   // 创建该资源的pass，null或缺省表示一直存在
+ *       "destroy": [0, 1],                  // 删除该资源的pass，null或缺省表示一直未被删除
+ *       "reads": [[0, 1], [1, 0]],
+ *       "writes": [[0, 0]],
+ *       "readStates": ["DEPTH_READ|SHADER_RESOURCE", "SHADER_RESOURCE"],  // 可选，与reads一一对应
+ *       "writeStates": ["DEPTH_WRITE"],    // 可选，与writes一一对应
+ *       "size": 8388608, "alignment": 65536, "heap": "DEFAULT",   // 可选，占用的字节数、对齐以及所在的堆(见HeapType)
+ *       "barriers": [
+ *         { "pass": [0, 0], "desc": "ba1",
+ *           "flags": ["TRANSITION_BARRIER", "IMMEDIACY"],   // 也可以直接给出Barrier::Flag的数值
+ *           "before": "COMMON", "after": "DEPTH_WRITE" }   // 可选，状态也可以是名称数组或ResourceState的数值
+ *       ] }
+ *   ]
+ * }
+ */
+namespace PipelineProfilingGraph {
+
+	/** 读取JSON格式的渲染图文件
+	 * @param path 文件路径
+	 * @param passMap 读取到的所有pass
+	 * @param resMap 读取到的所有资源
+	 * @param error 读取失败时的错误信息，可以为空
+	 * @return 是否读取成功，pass位置不在图中或者fence之间存在环时同样失败 */
+	bool LoadGraphJson(const char* path, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error = nullptr);
+	/** 从内存中读取JSON格式的渲染图
+	 * @param buffer JSON文本，必须以'\0'结尾，读取过程中会被原地修改
+	 * @param size 文本的长度(不包含结尾的'\0')
+	 * @remark 其余参数同LoadGraphJson */
+	bool ParseGraphJson(char* buffer, size_t size, std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, std::string* error = nullptr);
+
+}
+
+#endif // JSON_LOADER_H
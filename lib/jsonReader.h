@@ -0,0 +1,241 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/** 该文件提供一个流式(pull方式)的JSON词法分析器，以及输出JSON时使用的字符串转义
+ * 分析器直接在传入的缓冲区上原地解码字符串，不构建DOM，也不分配内存 */
+namespace PipelineProfilingGraph {
+
+	class JsonReader {
+	public:
+		enum Token {
+			END_OF_INPUT,
+			BEGIN_OBJECT,
+			END_OBJECT,
+			BEGIN_ARRAY,
+			END_ARRAY,
+			STRING,
+			NUMBER,
+			BOOL_TRUE,
+			BOOL_FALSE,
+			NULL_VALUE,
+			ERROR,
+		};
+		/** @param buffer 需要分析的JSON文本，必须以'\0'结尾且可写，字符串会被原地解码
+		 * @param size 文本的长度(不包含结尾的'\0') */
+		JsonReader(char* buffer, size_t size)
+			: m_begin(buffer), m_cur(buffer), m_end(buffer + size), m_tokenBegin(buffer),
+			m_str(nullptr), m_strSize(0), m_number(0.0), m_uint(0), m_isUInt(false) {}
+
+		/** 读取下一个token，对象与数组中的','以及':'会被跳过 */
+		Token Next() {
+			skipSeparators();
+			if (m_cur >= m_end) return END_OF_INPUT;
+			m_tokenBegin = m_cur;
+			switch (*m_cur) {
+			case '{': ++m_cur; return BEGIN_OBJECT;
+			case '}': ++m_cur; return END_OBJECT;
+			case '[': ++m_cur; return BEGIN_ARRAY;
+			case ']': ++m_cur; return END_ARRAY;
+			case '"': return parseString();
+			case 't': return parseLiteral("true", BOOL_TRUE);
+			case 'f': return parseLiteral("false", BOOL_FALSE);
+			case 'n': return parseLiteral("null", NULL_VALUE);
+			default: return parseNumber();
+			}
+		}
+		/** 跳过一个完整的值
+		 * @param first 该值的第一个token
+		 * @return 是否跳过成功 */
+		bool SkipValue(Token first) {
+			if (first != BEGIN_OBJECT && first != BEGIN_ARRAY)
+				return first != ERROR && first != END_OF_INPUT
+					&& first != END_OBJECT && first != END_ARRAY;
+			uint32_t depth = 1;
+			while (depth) {
+				Token token = Next();
+				if (token == BEGIN_OBJECT || token == BEGIN_ARRAY) ++depth;
+				else if (token == END_OBJECT || token == END_ARRAY) --depth;
+				else if (token == ERROR || token == END_OF_INPUT) return false;
+			}
+			return true;
+		}
+		/** 上一个STRING token的内容，以'\0'结尾 */
+		const char* String() const { return m_str; }
+		size_t StringSize() const { return m_strSize; }
+		bool StringEquals(const char* str) const {
+			size_t index = 0;
+			for (; str[index]; ++index) {
+				if (index >= m_strSize || m_str[index] != str[index]) return false;
+			}
+			return index == m_strSize;
+		}
+		/** 上一个NUMBER token的值 */
+		double Number() const { return m_number; }
+		/** 数值是否为uint64_t能够表示的非负整数 */
+		bool IsUInt() const { return m_isUInt; }
+		/** 数值对应的非负整数，IsUInt()为false时为0 */
+		uint64_t UInt() const { return m_uint; }
+		/** 上一个token在文本中的偏移 */
+		size_t Offset() const { return static_cast<size_t>(m_tokenBegin - m_begin); }
+		/** 上一个token所在的行号(从1开始)，只在出错时使用 */
+		uint32_t Line() const {
+			uint32_t line = 1;
+			for (const char* c = m_begin; c < m_tokenBegin; ++c)
+				if (*c == '\n') ++line;
+			return line;
+		}
+	private:
+		void skipSeparators() {
+			while (m_cur < m_end) {
+				char c = *m_cur;
+				if (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',' || c == ':') ++m_cur;
+				else break;
+			}
+		}
+		Token parseLiteral(const char* literal, Token token) {
+			for (; *literal; ++literal, ++m_cur) {
+				if (m_cur >= m_end || *m_cur != *literal) return ERROR;
+			}
+			return token;
+		}
+		Token parseNumber() {
+			/** 非负整数走快速路径，其余情况交给strtod */
+			char* c = m_cur;
+			uint64_t value = 0;
+			while (c < m_end && *c >= '0' && *c <= '9' && value < UINT64_MAX / 10 - 9) {
+				value = value * 10 + static_cast<uint64_t>(*c - '0');
+				++c;
+			}
+			if (c > m_cur && (c >= m_end || (*c != '.' && *c != 'e' && *c != 'E' && !(*c >= '0' && *c <= '9')))) {
+				m_cur = c;
+				m_uint = value;
+				m_number = static_cast<double>(value);
+				m_isUInt = true;
+				return NUMBER;
+			}
+			char* numberEnd = nullptr;
+			m_number = std::strtod(m_cur, &numberEnd);
+			if (numberEnd == m_cur) return ERROR;
+			m_cur = numberEnd;
+			/** 负数、小数以及超出范围的数值不能转换为uint64_t，18446744073709551616.0即2^64 */
+			m_isUInt = m_number >= 0.0 && m_number < 18446744073709551616.0
+				&& static_cast<double>(static_cast<uint64_t>(m_number)) == m_number;
+			m_uint = m_isUInt ? static_cast<uint64_t>(m_number) : 0;
+			return NUMBER;
+		}
+		Token parseString() {
+			char* dst = ++m_cur;
+			m_str = dst;
+			while (m_cur < m_end) {
+				char c = *m_cur;
+				if (c == '"') {
+					m_strSize = static_cast<size_t>(dst - m_str);
+					*dst = '\0';
+					++m_cur;
+					return STRING;
+				}
+				if (c != '\\') {
+					*dst++ = c;
+					++m_cur;
+					continue;
+				}
+				if (++m_cur >= m_end) return ERROR;
+				switch (*m_cur++) {
+				case '"': *dst++ = '"'; break;
+				case '\\': *dst++ = '\\'; break;
+				case '/': *dst++ = '/'; break;
+				case 'b': *dst++ = '\b'; break;
+				case 'f': *dst++ = '\f'; break;
+				case 'n': *dst++ = '\n'; break;
+				case 'r': *dst++ = '\r'; break;
+				case 't': *dst++ = '\t'; break;
+				case 'u': {
+					uint32_t code = 0;
+					if (!parseHex4(code)) return ERROR;
+					if (code >= 0xD800U && code <= 0xDBFFU) {
+						uint32_t low = 0;
+						if (m_end - m_cur < 2 || m_cur[0] != '\\' || m_cur[1] != 'u') return ERROR;
+						m_cur += 2;
+						if (!parseHex4(low) || low < 0xDC00U || low > 0xDFFFU) return ERROR;
+						code = 0x10000U + ((code - 0xD800U) << 10) + (low - 0xDC00U);
+					}
+					/** UTF-8编码后的长度不会超过转义序列的长度，因此可以原地写入 */
+					if (code < 0x80U) {
+						*dst++ = static_cast<char>(code);
+					}
+					else if (code < 0x800U) {
+						*dst++ = static_cast<char>(0xC0U | (code >> 6));
+						*dst++ = static_cast<char>(0x80U | (code & 0x3FU));
+					}
+					else if (code < 0x10000U) {
+						*dst++ = static_cast<char>(0xE0U | (code >> 12));
+						*dst++ = static_cast<char>(0x80U | ((code >> 6) & 0x3FU));
+						*dst++ = static_cast<char>(0x80U | (code & 0x3FU));
+					}
+					else {
+						*dst++ = static_cast<char>(0xF0U | (code >> 18));
+						*dst++ = static_cast<char>(0x80U | ((code >> 12) & 0x3FU));
+						*dst++ = static_cast<char>(0x80U | ((code >> 6) & 0x3FU));
+						*dst++ = static_cast<char>(0x80U | (code & 0x3FU));
+					}
+					break;
+				}
+				default:
+					return ERROR;
+				}
+			}
+			return ERROR;
+		}
+		bool parseHex4(uint32_t& code) {
+			if (m_end - m_cur < 4) return false;
+			for (uint32_t i = 0; i < 4; ++i) {
+				char c = *m_cur++;
+				code <<= 4;
+				if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+				else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+				else return false;
+			}
+			return true;
+		}
+	private:
+		char* m_begin; /**< 文本的起始位置 */
+		char* m_cur; /**< 当前分析到的位置 */
+		char* m_end; /**< 文本的结束位置 */
+		const char* m_tokenBegin; /**< 上一个token的起始位置 */
+		const char* m_str; /**< 上一个字符串的内容 */
+		size_t m_strSize; /**< 上一个字符串的长度 */
+		double m_number; /**< 上一个数字的值 */
+		uint64_t m_uint; /**< 上一个数字为uint64_t能够表示的非负整数时的精确值 */
+		bool m_isUInt; /**< 上一个数字是否为uint64_t能够表示的非负整数 */
+	};
+
+	/** 转义JSON字符串中的特殊字符 */
+	inline std::string EscapeJson(const std::string& text) {
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char ch : text) {
+			if (ch == '"' || ch == '\\') {
+				escaped.push_back('\\');
+				escaped.push_back(ch);
+			}
+			else if (static_cast<unsigned char>(ch) < 0x20) {
+				char code[8];
+				std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(ch));
+				escaped += code;
+			}
+			else {
+				escaped.push_back(ch);
+			}
+		}
+		return escaped;
+	}
+
+}
+
+#endif // JSON_READER_H
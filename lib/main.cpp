@@ -1,26 +1,843 @@
 #include "ppfg.h"
+#include "perfettoExport.h"
+#include "jsonLoader.h"
+#include "capture.h"
+#include "captureStream.h"
+#include "frameGraphBuilder.h"
+#include "shmTransport.h"
+#include "barrierSynthesis.h"
+#include "fenceInference.h"
+#include "raceDetector.h"
+#include "passCulling.h"
+#include "criticalPath.h"
+#include "queueBubbles.h"
+#include "barrierBatching.h"
+#include "redundantBarriers.h"
+#include "memoryTimeline.h"
+#include "aliasingPlanner.h"
+#include "queueOverlap.h"
+#include "frameAggregation.h"
+#include "graphDiff.h"
+#include "regressionGate.h"
+#include "resourceState.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 using namespace PipelineProfilingGraph;
 
-int main() {
-	Queue q0;
-	q0.push_back(Pass("G-Buffer", 0, 0, {}));
-	q0.push_back(Pass("Shadows", 0, 1, {}));
-	q0.push_back(Pass("lighting", 0, 2, { {1, 0} }));
-	Queue q1;
-	q1.push_back(Pass("SSAO", 1, 0, { {0, 1} }));
+/** 内置的示例渲染图 */
+void buildExample(std::vector<Queue>& passMap, std::vector<Resource>& res) {
+	FrameGraphBuilder builder;
+	builder.Reserve(4, 3, 9, 2, 4);
+	PassHandle gbuffer = builder.AddPass(0, "G-Buffer");
+	PassHandle shadows = builder.AddPass(0, "Shadows");
+	PassHandle lighting = builder.AddPass(0, "lighting");
+	PassHandle ssaoPass = builder.AddPass(1, "SSAO");
+	builder.AddFence(ssaoPass, lighting);
+	builder.AddFence(shadows, ssaoPass);
+	builder.SetPassTime(gbuffer, 0, 1800000);
+	builder.SetPassTime(shadows, 1800000, 2600000);
+	builder.SetPassTime(ssaoPass, 2650000, 3300000);
+	builder.SetPassTime(lighting, 3350000, 4900000);
+
+	ResourceHandle depth = builder.AddResource("Depth");
+	builder.SetLifetime(depth, gbuffer, lighting);
+	builder.SetMemory(depth, 1920 * 1080 * 4, 65536);
+	builder.Read(depth, lighting, STATE_DEPTH_READ);
+	builder.Read(depth, ssaoPass);
+	builder.Write(depth, gbuffer, STATE_DEPTH_WRITE);
+	builder.AddBarrier(depth, gbuffer, "ba1", Barrier::TRANSITION_BARRIER | Barrier::IMMEDIACY);
+	ResourceHandle shadowMap = builder.AddResource("ShadowMap");
+	builder.SetLifetime(shadowMap, shadows, lighting);
+	builder.SetMemory(shadowMap, 2048 * 2048 * 4, 65536);
+	builder.Read(shadowMap, lighting);
+	builder.Write(shadowMap, shadows, STATE_DEPTH_WRITE);
+	builder.AddBarrier(shadowMap, shadows, "ba2", Barrier::ALIASING_BARRIER | Barrier::BEGIN);
+	builder.AddBarrier(shadowMap, lighting, "ba3", Barrier::ALIASING_BARRIER | Barrier::END);
+	ResourceHandle ssao = builder.AddResource("SSAO");
+	builder.SetLifetime(ssao, ssaoPass, lighting);
+	builder.SetMemory(ssao, 1920 * 1080, 65536);
+	builder.Read(ssao, lighting);
+	builder.Write(ssao, ssaoPass, STATE_UNORDERED_ACCESS);
+	builder.AddBarrier(ssao, ssaoPass, "ba4", Barrier::UAV_BARRIER | Barrier::IMMEDIACY);
+	builder.Build(passMap, res);
+}
+
+/** 根据后缀读取.json文件或者二进制capture */
+bool loadGraph(const char* path, std::vector<Queue>& passMap, std::vector<Resource>& res) {
+	std::string error;
+	size_t length = std::strlen(path);
+	bool succeed = (length > 5 && std::strcmp(path + length - 5, ".json") == 0)
+		? LoadGraphJson(path, passMap, res, &error)
+		: LoadCapture(path, passMap, res, &error);
+	if (!succeed)
+		std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+	return succeed;
+}
+
+/** 输出多帧汇总的代表帧，并打印持续时间的p99远大于中位数的pass
+ * @param nsPerUnit 为0时让最长的queue约占1000个单位 */
+int rasterAggregate(const FrameAggregator& aggregator, const char* output, double nsPerUnit) {
+	if (aggregator.FrameCount() == 0) {
+		std::fprintf(stderr, "no frame to aggregate\n");
+		return 1;
+	}
+	std::vector<Queue> passMap;
+	std::vector<Resource> res;
+	aggregator.BuildMedianGraph(passMap, res);
+	if (nsPerUnit <= 0.0) {
+		uint64_t span = 0;
+		for (const auto& queue : passMap)
+			for (const auto& pass : queue)
+				if (pass.HasTiming()) span = std::max(span, pass.endTime);
+		nsPerUnit = span > 0 ? static_cast<double>(span) / 1000.0 : 1.0;
+	}
+	PipelineGraph sg(passMap, res);
+	sg.SetTimeLayout(nsPerUnit);
+	sg.Setup();
+	aggregator.AddWhiskers(sg);
+	sg.Raster(output ? output : "test");
+
+	std::printf("aggregate: %llu frames, %llu unmatched passes\n",
+		static_cast<unsigned long long>(aggregator.FrameCount()),
+		static_cast<unsigned long long>(aggregator.UnmatchedPasses()));
+	struct Hitch {
+		PassLocate locate;
+		double ratio;
+	};
+	std::vector<Hitch> hitches;
+	const auto& graphPasses = aggregator.GetPassMap();
+	for (QueueIdx queIdx = 0; queIdx < graphPasses.size(); ++queIdx) {
+		for (PassIdx passIdx = 0; passIdx < graphPasses[queIdx].size(); ++passIdx) {
+			PassLocate locate = { queIdx, passIdx };
+			const PassDurationStats& stats = aggregator.GetStats(locate);
+			double p50 = stats.p50.Get();
+			if (stats.count == 0 || p50 <= 0.0) continue;
+			double ratio = stats.p99.Get() / p50;
+			if (ratio >= FrameAggregator::HITCH_RATIO) hitches.push_back({ locate, ratio });
+		}
+	}
+	std::sort(hitches.begin(), hitches.end(), [](const Hitch& lhs, const Hitch& rhs) { return lhs.ratio > rhs.ratio; });
+	std::printf("hitching passes (p99 >= %.1fx p50): %llu\n", FrameAggregator::HITCH_RATIO,
+		static_cast<unsigned long long>(hitches.size()));
+	for (size_t index = 0; index < hitches.size() && index < 10; ++index) {
+		const PassDurationStats& stats = aggregator.GetStats(hitches[index].locate);
+		std::printf("  %s: p50 %.3f us, p99 %.3f us, max %.3f us\n",
+			graphPasses[hitches[index].locate.queueIndex][hitches[index].locate.inqueueIndex].name.c_str(),
+			stats.p50.Get() / 1000.0, stats.p99.Get() / 1000.0, static_cast<double>(stats.max) / 1000.0);
+	}
+	return 0;
+}
+
+/** 逐帧处理capture流，每一帧输出到"输出名称_帧序号"
+ * @param aggregate 为true时不逐帧输出，而是汇总所有帧后输出代表帧 */
+int processStream(const char* path, const char* output, double nsPerUnit, bool aggregate) {
+	CaptureStreamReader reader;
+	std::string error;
+	if (!reader.Open(path, &error)) {
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	PipelineGraph sg;
+	sg.SetTimeLayout(nsPerUnit);
+	std::string prefix = output ? output : "test";
+	FrameAggregator aggregator;
+	while (reader.Next(sg, &error)) {
+		if (aggregate) {
+			aggregator.AddFrame(sg.GetPassMap(), sg.GetResourceMap());
+			continue;
+		}
+		sg.Setup();
+		sg.Raster((prefix + "_" + std::to_string(reader.FrameCount() - 1)).c_str());
+	}
+	if (!error.empty()) {
+		std::fprintf(stderr, "%s: frame %llu: %s\n", path,
+			static_cast<unsigned long long>(reader.FrameCount()), error.c_str());
+		return 1;
+	}
+	return aggregate ? rasterAggregate(aggregator, output, nsPerUnit) : 0;
+}
+
+/** 从共享内存中逐帧接收渲染图，每一帧输出到"输出名称_帧序号"，直到生产者关闭
+ * @param aggregate 为true时不逐帧输出，而是汇总所有帧后输出代表帧
+ * @param idleTimeout 连续多少秒没有收到帧时放弃，为0时一直等待
+ * @return 生产者没有关闭就退出或者等待超时时，输出已经收到的帧并返回1 */
+int processShm(const char* name, const char* output, double nsPerUnit, bool aggregate, double idleTimeout) {
+	ShmConsumer consumer;
+	std::string error;
+	/** 允许先启动ppfg，最多等待生产者5秒 */
+	for (int retry = 0; !consumer.Open(name, &error); ++retry) {
+		if (retry == 500) {
+			std::fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	error.clear();
+	PipelineGraph sg;
+	sg.SetTimeLayout(nsPerUnit);
+	std::string prefix = output ? output : "test";
+	uint64_t sequence = 0;
+	uint64_t received = 0;
+	FrameAggregator aggregator;
+	bool producerGone = false;
+	bool failed = false;
+	auto lastFrame = std::chrono::steady_clock::now();
+	while (true) {
+		/** 先检查是否结束，保证生产者关闭前发布的帧都能被取出 */
+		bool finished = consumer.Finished();
+		if (consumer.Next(sg, sequence, &error)) {
+			lastFrame = std::chrono::steady_clock::now();
+			if (aggregate) {
+				aggregator.AddFrame(sg.GetPassMap(), sg.GetResourceMap());
+			}
+			else {
+				sg.Setup();
+				sg.Raster((prefix + "_" + std::to_string(sequence)).c_str());
+			}
+			++received;
+		}
+		else if (!error.empty()) {
+			std::fprintf(stderr, "%s: frame %llu: %s\n", name,
+				static_cast<unsigned long long>(sequence), error.c_str());
+			error.clear();
+		}
+		else if (finished) {
+			break;
+		}
+		else if (producerGone) {
+			/** 生产者退出后共享内存不再变化，已经取完仍未关闭说明生产者异常退出 */
+			std::fprintf(stderr, "%s: producer exited without closing\n", name);
+			failed = true;
+			break;
+		}
+		else if (!consumer.ProducerAlive()) {
+			/** 生产者可能在Next之后发布了最后的帧并关闭，再检查一次 */
+			producerGone = true;
+		}
+		else if (idleTimeout > 0.0 && std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - lastFrame).count() > idleTimeout) {
+			std::fprintf(stderr, "%s: no frame received for %g seconds\n", name, idleTimeout);
+			failed = true;
+			break;
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	const ShmHeader& header = consumer.Header();
+	std::printf("%s: %llu frames received, %llu dropped, %llu oversized\n", name,
+		static_cast<unsigned long long>(received),
+		static_cast<unsigned long long>(header.droppedFrames.load()),
+		static_cast<unsigned long long>(header.oversizedFrames.load()));
+	int result = aggregate ? rasterAggregate(aggregator, output, nsPerUnit) : 0;
+	return failed ? 1 : result;
+}
+
+/** 用生成的barrier替换输入中的barrier，并输出两者数量的比较 */
+bool replaceBarriers(const std::vector<Queue>& passMap, std::vector<Resource>& res) {
+	size_t inputCount = 0, synthesizedCount = 0;
+	for (const auto& resource : res) inputCount += resource.barriers.size();
+	std::string error;
+	if (!SynthesizeBarriers(passMap, res, BarrierSynthesisOptions(), &error)) {
+		std::fprintf(stderr, "cannot synthesize barriers: %s\n", error.c_str());
+		return false;
+	}
+	for (const auto& resource : res) synthesizedCount += resource.barriers.size();
+	std::printf("barriers: %llu in input, %llu synthesized\n",
+		static_cast<unsigned long long>(inputCount), static_cast<unsigned long long>(synthesizedCount));
+	return true;
+}
+
+/** 用推导出的最少fence替换输入中的fence，并输出比较的结果 */
+bool replaceFences(std::vector<Queue>& passMap, const std::vector<Resource>& res) {
+	FenceInferenceResult result;
+	std::string error;
+	if (!InferFences(passMap, res, result, &error)) {
+		std::fprintf(stderr, "cannot infer fences: %s\n", error.c_str());
+		return false;
+	}
+	size_t reasonCounts[3] = { 0, 0, 0 };
+	for (const auto& redundant : result.redundantFences)
+		++reasonCounts[redundant.reason];
+	std::printf("fences: %llu in input, %llu minimal, %llu redundant (%llu implied, %llu unneeded, %llu replaceable), %llu missing\n",
+		static_cast<unsigned long long>(result.inputFenceCount),
+		static_cast<unsigned long long>(result.minimalFences.size()),
+		static_cast<unsigned long long>(result.redundantFences.size()),
+		static_cast<unsigned long long>(reasonCounts[RedundantFence::IMPLIED]),
+		static_cast<unsigned long long>(reasonCounts[RedundantFence::UNNEEDED]),
+		static_cast<unsigned long long>(reasonCounts[RedundantFence::REPLACEABLE]),
+		static_cast<unsigned long long>(result.missingFences.size()));
+	auto name = [&passMap](const PassLocate& locate) {
+		return passMap[locate.queueIndex][locate.inqueueIndex].name.c_str();
+	};
+	for (const auto& missing : result.missingFences)
+		std::printf("  missing: %s -> %s\n", name(missing.signal), name(missing.wait));
+	for (const auto& redundant : result.redundantFences) {
+		if (redundant.reason != RedundantFence::REPLACEABLE) continue;
+		std::printf("  replaceable: %s -> %s covers a hazard, replace with %s -> %s\n",
+			name(redundant.fence.signal), name(redundant.fence.wait),
+			name(redundant.replacement.signal), name(redundant.replacement.wait));
+	}
+	ReplaceFences(passMap, result.minimalFences);
+	return true;
+}
+
+/** 找出对输出资源没有贡献的pass与资源，并输出其数量
+ * @param outputs 作为输出的资源名称，为空时使用FindCullingRoots找到的资源
+ * @remark 调用前必须保证sg的BuildQueryIndex或Setup被调用 */
+bool cullPasses(const PipelineGraph& sg, const std::vector<const char*>& outputs, CullingResult& result) {
+	const auto& passMap = sg.GetPassMap();
+	const auto& res = sg.GetResourceMap();
+	std::vector<ResourceIdx> roots, found;
+	for (const char* output : outputs) {
+		if (!sg.FindResources(output, found)) {
+			std::fprintf(stderr, "unknown output resource %s\n", output);
+			return false;
+		}
+		roots.insert(roots.end(), found.begin(), found.end());
+	}
+	if (outputs.empty()) FindCullingRoots(res, roots);
+	/** 没有输出时所有的pass都会被视为没有用 */
+	if (roots.empty()) {
+		std::fprintf(stderr, "no output resources; use --output-resource\n");
+		return false;
+	}
+	std::string error;
+	if (!CullUnusedPasses(passMap, res, roots, result, &error)) {
+		std::fprintf(stderr, "cannot cull passes: %s\n", error.c_str());
+		return false;
+	}
+	std::printf("unused: %llu of %llu passes, %llu of %llu resources\n",
+		static_cast<unsigned long long>(result.deadPasses.size()),
+		static_cast<unsigned long long>(result.deadPasses.size() + result.livePassCount),
+		static_cast<unsigned long long>(result.deadResources.size()),
+		static_cast<unsigned long long>(res.size()));
+	for (const auto& pass : result.deadPasses)
+		std::printf("  unused pass: %s\n", passMap[pass.queueIndex][pass.inqueueIndex].name.c_str());
+	return true;
+}
+
+/** 计算关键路径，输出到标准输出并在图中突出显示
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportCriticalPath(PipelineGraph& sg) {
+	CriticalPathResult result;
+	std::string error;
+	if (!FindCriticalPath(sg.GetPassMap(), result, &error)) {
+		std::fprintf(stderr, "cannot find the critical path: %s\n", error.c_str());
+		return false;
+	}
+	const auto& passMap = sg.GetPassMap();
+	std::printf("critical path: %llu passes, length %llu %s\n",
+		static_cast<unsigned long long>(result.path.size()), static_cast<unsigned long long>(result.length),
+		result.timed ? "ns" : "passes");
+	if (result.untimedPasses != 0)
+		std::printf("  %u passes without timing counted as 0 ns\n", result.untimedPasses);
+	for (const auto& pass : result.path)
+		std::printf("  %s\n", passMap[pass.queueIndex][pass.inqueueIndex].name.c_str());
+	HighlightCriticalPath(sg, result);
+	return true;
+}
+
+/** 找出queue上的空闲，按时长从大到小输出到标准输出并在图中标出
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportBubbles(PipelineGraph& sg) {
+	QueueBubbleReport report;
+	std::string error;
+	if (!FindQueueBubbles(sg.GetPassMap(), sg.GetResourceMap(), report, &error)) {
+		std::fprintf(stderr, "cannot find queue bubbles: %s\n", error.c_str());
+		return false;
+	}
+	const auto& passMap = sg.GetPassMap();
+	auto name = [&passMap](const PassLocate& locate) {
+		return passMap[locate.queueIndex][locate.inqueueIndex].name.c_str();
+	};
+	for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+		uint64_t total = report.idleTime[queIdx] + report.busyTime[queIdx];
+		std::printf("queue %u: %.3f us idle, %.1f%% of timed span\n", queIdx,
+			static_cast<double>(report.idleTime[queIdx]) / 1000.0,
+			total ? 100.0 * static_cast<double>(report.idleTime[queIdx]) / static_cast<double>(total) : 0.0);
+	}
+	static const char* CAUSE_NAMES[] = { "fence from", "resource wait on", "unknown" };
+	for (const auto& bubble : report.bubbles) {
+		std::printf("  %10.3f us  queue %u  %s -> %s  %s", static_cast<double>(bubble.duration) / 1000.0,
+			bubble.after.queueIndex, name(bubble.before), name(bubble.after), CAUSE_NAMES[bubble.cause]);
+		if (bubble.cause != QueueBubble::UNKNOWN) std::printf(" %s", name(bubble.blocker));
+		if (bubble.cause == QueueBubble::RESOURCE)
+			std::printf(" (%s)", sg.GetResourceMap()[bubble.resource].name.c_str());
+		std::printf("\n");
+	}
+	HighlightBubbles(sg, report);
+	return true;
+}
+
+/** 分析barrier能否合并，输出合并前后的flush次数并在图中标出可以合并的pass
+ * @remark 调用前必须保证sg的Setup被调用 */
+void reportBarrierBatching(PipelineGraph& sg) {
+	BarrierBatchingReport report;
+	AnalyzeBarrierBatching(sg, report);
+	std::printf("barrier flushes: %llu as issued, %llu batched, score %.2f\n",
+		static_cast<unsigned long long>(report.flushesBefore),
+		static_cast<unsigned long long>(report.flushesAfter), report.Score());
+	const auto& passMap = sg.GetPassMap();
+	for (const auto& batch : report.batches) {
+		if (batch.barriers.size() < 2) continue;
+		std::printf("  %s: %llu barriers %s\n", passMap[batch.pass.queueIndex][batch.pass.inqueueIndex].name.c_str(),
+			static_cast<unsigned long long>(batch.barriers.size()),
+			batch.position == BarrierBatch::BEFORE_PASS ? "before" : "after");
+	}
+	HighlightBarrierBatches(sg, report);
+}
+
+/** 找出可以去掉的barrier，输出到标准输出并在图中标出提交它们的pass
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportRedundantBarriers(PipelineGraph& sg) {
+	RedundantBarrierReport report;
+	std::string error;
+	if (!FindRedundantBarriers(sg.GetPassMap(), sg.GetResourceMap(), report, &error)) {
+		std::fprintf(stderr, "cannot find redundant barriers: %s\n", error.c_str());
+		return false;
+	}
+	std::printf("redundant barriers: %llu of %llu removable\n",
+		static_cast<unsigned long long>(report.removableBarriers), static_cast<unsigned long long>(report.totalBarriers));
+	static const char* REASON_NAMES[] = { "no-op transition", "UAV barrier without write",
+		"cancels", "back-to-back with" };
+	const auto& resMap = sg.GetResourceMap();
+	for (const auto& redundant : report.barriers) {
+		const Resource& resource = resMap[redundant.barrier.resource];
+		std::printf("  %s: %s  %s", resource.name.c_str(),
+			resource.barriers[redundant.barrier.barrierIndex].description.c_str(), REASON_NAMES[redundant.reason]);
+		if (redundant.related.resource != INVALID_INDEX)
+			std::printf(" %s", resource.barriers[redundant.related.barrierIndex].description.c_str());
+		std::printf("\n");
+	}
+	HighlightRedundantBarriers(sg, report);
+	return true;
+}
+
+/** 估计资源占用的内存，输出峰值以及峰值时存活的资源，并在资源下方绘制面积图
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportMemory(PipelineGraph& sg) {
+	MemoryTimeline timeline;
+	std::string error;
+	if (!BuildMemoryTimeline(sg.GetPassMap(), sg.GetResourceMap(), timeline, &error)) {
+		std::fprintf(stderr, "cannot build the memory timeline: %s\n", error.c_str());
+		return false;
+	}
+	std::printf("memory: peak %s, %s without reuse, %u resources without size (%s)\n",
+		DescribeBytes(timeline.peakBytes).c_str(), DescribeBytes(timeline.totalBytes).c_str(),
+		timeline.unsizedResources, timeline.timed ? "by pass timing" : "by pass ordering");
+	for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+		if (timeline.heapPeakBytes[heap] != 0)
+			std::printf("  %s heap: peak %s\n", HEAP_TYPE_NAMES[heap], DescribeBytes(timeline.heapPeakBytes[heap]).c_str());
+	}
+	if (timeline.peakBytes != 0) {
+		const auto& peak = sg.GetPassMap()[timeline.peakPass.queueIndex][timeline.peakPass.inqueueIndex];
+		std::printf("  peak at %s:\n", peak.name.c_str());
+	}
+	for (ResourceIdx resIdx : timeline.peakResources) {
+		const Resource& resource = sg.GetResourceMap()[resIdx];
+		std::printf("  %12s  %s\n", DescribeBytes(resource.GetAlignedSize()).c_str(), resource.name.c_str());
+	}
+	HighlightMemoryTimeline(sg, timeline);
+	return true;
+}
+
+/** 规划资源在堆中的位置，输出每个堆复用内存前后的大小，并将规划结果写入文件
+ * @param path 规划结果的输出路径，格式见SaveAliasingPlan
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportAliasingPlan(PipelineGraph& sg, const char* path) {
+	AliasingPlan plan;
+	std::string error;
+	if (!PlanAliasing(sg.GetPassMap(), sg.GetResourceMap(), plan, &error)) {
+		std::fprintf(stderr, "cannot plan aliasing: %s\n", error.c_str());
+		return false;
+	}
+	for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+		if (plan.naiveSizes[heap] == 0) continue;
+		std::printf("%s heap: %s aliased, %s without aliasing\n", HEAP_TYPE_NAMES[heap],
+			DescribeBytes(plan.heapSizes[heap]).c_str(), DescribeBytes(plan.naiveSizes[heap]).c_str());
+	}
+	std::printf("aliasing barriers: %llu\n", static_cast<unsigned long long>(plan.barriers.size()));
+	if (!SaveAliasingPlan(path, sg.GetResourceMap(), plan)) {
+		std::fprintf(stderr, "cannot write %s\n", path);
+		return false;
+	}
+	AnnotateAliasingPlan(sg, plan);
+	return true;
+}
+
+/** 统计queue之间同时执行的时间，输出到标准输出与JSON文件，并在图的下方加入汇总表
+ * @param path JSON文件的输出路径，格式见SaveQueueOverlap
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportQueueOverlap(PipelineGraph& sg, const char* path) {
+	QueueOverlapMetrics metrics;
+	MeasureQueueOverlap(sg.GetPassMap(), metrics);
+	std::printf("timed span: %.3f us\n", static_cast<double>(metrics.Span()) / 1000.0);
+	for (QueueIdx queIdx = 0; queIdx < metrics.busyTime.size(); ++queIdx) {
+		std::printf("  queue %u: %.3f us busy, %.1f%% utilization\n", queIdx,
+			static_cast<double>(metrics.busyTime[queIdx]) / 1000.0, metrics.Utilization(queIdx) * 100.0);
+	}
+	for (QueueIdx first = 0; first < metrics.busyTime.size(); ++first) {
+		for (QueueIdx second = first + 1; second < metrics.busyTime.size(); ++second) {
+			std::printf("  queues %u+%u: %.3f us overlapped, %.1f%% utilization, %.1f%% efficiency\n", first, second,
+				static_cast<double>(metrics.overlapTime[first][second]) / 1000.0,
+				metrics.Utilization(first, second) * 100.0, metrics.OverlapEfficiency(first, second) * 100.0);
+		}
+	}
+	if (!SaveQueueOverlap(path, metrics)) {
+		std::fprintf(stderr, "cannot write %s\n", path);
+		return false;
+	}
+	AddQueueOverlapTable(sg, metrics);
+	return true;
+}
+
+/** 比较旧图与当前的图，输出合并后标出变化的图，并在标准输出中列出变化
+ * @param basePath 旧图的路径，格式与输入相同
+ * @return 进程的返回值 */
+int diffGraphs(const char* basePath, std::vector<Queue>& passMap, std::vector<Resource>& res,
+	const char* output, double nsPerUnit) {
+	std::vector<Queue> basePassMap;
+	std::vector<Resource> baseRes;
+	if (!loadGraph(basePath, basePassMap, baseRes)) return 1;
+	GraphDiff diff;
+	std::string error;
+	if (!DiffGraphs(basePassMap, baseRes, passMap, res, diff, &error)) {
+		std::fprintf(stderr, "cannot diff graphs: %s\n", error.c_str());
+		return 1;
+	}
+	size_t addedFences = 0, addedBarriers = 0;
+	for (const auto& fence : diff.fences) addedFences += fence.added;
+	for (const auto& barrier : diff.barriers) addedBarriers += barrier.added;
+	std::printf("passes: %zu added, %zu removed, %zu moved\n", diff.addedPasses, diff.removedPasses, diff.movedPasses);
+	std::printf("resources: %zu added, %zu removed\n", diff.addedResources, diff.removedResources);
+	std::printf("fences: %zu added, %zu removed\n", addedFences, diff.fences.size() - addedFences);
+	std::printf("barriers: %zu added, %zu removed\n", addedBarriers, diff.barriers.size() - addedBarriers);
+	std::printf("timed span: %.3f us -> %.3f us\n", static_cast<double>(diff.oldSpan) / 1000.0,
+		static_cast<double>(diff.newSpan) / 1000.0);
+	PipelineGraph sg(diff.passMap, diff.resMap);
+	sg.SetTimeLayout(nsPerUnit);
+	sg.Setup();
+	HighlightGraphDiff(sg, diff);
+	sg.Raster(output ? output : "test");
+	return 0;
+}
+
+/** 将当前的图与基线比较，在标准输出中列出回归的检查项
+ * @param baselinePath 基线文件的路径，见SaveGateBaseline
+ * @param reportPath 比较结果的输出路径，可以为空，格式见SaveGateReport
+ * @return 进程的返回值: 没有回归时为0，出错时为1，存在回归时为2 */
+int gateGraph(const char* baselinePath, const char* reportPath, const std::vector<Queue>& passMap,
+	const std::vector<Resource>& res, const GateThresholds& thresholds) {
+	GateMetrics baseline, current;
+	std::string error;
+	if (!LoadGateBaseline(baselinePath, baseline, &error)) {
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+	CollectGateMetrics(passMap, res, current);
+	GateReport report;
+	CheckRegressions(baseline, current, thresholds, report);
+	for (const auto& check : report.checks) {
+		if (!check.regressed) continue;
+		bool time = check.kind == GateCheck::PASS_TIME || check.kind == GateCheck::QUEUE_TIME
+			|| check.kind == GateCheck::FRAME_TIME;
+		std::string label = check.name.empty() ? GATE_CHECK_NAMES[check.kind]
+			: std::string(GATE_CHECK_NAMES[check.kind]) + " " + check.name;
+		if (time) {
+			std::printf("regressed %s: %.3f us -> %.3f us (%+.1f%%)\n", label.c_str(),
+				static_cast<double>(check.baseline) / 1000.0, static_cast<double>(check.current) / 1000.0,
+				check.baseline ? (static_cast<double>(check.current) / static_cast<double>(check.baseline) - 1.0) * 100.0 : 0.0);
+		}
+		else {
+			std::printf("regressed %s: %llu -> %llu\n", label.c_str(),
+				static_cast<unsigned long long>(check.baseline), static_cast<unsigned long long>(check.current));
+		}
+	}
+	for (const auto& name : report.missingPasses)
+		std::printf("missing pass %s\n", name.c_str());
+	for (QueueIdx queIdx : report.missingQueues)
+		std::printf("missing queue %u\n", static_cast<unsigned>(queIdx));
+	if (report.missingTiming) std::printf("missing timing\n");
+	std::printf("gate: %zu checks, %zu regressions, %zu passes missing, %zu queues missing, %zu new%s\n",
+		report.checks.size(), report.regressions, report.missingPasses.size(), report.missingQueues.size(),
+		report.newPasses.size(), thresholds.allowMissing ? " (missing allowed)" : "");
+	if (reportPath && !SaveGateReport(reportPath, report, thresholds)) {
+		std::fprintf(stderr, "cannot write %s\n", reportPath);
+		return 1;
+	}
+	return report.Passed() ? 0 : 2;
+}
+
+/** 找出图中的数据竞争，输出到标准输出并在图中突出显示
+ * @remark 调用前必须保证sg的Setup被调用 */
+bool reportRaces(PipelineGraph& sg) {
+	std::vector<DataRace> races;
+	std::string error;
+	if (!DetectRaces(sg.GetPassMap(), sg.GetResourceMap(), races, &error)) {
+		std::fprintf(stderr, "cannot detect races: %s\n", error.c_str());
+		return false;
+	}
+	std::printf("races: %llu\n", static_cast<unsigned long long>(races.size()));
+	const auto& passMap = sg.GetPassMap();
+	for (const auto& race : races) {
+		std::printf("  %s: %s writes, %s %s\n", sg.GetResourceMap()[race.resource].name.c_str(),
+			passMap[race.write.queueIndex][race.write.inqueueIndex].name.c_str(),
+			passMap[race.other.queueIndex][race.other.inqueueIndex].name.c_str(),
+			race.otherWrites ? "writes" : "reads");
+	}
+	HighlightRaces(sg, races);
+	return true;
+}
+
+/** 解析非负的浮点数参数，整个字符串都必须是数字 */
+bool parseNumber(const char* option, const char* text, double& value) {
+	char* end = nullptr;
+	errno = 0;
+	double parsed = std::strtod(text, &end);
+	if (end == text || *end != '\0' || errno == ERANGE || !(parsed >= 0.0)) {
+		std::fprintf(stderr, "%s needs a non-negative number, got %s\n", option, text);
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+/** 解析非负的整数参数，整个字符串都必须是数字 */
+bool parseNumber(const char* option, const char* text, uint64_t& value) {
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long parsed = std::strtoull(text, &end, 10);
+	/** strtoull会接受负数并将其转换成很大的值 */
+	if (end == text || *end != '\0' || errno == ERANGE || std::strchr(text, '-')) {
+		std::fprintf(stderr, "%s needs a non-negative integer, got %s\n", option, text);
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+/** 用法: ppfg [-o 输出名称] [--save-capture capture文件] [--shm 共享内存名称] [--shm-timeout 秒数] [--synthesize-barriers] [--infer-fences] [--detect-races]
+ *   [--cull-unused] [--drop-unused] [--output-resource 资源名称]... [--time-scale 纳秒数] [--critical-path] [--bubbles]
+ *   [--barrier-batching] [--redundant-barriers] [--memory] [--plan-aliasing 输出文件]
+ *   [--queue-overlap 输出文件] [--aggregate] [--diff 旧的graph.json | 旧的capture文件]
+ *   [--save-baseline 基线文件] [--gate 基线文件] [--gate-report 输出文件] [--gate-relative 比例] [--gate-absolute 纳秒数]
+ *   [--gate-count 数量] [--gate-allow-missing]
+ *   [graph.json | capture文件 | capture流文件]
+ * --shm-timeout: 从共享内存接收时，连续这么多秒没有收到帧就放弃并返回1，默认一直等待；
+ *   生产者没有关闭共享内存就退出时同样返回1
+ * --synthesize-barriers: 根据资源的读写状态重新生成barrier
+ * --infer-fences: 根据资源的读写冲突重新生成最少的fence
+ * --detect-races: 找出不同queue之间没有同步的冲突访问，并在图中突出显示
+ * --cull-unused: 找出对输出资源没有贡献的pass与资源，并在图中显示为灰色
+ * --drop-unused: 同--cull-unused，但是从图中删除这些pass与资源
+ * --output-resource: 指定作为输出的资源，可以指定多次，默认为以PRESENT状态访问的资源，
+ *   没有这样的资源时为一直未被删除的资源
+ * --time-scale: 按pass的起止时间布局，参数为图中一个单位对应的纳秒数
+ * --critical-path: 计算queue顺序与fence决定的关键路径以及每个pass的松弛时间，并在图中突出显示，
+ *   没有pass记录时间时路径长度为pass的数量，否则以纳秒为单位，没有记录时间的pass按0计算
+ * --bubbles: 找出queue上相邻pass之间的空闲以及导致空闲的fence或资源，需要pass记录了起止时间
+ * --barrier-batching: 找出同一个pass在同一位置提交的多个barrier，估计合并为一次调用前后的flush次数
+ * --redundant-barriers: 找出状态没有变化的切换、前后没有写入的UAV barrier以及之间没有访问的连续切换
+ * --memory: 按资源的大小与生命周期估计内存占用的峰值，并在资源下方绘制占用随pass变化的面积图，
+ *   所有pass都记录了时间时按时间计算，否则与--plan-aliasing相同按先后关系估计，不同queue上没有同步的pass会计入对方的资源
+ * --plan-aliasing: 让生命周期不重叠的资源共享内存，将每个资源在堆中的偏移以及需要的aliasing barrier写入JSON文件
+ * --queue-overlap: 按pass的起止时间统计每个queue的利用率以及每对queue同时执行的时间，写入JSON文件并在图中加入汇总表
+ * --aggregate: 按位置与名称匹配各帧的pass，统计持续时间的最小值、平均值、中位数与p99，
+ *   只输出一张按中位数布局并以须线标出p99的代表帧；输入为capture流或共享内存时逐帧统计，
+ *   其余输入按pass所属的帧拆分
+ * --diff: 按名称对齐两张图中的pass与资源，输出一张标出增加、删除、移动的pass，变化的fence与barrier，
+ *   以及每个pass持续时间变化的合并图，输入为新的图
+ * --save-baseline: 将pass、queue与整帧的计时以及barrier与fence的数量保存为基线文件
+ * --gate: 与基线文件比较，不输出图，存在回归时返回2，计时的增加同时超过--gate-relative(默认0.05)
+ *   与--gate-absolute(默认50000纳秒)时为回归，barrier与fence的数量增加超过--gate-count(默认0)时为回归，
+ *   基线中的pass、queue或者计时缺失时同样返回2
+ * --gate-allow-missing: 基线中的pass、queue或者计时缺失时不视为失败
+ * --gate-report: 将比较结果写入JSON文件
+ * --save-baseline与--gate只能用于单帧的图，不能与capture流、共享内存或者--aggregate同时使用，
+ *   与--drop-unused同时使用时统计删除之后的图
+ * --cull-unused与--drop-unused不能与capture流、共享内存、--aggregate或者--diff同时使用
+ * 数值参数必须是非负的数字，未知的选项或者多个输入都视为错误并返回1
+ * 不指定输入时输出内置的示例 */
+int main(int argc, char** argv) {
+	const char* input = nullptr;
+	const char* output = nullptr;
+	const char* captureOutput = nullptr;
+	const char* shmName = nullptr;
+	double shmTimeout = 0.0;
+	bool synthesizeBarriers = false;
+	bool inferFences = false;
+	bool detectRaces = false;
+	double nsPerUnit = 0.0;
+	bool criticalPath = false;
+	bool bubbles = false;
+	bool barrierBatching = false;
+	bool redundantBarriers = false;
+	bool memory = false;
+	const char* aliasingPlan = nullptr;
+	const char* queueOverlap = nullptr;
+	bool aggregate = false;
+	const char* diffBase = nullptr;
+	const char* baselineOutput = nullptr;
+	const char* gateBaseline = nullptr;
+	const char* gateReport = nullptr;
+	GateThresholds gateThresholds;
+	bool cullUnused = false;
+	bool dropUnused = false;
+	std::vector<const char*> outputResources;
+	for (int index = 1; index < argc; ++index) {
+		if (std::strcmp(argv[index], "-o") == 0 && index + 1 < argc)
+			output = argv[++index];
+		else if (std::strcmp(argv[index], "--save-capture") == 0 && index + 1 < argc)
+			captureOutput = argv[++index];
+		else if (std::strcmp(argv[index], "--shm") == 0 && index + 1 < argc)
+			shmName = argv[++index];
+		else if (std::strcmp(argv[index], "--shm-timeout") == 0 && index + 1 < argc) {
+			if (!parseNumber(argv[index], argv[index + 1], shmTimeout)) return 1;
+			++index;
+		}
+		else if (std::strcmp(argv[index], "--synthesize-barriers") == 0)
+			synthesizeBarriers = true;
+		else if (std::strcmp(argv[index], "--infer-fences") == 0)
+			inferFences = true;
+		else if (std::strcmp(argv[index], "--detect-races") == 0)
+			detectRaces = true;
+		else if (std::strcmp(argv[index], "--time-scale") == 0 && index + 1 < argc) {
+			if (!parseNumber(argv[index], argv[index + 1], nsPerUnit)) return 1;
+			++index;
+		}
+		else if (std::strcmp(argv[index], "--critical-path") == 0)
+			criticalPath = true;
+		else if (std::strcmp(argv[index], "--bubbles") == 0)
+			bubbles = true;
+		else if (std::strcmp(argv[index], "--barrier-batching") == 0)
+			barrierBatching = true;
+		else if (std::strcmp(argv[index], "--redundant-barriers") == 0)
+			redundantBarriers = true;
+		else if (std::strcmp(argv[index], "--memory") == 0)
+			memory = true;
+		else if (std::strcmp(argv[index], "--plan-aliasing") == 0 && index + 1 < argc)
+			aliasingPlan = argv[++index];
+		else if (std::strcmp(argv[index], "--queue-overlap") == 0 && index + 1 < argc)
+			queueOverlap = argv[++index];
+		else if (std::strcmp(argv[index], "--aggregate") == 0)
+			aggregate = true;
+		else if (std::strcmp(argv[index], "--diff") == 0 && index + 1 < argc)
+			diffBase = argv[++index];
+		else if (std::strcmp(argv[index], "--save-baseline") == 0 && index + 1 < argc)
+			baselineOutput = argv[++index];
+		else if (std::strcmp(argv[index], "--gate") == 0 && index + 1 < argc)
+			gateBaseline = argv[++index];
+		else if (std::strcmp(argv[index], "--gate-report") == 0 && index + 1 < argc)
+			gateReport = argv[++index];
+		else if (std::strcmp(argv[index], "--gate-relative") == 0 && index + 1 < argc) {
+			if (!parseNumber(argv[index], argv[index + 1], gateThresholds.relative)) return 1;
+			++index;
+		}
+		else if (std::strcmp(argv[index], "--gate-absolute") == 0 && index + 1 < argc) {
+			if (!parseNumber(argv[index], argv[index + 1], gateThresholds.absolute)) return 1;
+			++index;
+		}
+		else if (std::strcmp(argv[index], "--gate-count") == 0 && index + 1 < argc) {
+			if (!parseNumber(argv[index], argv[index + 1], gateThresholds.countIncrease)) return 1;
+			++index;
+		}
+		else if (std::strcmp(argv[index], "--gate-allow-missing") == 0)
+			gateThresholds.allowMissing = true;
+		else if (std::strcmp(argv[index], "--cull-unused") == 0)
+			cullUnused = true;
+		else if (std::strcmp(argv[index], "--drop-unused") == 0)
+			dropUnused = true;
+		else if (std::strcmp(argv[index], "--output-resource") == 0 && index + 1 < argc)
+			outputResources.push_back(argv[++index]);
+		else if (argv[index][0] == '-' && argv[index][1] != '\0') {
+			std::fprintf(stderr, "unknown option or missing value: %s\n", argv[index]);
+			return 1;
+		}
+		else if (input) {
+			std::fprintf(stderr, "more than one input: %s and %s\n", input, argv[index]);
+			return 1;
+		}
+		else
+			input = argv[index];
+	}
+
+	if ((baselineOutput || gateBaseline) && (shmName || aggregate || (input && IsCaptureStream(input)))) {
+		std::fprintf(stderr, "--gate and --save-baseline need a single graph, not a capture stream, shared memory or --aggregate\n");
+		return 1;
+	}
+	if ((cullUnused || dropUnused) && (shmName || aggregate || diffBase || (input && IsCaptureStream(input)))) {
+		std::fprintf(stderr, "--cull-unused and --drop-unused need a single graph, not a capture stream, shared memory, --aggregate or --diff\n");
+		return 1;
+	}
+	if (shmName)
+		return processShm(shmName, output, nsPerUnit, aggregate, shmTimeout);
+	if (input && IsCaptureStream(input))
+		return processStream(input, output, nsPerUnit, aggregate);
+
+	std::vector<Queue> passMap;
 	std::vector<Resource> res;
-	Resource depth = Resource("Depth", { 0, 0 }, { 0, 2 }, { {0, 2}, {1, 0} }, { {0, 0} });
-	depth.barriers.push_back(Barrier({ 0, 0 }, "ba1", Barrier::TRANSITION_BARRIER | Barrier::IMMEDIACY));
-	Resource shadowMap = Resource("ShadowMap", { 0, 1 }, { 0, 2 }, { {0, 2} }, { {0, 1} });
-	shadowMap.barriers.push_back(Barrier({ 0, 1 }, "ba2", Barrier::ALIASING_BARRIER | Barrier::BEGIN));
-	shadowMap.barriers.push_back(Barrier({ 0, 2 }, "ba3", Barrier::ALIASING_BARRIER | Barrier::END));
-	Resource ssao = Resource("SSAO", { 1, 0 }, { 0, 2 }, { {0, 2} }, { {1, 0} });
-	ssao.barriers.push_back(Barrier({ 1, 0 }, "ba4", Barrier::UAV_BARRIER | Barrier::IMMEDIACY));
-	res.push_back(depth);
-	res.push_back(shadowMap);
-	res.push_back(ssao);
-	PipelineGraph sg({ q0, q1 }, res);
+	if (input) {
+		if (!loadGraph(input, passMap, res)) return 1;
+	}
+	else {
+		buildExample(passMap, res);
+	}
+	if (inferFences && !replaceFences(passMap, res)) return 1;
+	if (synthesizeBarriers && !replaceBarriers(passMap, res)) return 1;
+	if (aggregate) {
+		FrameAggregator aggregator;
+		aggregator.AddFrames(passMap, res);
+		return rasterAggregate(aggregator, output, nsPerUnit);
+	}
+	if (diffBase) return diffGraphs(diffBase, passMap, res, output, nsPerUnit);
+	CullingResult culling;
+	PipelineGraph sg(passMap, res);
+	if (cullUnused || dropUnused) {
+		sg.BuildQueryIndex();
+		if (!cullPasses(sg, outputResources, culling)) return 1;
+		if (dropUnused) {
+			/** 换出图中的pass与资源，删除没有用的部分后再放回 */
+			sg.Reset(passMap, res);
+			std::string error;
+			if (!RemoveCulled(passMap, res, culling, &error)) {
+				std::fprintf(stderr, "cannot remove unused passes: %s\n", error.c_str());
+				return 1;
+			}
+			sg.Reset(passMap, res);
+		}
+	}
+	/** 基线与门禁使用删除没有用的pass之后的图 */
+	if (baselineOutput) {
+		GateMetrics metrics;
+		CollectGateMetrics(sg.GetPassMap(), sg.GetResourceMap(), metrics);
+		if (!SaveGateBaseline(baselineOutput, metrics)) {
+			std::fprintf(stderr, "cannot write %s\n", baselineOutput);
+			return 1;
+		}
+	}
+	if (gateBaseline) return gateGraph(gateBaseline, gateReport, sg.GetPassMap(), sg.GetResourceMap(), gateThresholds);
+	if (captureOutput && !SaveCapture(sg, captureOutput)) {
+		std::fprintf(stderr, "cannot write %s\n", captureOutput);
+		return 1;
+	}
+	sg.SetTimeLayout(nsPerUnit);
 	sg.Setup();
-	sg.Raster();
+	if (cullUnused && !dropUnused) HighlightCulled(sg, culling);
+	if (criticalPath && !reportCriticalPath(sg)) return 1;
+	if (bubbles && !reportBubbles(sg)) return 1;
+	if (barrierBatching) reportBarrierBatching(sg);
+	if (redundantBarriers && !reportRedundantBarriers(sg)) return 1;
+	if (memory && !reportMemory(sg)) return 1;
+	if (aliasingPlan && !reportAliasingPlan(sg, aliasingPlan)) return 1;
+	if (queueOverlap && !reportQueueOverlap(sg, queueOverlap)) return 1;
+	if (detectRaces && !reportRaces(sg)) return 1;
+	sg.Raster(output);
+	ExportPerfetto(sg, output);
 	return 0;
-}
\ No newline at end of file
+}
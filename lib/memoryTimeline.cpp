@@ -0,0 +1,265 @@
+#include "memoryTimeline.h"
+#include "reachability.h"
+#include "resourceState.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 在queue上二分查找第一个满足条件的pass，条件沿queue单调(先不满足后满足)，找不到时返回queue中pass的数量 */
+		template<typename Predicate>
+		uint32_t partitionQueue(const PassIndex& index, QueueIdx queIdx, Predicate predicate) {
+			uint32_t low = 0, high = index.QueueEnd(queIdx) - index.QueueBegin(queIdx);
+			while (low < high) {
+				uint32_t mid = low + (high - low) / 2;
+				if (predicate(index.QueueBegin(queIdx) + mid)) high = mid;
+				else low = mid + 1;
+			}
+			return low;
+		}
+
+	}
+
+	std::string DescribeBytes(uint64_t bytes)
+	{
+		static const char* UNITS[] = { "B", "KiB", "MiB", "GiB" };
+		double value = static_cast<double>(bytes);
+		size_t unit = 0;
+		while (value >= 1024.0 && unit + 1 < sizeof(UNITS) / sizeof(UNITS[0])) {
+			value /= 1024.0;
+			++unit;
+		}
+		char text[32];
+		std::snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.2f %s", value, UNITS[unit]);
+		return text;
+	}
+
+	bool BuildMemoryTimeline(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		MemoryTimeline& timeline, std::string* error)
+	{
+		timeline.liveBytes.resize(passMap.size());
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx)
+			timeline.liveBytes[queIdx].assign(passMap[queIdx].size(), 0);
+		timeline.peakBytes = 0;
+		timeline.peakPass = INVALID_PASS_LOCATE;
+		timeline.peakResources.clear();
+		std::fill(timeline.heapPeakBytes, timeline.heapPeakBytes + HEAP_TYPE_COUNT, 0);
+		timeline.totalBytes = 0;
+		timeline.unsizedResources = 0;
+		timeline.timed = false;
+		ReachabilityIndex reachability;
+		if (!reachability.Build(passMap, ReachabilityIndex::Options(), error)) return false;
+		const PassIndex& index = reachability.Index();
+		const uint32_t passCount = index.PassCount();
+
+		/** 创建与删除资源的pass的编号，没有时为INVALID_INDEX，没有记录大小的资源不参与计算 */
+		std::vector<uint32_t> creates(resMap.size(), INVALID_INDEX), destroys(resMap.size(), INVALID_INDEX);
+		std::vector<ResourceIdx> sized;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			const Resource& resource = resMap[resIdx];
+			if (resource.size == 0) {
+				++timeline.unsizedResources;
+				continue;
+			}
+			bool valid = (resource.firstCreate == INVALID_PASS_LOCATE || index.Contains(resource.firstCreate))
+				&& (resource.lastDestroy == INVALID_PASS_LOCATE || index.Contains(resource.lastDestroy))
+				&& resource.heapType < HEAP_TYPE_COUNT;
+			if (!valid) {
+				if (error) *error = "resource " + resource.name + " has an invalid lifetime or heap type";
+				return false;
+			}
+			if (resource.firstCreate != INVALID_PASS_LOCATE) creates[resIdx] = index.ToId(resource.firstCreate);
+			if (resource.lastDestroy != INVALID_PASS_LOCATE) destroys[resIdx] = index.ToId(resource.lastDestroy);
+			/** 删除先于创建时只在创建的pass上存活 */
+			if (creates[resIdx] != INVALID_INDEX && destroys[resIdx] != INVALID_INDEX
+				&& reachability.HappensBefore(destroys[resIdx], creates[resIdx]))
+				destroys[resIdx] = creates[resIdx];
+			sized.push_back(resIdx);
+			timeline.totalBytes += resource.GetAlignedSize();
+		}
+		if (passCount == 0) return true;
+
+		timeline.timed = true;
+		for (const auto& queue : passMap)
+			for (const auto& pass : queue)
+				timeline.timed = timeline.timed && pass.HasTiming();
+		auto passAt = [&](uint32_t id) -> const Pass& {
+			PassLocate locate = index.ToLocate(id);
+			return passMap[locate.queueIndex][locate.inqueueIndex];
+		};
+
+		std::vector<uint64_t> heapBytes(static_cast<size_t>(passCount) * HEAP_TYPE_COUNT, 0);
+		/** 按时间计算时每个资源存活的时间段[begin, end)，按先后关系计算时每个资源在各个queue上存活的pass的范围 */
+		std::vector<uint64_t> begins, ends;
+		const uint32_t queueCount = index.QueueCount();
+		std::vector<uint32_t> ranges;
+		if (timeline.timed) {
+			/** 资源从创建的pass开始到删除的pass结束之间存活，按时间扫描所有事件，
+			 * 同一时刻先结束再开始，每个pass取其开始时存活的资源 */
+			struct Event {
+				uint64_t time;
+				uint8_t kind; /**< 0: 资源结束，1: 资源开始，2: pass开始 */
+				uint32_t target; /**< 资源的索引或者pass的编号 */
+			};
+			std::vector<Event> events;
+			events.reserve(sized.size() * 2 + passCount);
+			begins.assign(resMap.size(), 0);
+			ends.assign(resMap.size(), UINT64_MAX);
+			for (ResourceIdx resIdx : sized) {
+				if (creates[resIdx] != INVALID_INDEX) begins[resIdx] = passAt(creates[resIdx]).startTime;
+				if (destroys[resIdx] != INVALID_INDEX) ends[resIdx] = passAt(destroys[resIdx]).endTime;
+				/** 不同queue上的删除在时间上可能早于创建，此时只在创建的pass上存活 */
+				if (ends[resIdx] < begins[resIdx]) ends[resIdx] = passAt(creates[resIdx]).endTime;
+				events.push_back({ begins[resIdx], 1, resIdx });
+				if (ends[resIdx] != UINT64_MAX) events.push_back({ ends[resIdx], 0, resIdx });
+			}
+			for (uint32_t id = 0; id < passCount; ++id)
+				events.push_back({ passAt(id).startTime, 2, id });
+			std::sort(events.begin(), events.end(), [](const Event& lhs, const Event& rhs) {
+				if (lhs.time != rhs.time) return lhs.time < rhs.time;
+				if (lhs.kind != rhs.kind) return lhs.kind < rhs.kind;
+				return lhs.target < rhs.target;
+			});
+			uint64_t heapLive[HEAP_TYPE_COUNT] = {};
+			for (const Event& event : events) {
+				if (event.kind == 2) {
+					std::copy(heapLive, heapLive + HEAP_TYPE_COUNT, heapBytes.begin() + static_cast<size_t>(event.target) * HEAP_TYPE_COUNT);
+					continue;
+				}
+				const Resource& resource = resMap[event.target];
+				if (event.kind == 1) heapLive[resource.heapType] += resource.GetAlignedSize();
+				else heapLive[resource.heapType] -= resource.GetAlignedSize();
+			}
+		}
+		else {
+			/** 没有完整的时间时按先后关系估计: 资源在所有不先于其创建、也不晚于其删除的pass执行时都可能存活，
+			 * 这些pass在每个queue上是连续的一段，用差分数组累加，每个queue的末尾多留一个位置 */
+			std::vector<int64_t> deltas(static_cast<size_t>(passCount + queueCount) * HEAP_TYPE_COUNT, 0);
+			ranges.assign(static_cast<size_t>(resMap.size()) * queueCount * 2, 0);
+			for (ResourceIdx resIdx : sized) {
+				const Resource& resource = resMap[resIdx];
+				int64_t bytes = static_cast<int64_t>(resource.GetAlignedSize());
+				for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+					uint32_t first = 0, last = index.QueueEnd(queIdx) - index.QueueBegin(queIdx);
+					if (creates[resIdx] != INVALID_INDEX)
+						first = partitionQueue(index, queIdx, [&](uint32_t id) {
+							return !reachability.HappensBefore(id, creates[resIdx]);
+						});
+					if (destroys[resIdx] != INVALID_INDEX)
+						last = partitionQueue(index, queIdx, [&](uint32_t id) {
+							return reachability.HappensBefore(destroys[resIdx], id);
+						});
+					size_t rangeIdx = (static_cast<size_t>(resIdx) * queueCount + queIdx) * 2;
+					ranges[rangeIdx] = first;
+					ranges[rangeIdx + 1] = last;
+					if (first >= last) continue;
+					uint32_t slot = index.QueueBegin(queIdx) + queIdx;
+					deltas[static_cast<size_t>(slot + first) * HEAP_TYPE_COUNT + resource.heapType] += bytes;
+					deltas[static_cast<size_t>(slot + last) * HEAP_TYPE_COUNT + resource.heapType] -= bytes;
+				}
+			}
+			for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+				int64_t heapLive[HEAP_TYPE_COUNT] = {};
+				for (uint32_t id = index.QueueBegin(queIdx); id < index.QueueEnd(queIdx); ++id) {
+					for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+						heapLive[heap] += deltas[static_cast<size_t>(id + queIdx) * HEAP_TYPE_COUNT + heap];
+						heapBytes[static_cast<size_t>(id) * HEAP_TYPE_COUNT + heap] = static_cast<uint64_t>(heapLive[heap]);
+					}
+				}
+			}
+		}
+
+		/** 按拓扑序找峰值，保证相同的峰值时取最先执行的pass */
+		uint32_t peakId = INVALID_INDEX;
+		for (uint32_t rank = 0; rank < passCount; ++rank) {
+			uint32_t id = reachability.Ordered(rank);
+			uint64_t live = 0;
+			for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+				uint64_t bytes = heapBytes[static_cast<size_t>(id) * HEAP_TYPE_COUNT + heap];
+				timeline.heapPeakBytes[heap] = std::max(timeline.heapPeakBytes[heap], bytes);
+				live += bytes;
+			}
+			PassLocate locate = index.ToLocate(id);
+			timeline.liveBytes[locate.queueIndex][locate.inqueueIndex] = live;
+			bool earlier = timeline.timed && peakId != INVALID_INDEX && live == timeline.peakBytes
+				&& passAt(id).startTime < passAt(peakId).startTime;
+			if (live > timeline.peakBytes || peakId == INVALID_INDEX || earlier) {
+				timeline.peakBytes = live;
+				timeline.peakPass = locate;
+				peakId = id;
+			}
+		}
+
+		const uint64_t peakTime = passAt(peakId).startTime;
+		for (ResourceIdx resIdx : sized) {
+			size_t rangeIdx = (static_cast<size_t>(resIdx) * queueCount + timeline.peakPass.queueIndex) * 2;
+			bool live = timeline.timed ? begins[resIdx] <= peakTime && peakTime < ends[resIdx]
+				: ranges[rangeIdx] <= timeline.peakPass.inqueueIndex && timeline.peakPass.inqueueIndex < ranges[rangeIdx + 1];
+			if (live) timeline.peakResources.push_back(resIdx);
+		}
+		std::stable_sort(timeline.peakResources.begin(), timeline.peakResources.end(),
+			[&resMap](ResourceIdx lhs, ResourceIdx rhs) {
+				return resMap[lhs].GetAlignedSize() > resMap[rhs].GetAlignedSize();
+			});
+		return true;
+	}
+
+	void HighlightMemoryTimeline(PipelineGraph& graph, const MemoryTimeline& timeline)
+	{
+		const auto& resMap = graph.GetResourceMap();
+		if (timeline.peakPass == INVALID_PASS_LOCATE || timeline.peakBytes == 0) return;
+		graph.MarkPass(timeline.peakPass, Rectangle::HIGHLIGHT, "memory peak " + DescribeBytes(timeline.peakBytes));
+		for (ResourceIdx resIdx : timeline.peakResources)
+			graph.MarkResource(resIdx, Rectangle::HIGHLIGHT,
+				DescribeBytes(resMap[resIdx].GetAlignedSize()) + " at memory peak");
+
+		/** 按资源矩形的左右边界累加占用，得到沿x方向的阶梯形面积图 */
+		struct Edge {
+			float x;
+			int64_t bytes;
+		};
+		std::vector<Edge> edges;
+		edges.reserve(resMap.size() * 2);
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			if (resMap[resIdx].size == 0) continue;
+			const Rectangle& rect = graph.GetResourceRect(resIdx);
+			int64_t bytes = static_cast<int64_t>(resMap[resIdx].GetAlignedSize());
+			edges.push_back({ rect.leftUpPoint.x, bytes });
+			edges.push_back({ rect.leftUpPoint.x + rect.width, -bytes });
+		}
+		if (edges.empty()) return;
+		std::sort(edges.begin(), edges.end(), [](const Edge& lhs, const Edge& rhs) { return lhs.x < rhs.x; });
+		std::vector< std::pair<float, int64_t> > steps; /**< 每个边界之后的占用 */
+		int64_t live = 0, maxLive = 0;
+		for (size_t edgeIdx = 0; edgeIdx < edges.size(); ++edgeIdx) {
+			live += edges[edgeIdx].bytes;
+			if (edgeIdx + 1 < edges.size() && edges[edgeIdx + 1].x == edges[edgeIdx].x) continue;
+			steps.push_back(std::make_pair(edges[edgeIdx].x, live));
+			maxLive = std::max(maxLive, live);
+		}
+
+		float top = graph.GetContentBottom() + RESOURCE_PADDING;
+		float bottom = top + MEMORY_CHART_HEIGHT;
+		auto height = [&](int64_t bytes) {
+			return bottom - static_cast<float>(static_cast<double>(bytes) / static_cast<double>(maxLive)) * MEMORY_CHART_HEIGHT;
+		};
+		Polygon chart;
+		chart.type = Polygon::MEMORY;
+		chart.points.push_back({ steps.front().first, bottom });
+		int64_t previous = 0;
+		for (const auto& step : steps) {
+			chart.points.push_back({ step.first, height(previous) });
+			chart.points.push_back({ step.first, height(step.second) });
+			previous = step.second;
+		}
+		chart.desc = "memory: peak " + DescribeBytes(timeline.peakBytes) + ", total " + DescribeBytes(timeline.totalBytes);
+		for (uint8_t heap = 0; heap < HEAP_TYPE_COUNT; ++heap) {
+			if (timeline.heapPeakBytes[heap] != 0)
+				chart.desc += std::string(", ") + HEAP_TYPE_NAMES[heap] + " heap " + DescribeBytes(timeline.heapPeakBytes[heap]);
+		}
+		graph.AddOverlay(chart);
+	}
+
+}
@@ -0,0 +1,41 @@
+#ifndef MEMORY_TIMELINE_H
+#define MEMORY_TIMELINE_H
+
+#include "ppfg.h"
+
+/** 估计资源占用的内存随pass的变化
+ * 所有pass都记录了时间时，资源从firstCreate开始到lastDestroy结束之间存活，按时间扫描得到每个pass开始时的占用；
+ * 否则与PlanAliasing相同，按先后关系(happens-before)估计: 资源在不先于firstCreate、也不晚于lastDestroy的pass执行时
+ * 都可能存活，因此不同queue上没有同步的pass会看到对方的资源。没有创建或删除的pass时分别延伸到图的两端；
+ * 资源占用的大小为按对齐向上取整后的Resource::size，没有记录大小的资源不参与计算 */
+namespace PipelineProfilingGraph {
+
+	struct MemoryTimeline {
+		std::vector< std::vector<uint64_t> > liveBytes; /**< 每个pass执行时存活的资源占用的字节数，与passMap的形状相同 */
+		uint64_t peakBytes; /**< 所有堆合计的峰值 */
+		PassLocate peakPass; /**< 第一次达到峰值的pass，没有pass时为INVALID_PASS_LOCATE */
+		bool timed; /**< 是否按pass记录的时间计算，否则按先后关系估计 */
+		std::vector<ResourceIdx> peakResources; /**< 峰值时存活的资源，按占用从大到小排列 */
+		uint64_t heapPeakBytes[HEAP_TYPE_COUNT]; /**< 每个堆单独的峰值，即该堆需要的大小 */
+		uint64_t totalBytes; /**< 所有资源占用之和，即不复用内存时需要的大小 */
+		uint32_t unsizedResources; /**< 没有记录大小的资源的数量 */
+	};
+
+	/** 将字节数转换成便于阅读的形式，按大小选择B、KiB、MiB或GiB */
+	std::string DescribeBytes(uint64_t bytes);
+	/** 计算每个pass执行时的内存占用以及峰值
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param timeline 计算的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 图中引用了未知的pass或者fence之间存在环时返回false */
+	bool BuildMemoryTimeline(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		MemoryTimeline& timeline, std::string* error = nullptr);
+	/** 在资源下方绘制内存占用的面积图，并突出显示峰值时的pass以及存活的资源
+	 * 面积图沿x方向按资源矩形的范围累加，与图中资源的显示一致
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightMemoryTimeline(PipelineGraph& graph, const MemoryTimeline& timeline);
+
+}
+
+#endif // MEMORY_TIMELINE_H
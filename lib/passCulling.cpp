@@ -0,0 +1,263 @@
+#include "passCulling.h"
+#include "passOrder.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	void FindCullingRoots(const std::vector<Resource>& resMap, std::vector<ResourceIdx>& roots)
+	{
+		roots.clear();
+		auto presented = [](const std::vector<uint16_t>& states) {
+			for (uint16_t state : states)
+				if (state & STATE_PRESENT) return true;
+			return false;
+		};
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			if (presented(resMap[resIdx].readStates) || presented(resMap[resIdx].writeStates))
+				roots.push_back(resIdx);
+		if (!roots.empty()) return;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			if (resMap[resIdx].lastDestroy == INVALID_PASS_LOCATE)
+				roots.push_back(resIdx);
+	}
+
+	bool CullUnusedPasses(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		const std::vector<ResourceIdx>& roots, CullingResult& result, std::string* error)
+	{
+		if (roots.empty()) {
+			if (error) *error = "no output resources";
+			return false;
+		}
+		PassIndex index(passMap);
+		const uint32_t passCount = index.PassCount();
+		/** 以CSR方式存储每个pass读取的资源 */
+		std::vector<uint32_t> readOffsets(passCount + 1, 0);
+		for (const auto& resource : resMap) {
+			for (const auto& read : resource.readPasses) {
+				if (!index.Contains(read)) {
+					if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+					return false;
+				}
+				++readOffsets[index.ToId(read) + 1];
+			}
+			for (const auto& write : resource.writedPasses) {
+				if (!index.Contains(write)) {
+					if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+					return false;
+				}
+			}
+			for (const auto& barrier : resource.barriers) {
+				if (!index.Contains(barrier.submitPass)) {
+					if (error) *error = "resource " + resource.name + " has a barrier in an unknown pass";
+					return false;
+				}
+			}
+			if ((resource.firstCreate != INVALID_PASS_LOCATE && !index.Contains(resource.firstCreate))
+				|| (resource.lastDestroy != INVALID_PASS_LOCATE && !index.Contains(resource.lastDestroy))) {
+				if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+		}
+		for (uint32_t id = 0; id < passCount; ++id)
+			readOffsets[id + 1] += readOffsets[id];
+		std::vector<ResourceIdx> reads(readOffsets.back());
+		std::vector<uint32_t> cursor(readOffsets.begin(), readOffsets.end() - 1);
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			for (const auto& read : resMap[resIdx].readPasses)
+				reads[cursor[index.ToId(read)]++] = resIdx;
+
+		std::vector<uint8_t> livePasses(passCount, 0);
+		std::vector<uint8_t> liveResources(resMap.size(), 0);
+		std::vector<uint32_t> passStack;
+		std::vector<ResourceIdx> resourceStack;
+		auto markPass = [&](const PassLocate& locate) {
+			uint32_t id = index.ToId(locate);
+			if (livePasses[id]) return;
+			livePasses[id] = 1;
+			passStack.push_back(id);
+		};
+		auto markResource = [&](ResourceIdx resIdx) {
+			if (liveResources[resIdx]) return;
+			liveResources[resIdx] = 1;
+			resourceStack.push_back(resIdx);
+		};
+		for (ResourceIdx root : roots) {
+			if (root >= resMap.size()) {
+				if (error) *error = "unknown output resource " + std::to_string(root);
+				return false;
+			}
+			markResource(root);
+		}
+		while (!passStack.empty() || !resourceStack.empty()) {
+			if (!resourceStack.empty()) {
+				const Resource& resource = resMap[resourceStack.back()];
+				resourceStack.pop_back();
+				for (const auto& write : resource.writedPasses) markPass(write);
+				continue;
+			}
+			uint32_t id = passStack.back();
+			passStack.pop_back();
+			for (uint32_t readIdx = readOffsets[id]; readIdx < readOffsets[id + 1]; ++readIdx)
+				markResource(reads[readIdx]);
+			PassLocate locate = index.ToLocate(id);
+			for (const auto& signal : passMap[locate.queueIndex][locate.inqueueIndex].depPasses) {
+				if (!index.Contains(signal)) {
+					if (error) *error = "pass " + passMap[locate.queueIndex][locate.inqueueIndex].name
+						+ " waits for an unknown pass";
+					return false;
+				}
+				markPass(signal);
+			}
+		}
+
+		result.deadPasses.clear();
+		result.deadResources.clear();
+		result.livePassCount = 0;
+		for (uint32_t id = 0; id < passCount; ++id) {
+			if (livePasses[id]) ++result.livePassCount;
+			else result.deadPasses.push_back(index.ToLocate(id));
+		}
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx)
+			if (!liveResources[resIdx]) result.deadResources.push_back(resIdx);
+		return true;
+	}
+
+	void HighlightCulled(PipelineGraph& graph, const CullingResult& result)
+	{
+		for (const auto& pass : result.deadPasses)
+			graph.MarkPass(pass, Rectangle::DIMMED, "unused");
+		for (ResourceIdx resIdx : result.deadResources)
+			graph.MarkResource(resIdx, Rectangle::DIMMED, "unused");
+	}
+
+	bool RemoveCulled(std::vector<Queue>& passMap, std::vector<Resource>& resMap, const CullingResult& result,
+		std::string* error)
+	{
+		PassIndex index(passMap);
+		std::vector<uint32_t> order;
+		if (!TopologicalOrder(passMap, index, order, error)) return false;
+		const uint32_t queueCount = index.QueueCount();
+
+		/** 计算每个pass删除后的位置，被删除的pass为INVALID_PASS_LOCATE */
+		std::vector< std::vector<PassLocate> > remap(passMap.size());
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx)
+			remap[queIdx].resize(passMap[queIdx].size());
+		for (const auto& pass : result.deadPasses)
+			remap[pass.queueIndex][pass.inqueueIndex] = INVALID_PASS_LOCATE;
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			PassIdx kept = 0;
+			for (PassIdx passIdx = 0; passIdx < passMap[queIdx].size(); ++passIdx) {
+				bool dead = remap[queIdx][passIdx] == INVALID_PASS_LOCATE;
+				remap[queIdx][passIdx] = dead ? INVALID_PASS_LOCATE : PassLocate{ queIdx, kept++ };
+			}
+		}
+		auto moved = [&remap](const PassLocate& locate) {
+			return locate == INVALID_PASS_LOCATE ? INVALID_PASS_LOCATE
+				: remap[locate.queueIndex][locate.inqueueIndex];
+		};
+		/** 创建或删除资源的pass被删除时，生命周期只会延长: 创建移到之前最近的pass，删除移到之后最近的pass，
+		 * 找不到时视为一直存在 */
+		auto movedCreate = [&remap](const PassLocate& locate) {
+			if (locate == INVALID_PASS_LOCATE) return INVALID_PASS_LOCATE;
+			const auto& queue = remap[locate.queueIndex];
+			for (PassIdx passIdx = locate.inqueueIndex + 1; passIdx-- > 0;)
+				if (queue[passIdx] != INVALID_PASS_LOCATE) return queue[passIdx];
+			return INVALID_PASS_LOCATE;
+		};
+		auto movedDestroy = [&remap](const PassLocate& locate) {
+			if (locate == INVALID_PASS_LOCATE) return INVALID_PASS_LOCATE;
+			const auto& queue = remap[locate.queueIndex];
+			for (PassIdx passIdx = locate.inqueueIndex; passIdx < queue.size(); ++passIdx)
+				if (queue[passIdx] != INVALID_PASS_LOCATE) return queue[passIdx];
+			return INVALID_PASS_LOCATE;
+		};
+
+		/** 按拓扑序计算每个被删除的pass完成时一定已经完成的有用的pass，
+		 * clock中第q项为queue q上这样的pass中最后一个删除后的索引加1，0表示没有 */
+		std::vector<uint32_t> deadClocks(static_cast<size_t>(index.PassCount()) * queueCount, 0);
+		for (uint32_t id : order) {
+			PassLocate locate = index.ToLocate(id);
+			if (moved(locate) != INVALID_PASS_LOCATE) continue;
+			uint32_t* clock = deadClocks.data() + static_cast<size_t>(id) * queueCount;
+			auto merge = [&](const PassLocate& signal) {
+				PassLocate kept = moved(signal);
+				if (kept == INVALID_PASS_LOCATE) {
+					const uint32_t* source = deadClocks.data() + static_cast<size_t>(index.ToId(signal)) * queueCount;
+					for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx)
+						clock[queIdx] = std::max(clock[queIdx], source[queIdx]);
+				}
+				else {
+					clock[kept.queueIndex] = std::max(clock[kept.queueIndex], kept.inqueueIndex + 1);
+				}
+			};
+			if (locate.inqueueIndex != 0) merge({ locate.queueIndex, locate.inqueueIndex - 1 });
+			for (const auto& signal : passMap[locate.queueIndex][locate.inqueueIndex].depPasses)
+				merge(signal);
+		}
+
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			Queue& queue = passMap[queIdx];
+			PassIdx kept = 0;
+			for (PassIdx passIdx = 0; passIdx < queue.size(); ++passIdx) {
+				if (remap[queIdx][passIdx] == INVALID_PASS_LOCATE) continue;
+				Pass& pass = queue[passIdx];
+				pass.locate = remap[queIdx][passIdx];
+				/** 有用的pass等待的pass都是有用的 */
+				for (auto& signal : pass.depPasses) signal = moved(signal);
+				/** 紧接在之前的被删除的pass所等待的fence转移到该pass上，已经等待了同一queue上更晚的pass时不需要转移 */
+				if (passIdx != 0 && remap[queIdx][passIdx - 1] == INVALID_PASS_LOCATE) {
+					const uint32_t* clock = deadClocks.data() + static_cast<size_t>(index.ToId({ queIdx, passIdx - 1 })) * queueCount;
+					for (QueueIdx signalQueue = 0; signalQueue < queueCount; ++signalQueue) {
+						if (signalQueue == queIdx || clock[signalQueue] == 0) continue;
+						bool covered = false;
+						for (const auto& signal : pass.depPasses)
+							covered = covered || (signal.queueIndex == signalQueue && signal.inqueueIndex + 1 >= clock[signalQueue]);
+						if (!covered) pass.depPasses.push_back({ signalQueue, clock[signalQueue] - 1 });
+					}
+				}
+				if (kept != passIdx) queue[kept] = std::move(pass);
+				++kept;
+			}
+			queue.erase(queue.begin() + kept, queue.end());
+		}
+
+		size_t deadCursor = 0;
+		ResourceIdx keptResources = 0;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			if (deadCursor < result.deadResources.size() && result.deadResources[deadCursor] == resIdx) {
+				++deadCursor;
+				continue;
+			}
+			Resource& resource = resMap[resIdx];
+			/** 有用的资源只被有用的pass写入，但是可能被没有用的pass读取 */
+			size_t keptReads = 0;
+			for (size_t readIdx = 0; readIdx < resource.readPasses.size(); ++readIdx) {
+				PassLocate read = moved(resource.readPasses[readIdx]);
+				if (read == INVALID_PASS_LOCATE) continue;
+				resource.readPasses[keptReads] = read;
+				if (readIdx < resource.readStates.size())
+					resource.readStates[keptReads] = resource.readStates[readIdx];
+				++keptReads;
+			}
+			resource.readPasses.resize(keptReads);
+			if (!resource.readStates.empty()) resource.readStates.resize(keptReads);
+			for (auto& write : resource.writedPasses) write = moved(write);
+			resource.firstCreate = movedCreate(resource.firstCreate);
+			resource.lastDestroy = movedDestroy(resource.lastDestroy);
+			size_t keptBarriers = 0;
+			for (auto& barrier : resource.barriers) {
+				barrier.submitPass = moved(barrier.submitPass);
+				if (barrier.submitPass == INVALID_PASS_LOCATE) continue;
+				if (&resource.barriers[keptBarriers] != &barrier)
+					resource.barriers[keptBarriers] = std::move(barrier);
+				++keptBarriers;
+			}
+			resource.barriers.resize(keptBarriers);
+			if (keptResources != resIdx) resMap[keptResources] = std::move(resource);
+			++keptResources;
+		}
+		resMap.resize(keptResources);
+		return true;
+	}
+
+}
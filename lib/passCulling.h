@@ -0,0 +1,43 @@
+#ifndef PASS_CULLING_H
+#define PASS_CULLING_H
+
+#include "ppfg.h"
+
+/** 找出对最终输出没有贡献的pass与资源
+ * 从作为输出的资源开始反向遍历: 写入有用资源的pass是有用的，有用的pass读取的资源是有用的，
+ * 有用的pass通过fence等待的pass也是有用的；只创建或删除资源不会使pass变得有用
+ * 遍历不考虑访问的先后，被之后的写入完全覆盖的写入同样被视为有用 */
+namespace PipelineProfilingGraph {
+
+	struct CullingResult {
+		std::vector<PassLocate> deadPasses; /**< 没有用的pass，按queue以及queue内的索引排列 */
+		std::vector<ResourceIdx> deadResources; /**< 没有用的资源，按索引排列 */
+		size_t livePassCount; /**< 有用的pass的数量 */
+	};
+
+	/** 找出默认作为输出的资源: 以STATE_PRESENT访问的资源，没有这样的资源时使用一直未被删除的资源 */
+	void FindCullingRoots(const std::vector<Resource>& resMap, std::vector<ResourceIdx>& roots);
+	/** 找出没有用的pass与资源
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param roots 作为输出的资源，为空时返回false
+	 * @param result 分析的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 没有输出的资源，或者图中引用了未知的pass或者资源时返回false */
+	bool CullUnusedPasses(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		const std::vector<ResourceIdx>& roots, CullingResult& result, std::string* error = nullptr);
+	/** 在图中将没有用的pass与资源显示为灰色
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightCulled(PipelineGraph& graph, const CullingResult& result);
+	/** 从图中删除没有用的pass与资源，以及它们的访问和barrier，其余pass的位置依次前移
+	 * 创建或删除资源的pass被删除时，资源的生命周期会延长到同一queue上相邻的pass；
+	 * 被删除的pass等待的fence仍然约束着同一queue上之后的pass，因此转移到之后最近的有用的pass上
+	 * @param error 失败时的错误信息，可以为空
+	 * @return fence引用了未知的pass或者fence之间存在环时返回false，此时图不会被修改
+	 * @remark 调用后需要重新构造PipelineGraph */
+	bool RemoveCulled(std::vector<Queue>& passMap, std::vector<Resource>& resMap, const CullingResult& result,
+		std::string* error = nullptr);
+
+}
+
+#endif // PASS_CULLING_H
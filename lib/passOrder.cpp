@@ -0,0 +1,87 @@
+#include "passOrder.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	PassLocate PassIndex::ToLocate(uint32_t id) const
+	{
+		/** 第一个大于id的偏移的前一个queue即pass所在的queue，空queue会被跳过 */
+		auto next = std::upper_bound(m_offsets.begin(), m_offsets.end(), id);
+		QueueIdx queIdx = static_cast<QueueIdx>(next - m_offsets.begin() - 1);
+		return { queIdx, id - m_offsets[queIdx] };
+	}
+
+	bool TopologicalOrder(const std::vector<Queue>& passMap, const PassIndex& index,
+		std::vector<uint32_t>& order, std::string* error)
+	{
+		const uint32_t passCount = index.PassCount();
+		/** fence的后继以CSR的方式存储，queue内的后继即下一个编号 */
+		std::vector<uint32_t> inDegrees(passCount, 0);
+		std::vector<uint32_t> fenceOffsets(passCount + 1, 0);
+		for (const auto& queue : passMap) {
+			for (const auto& pass : queue) {
+				uint32_t id = index.ToId(pass.locate);
+				inDegrees[id] = (pass.locate.inqueueIndex != 0 ? 1 : 0) + static_cast<uint32_t>(pass.depPasses.size());
+				for (const auto& dep : pass.depPasses) {
+					if (!index.Contains(dep)) {
+						if (error) *error = "pass " + pass.name + " has a fence on an unknown pass";
+						return false;
+					}
+					++fenceOffsets[index.ToId(dep) + 1];
+				}
+			}
+		}
+		for (uint32_t id = 0; id < passCount; ++id)
+			fenceOffsets[id + 1] += fenceOffsets[id];
+		std::vector<uint32_t> fenceTargets(fenceOffsets.back());
+		std::vector<uint32_t> cursor(fenceOffsets.begin(), fenceOffsets.end() - 1);
+		for (const auto& queue : passMap)
+			for (const auto& pass : queue)
+				for (const auto& dep : pass.depPasses)
+					fenceTargets[cursor[index.ToId(dep)]++] = index.ToId(pass.locate);
+
+		/** 按入度为0的顺序依次输出，order本身就是待处理的队列 */
+		order.clear();
+		order.reserve(passCount);
+		for (QueueIdx queIdx = 0; queIdx < index.QueueCount(); ++queIdx) {
+			uint32_t first = index.QueueBegin(queIdx);
+			if (first != index.QueueEnd(queIdx) && inDegrees[first] == 0) order.push_back(first);
+		}
+		for (size_t head = 0; head < order.size(); ++head) {
+			uint32_t id = order[head];
+			auto release = [&inDegrees, &order](uint32_t next) {
+				if (--inDegrees[next] == 0) order.push_back(next);
+			};
+			PassLocate locate = index.ToLocate(id);
+			if (id + 1 < index.QueueEnd(locate.queueIndex)) release(id + 1);
+			for (uint32_t fenceIdx = fenceOffsets[id]; fenceIdx < fenceOffsets[id + 1]; ++fenceIdx)
+				release(fenceTargets[fenceIdx]);
+		}
+		if (order.size() != passCount) {
+			if (error) *error = "fences form a cycle";
+			return false;
+		}
+
+		/** 按层(最长路径的长度，与布局中pass的列一致)重新排列，同一层中的pass按编号排列 */
+		std::vector<uint32_t> depths(passCount, 0);
+		uint32_t maxDepth = 0;
+		for (uint32_t id : order) {
+			uint32_t depth = depths[id];
+			maxDepth = std::max(maxDepth, depth);
+			PassLocate locate = index.ToLocate(id);
+			if (id + 1 < index.QueueEnd(locate.queueIndex))
+				depths[id + 1] = std::max(depths[id + 1], depth + 1);
+			for (uint32_t fenceIdx = fenceOffsets[id]; fenceIdx < fenceOffsets[id + 1]; ++fenceIdx)
+				depths[fenceTargets[fenceIdx]] = std::max(depths[fenceTargets[fenceIdx]], depth + 1);
+		}
+		std::vector<uint32_t> depthOffsets(passCount != 0 ? maxDepth + 2 : 1, 0);
+		for (uint32_t id = 0; id < passCount; ++id)
+			++depthOffsets[depths[id] + 1];
+		for (size_t depth = 1; depth < depthOffsets.size(); ++depth)
+			depthOffsets[depth] += depthOffsets[depth - 1];
+		for (uint32_t id = 0; id < passCount; ++id)
+			order[depthOffsets[depths[id]]++] = id;
+		return true;
+	}
+
+}
@@ -0,0 +1,52 @@
+#ifndef PASS_ORDER_H
+#define PASS_ORDER_H
+
+#include "ppfg.h"
+
+/** 分析渲染图时使用的pass编号与拓扑序
+ * pass按queue以及queue内的索引依次编号，便于各种分析使用扁平数组 */
+namespace PipelineProfilingGraph {
+
+	class PassIndex {
+	public:
+		PassIndex() : m_offsets(1, 0) {}
+		explicit PassIndex(const std::vector<Queue>& passMap) { Build(passMap); }
+		void Build(const std::vector<Queue>& passMap) {
+			m_offsets.assign(1, 0);
+			m_offsets.reserve(passMap.size() + 1);
+			for (const auto& queue : passMap)
+				m_offsets.push_back(m_offsets.back() + static_cast<uint32_t>(queue.size()));
+		}
+		/** 所有pass的数量 */
+		uint32_t PassCount() const { return m_offsets.back(); }
+		QueueIdx QueueCount() const { return static_cast<QueueIdx>(m_offsets.size() - 1); }
+		/** 某个queue中第一个pass的编号 */
+		uint32_t QueueBegin(QueueIdx queIdx) const { return m_offsets[queIdx]; }
+		/** 某个queue中最后一个pass之后的编号 */
+		uint32_t QueueEnd(QueueIdx queIdx) const { return m_offsets[queIdx + 1]; }
+		bool Contains(const PassLocate& locate) const {
+			return locate.queueIndex < QueueCount()
+				&& locate.inqueueIndex < QueueEnd(locate.queueIndex) - QueueBegin(locate.queueIndex);
+		}
+		uint32_t ToId(const PassLocate& locate) const {
+			return m_offsets[locate.queueIndex] + locate.inqueueIndex;
+		}
+		PassLocate ToLocate(uint32_t id) const;
+	private:
+		std::vector<uint32_t> m_offsets; /**< 每个queue中第一个pass的编号，最后一项为pass的总数 */
+	};
+
+	/** 计算所有pass的拓扑序，pass依赖于同一queue上的前一个pass以及其fence等待的pass
+	 * pass按层排列，层即到达该pass的最长路径的长度，与布局中pass所在的列一致，
+	 * 同一层中的pass按queue以及queue内的索引排列，因此互相之间没有先后关系的pass的顺序与图中看到的一致
+	 * @param passMap 渲染图中所有的pass
+	 * @param index passMap对应的编号
+	 * @param order 按拓扑序排列的pass编号
+	 * @param error 失败时的错误信息，可以为空
+	 * @return fence引用了未知的pass或者fence之间存在环时返回false */
+	bool TopologicalOrder(const std::vector<Queue>& passMap, const PassIndex& index,
+		std::vector<uint32_t>& order, std::string* error = nullptr);
+
+}
+
+#endif // PASS_ORDER_H
@@ -0,0 +1,249 @@
+#include "perfettoExport.h"
+#include "protoWriter.h"
+#include "passOrder.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+		/** perfetto_trace.proto中用到的字段号 */
+		const uint32_t TRACE_PACKET = 1;
+		const uint32_t PACKET_TIMESTAMP = 8;
+		const uint32_t PACKET_SEQUENCE_ID = 10;
+		const uint32_t PACKET_TRACK_EVENT = 11;
+		const uint32_t PACKET_SEQUENCE_FLAGS = 13;
+		const uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+		const uint32_t TRACK_UUID = 1;
+		const uint32_t TRACK_NAME = 2;
+		const uint32_t TRACK_PARENT_UUID = 5;
+		const uint32_t TRACK_COUNTER = 8;
+		const uint32_t EVENT_TYPE = 9;
+		const uint32_t EVENT_TRACK_UUID = 11;
+		const uint32_t EVENT_NAME = 23;
+		const uint32_t EVENT_COUNTER_VALUE = 30;
+		const uint32_t EVENT_FLOW_IDS = 47;
+		const uint32_t EVENT_TERMINATING_FLOW_IDS = 48;
+
+		const uint64_t SEQ_INCREMENTAL_STATE_CLEARED = 1;
+		const uint32_t SEQUENCE_ID = 1;
+
+		enum EventType : uint8_t {
+			SLICE_BEGIN = 1,
+			SLICE_END = 2,
+			INSTANT = 3,
+			COUNTER = 4,
+		};
+
+		/** 等待编码的一个TrackEvent */
+		struct TraceEvent {
+			uint64_t timestamp;
+			uint64_t track;
+			EventType type;
+			const std::string* name; /**< 指向图中的名称，END和COUNTER事件为空 */
+			int64_t counterValue;
+			std::vector<uint64_t> flows; /**< 从该slice出发的flow */
+			std::vector<uint64_t> terminatingFlows; /**< 终止于该slice的flow */
+			bool emptySlice; /**< 持续时间为0的slice的END事件，需要排在同一时刻的BEGIN之后 */
+		};
+
+		/** 按时间布局时使用图自身的时间刻度，否则使用PERFETTO_NS_PER_UNIT */
+		uint64_t toTimestamp(const PipelineGraph& graph, float x) {
+			if (graph.GetNsPerUnit() > 0.0) return graph.TimeAt(x);
+			if (x < 0.0f) x = 0.0f;
+			return static_cast<uint64_t>(static_cast<double>(x) * PERFETTO_NS_PER_UNIT);
+		}
+
+		/** 计算每个pass的起止时间戳，以PassIndex的编号为索引
+		 * 按时间布局或者没有pass记录了时间时使用布局中的位置；否则记录了时间的pass使用记录的时间，
+		 * 没有记录时间的pass视为在queue中的前一个pass以及其等待的pass都结束时执行，持续时间为0
+		 * @return 是否使用了记录的时间 */
+		bool passTimestamps(const PipelineGraph& graph, const PassIndex& index,
+			std::vector<uint64_t>& begins, std::vector<uint64_t>& ends) {
+			const auto& passMap = graph.GetPassMap();
+			begins.assign(index.PassCount(), 0);
+			ends.assign(index.PassCount(), 0);
+			bool anyTiming = false;
+			for (const auto& queue : passMap)
+				for (const auto& pass : queue) anyTiming = anyTiming || pass.HasTiming();
+			std::vector<uint32_t> order;
+			bool useTiming = anyTiming && graph.GetNsPerUnit() <= 0.0 && TopologicalOrder(passMap, index, order);
+			if (!useTiming) {
+				for (const auto& queue : passMap) {
+					for (const auto& pass : queue) {
+						/** 按时间布局时，记录了时间的pass直接使用其时间戳，不受最小宽度的影响 */
+						const Rectangle& rect = graph.GetPassRect(pass.locate);
+						bool timed = graph.GetNsPerUnit() > 0.0 && pass.HasTiming();
+						uint32_t id = index.ToId(pass.locate);
+						begins[id] = timed ? pass.startTime : toTimestamp(graph, rect.leftUpPoint.x);
+						ends[id] = timed ? pass.endTime : toTimestamp(graph, rect.leftUpPoint.x + rect.width);
+					}
+				}
+				return false;
+			}
+			for (uint32_t id : order) {
+				PassLocate locate = index.ToLocate(id);
+				const Pass& pass = passMap[locate.queueIndex][locate.inqueueIndex];
+				if (pass.HasTiming()) {
+					begins[id] = pass.startTime;
+					ends[id] = pass.endTime;
+					continue;
+				}
+				uint64_t ready = pass.locate.inqueueIndex != 0 ? ends[id - 1] : 0;
+				for (const auto& dep : pass.depPasses) ready = std::max(ready, ends[index.ToId(dep)]);
+				begins[id] = ends[id] = ready;
+			}
+			return true;
+		}
+
+		void writeTrackDescriptor(ProtoWriter& writer, uint64_t uuid, uint64_t parent,
+			const std::string& name, bool counter) {
+			size_t packet = writer.BeginNested(TRACE_PACKET);
+			writer.AddVarint(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+			size_t desc = writer.BeginNested(PACKET_TRACK_DESCRIPTOR);
+			writer.AddVarint(TRACK_UUID, uuid);
+			if (parent) writer.AddVarint(TRACK_PARENT_UUID, parent);
+			writer.AddString(TRACK_NAME, name);
+			if (counter) writer.EndNested(writer.BeginNested(TRACK_COUNTER));
+			writer.EndNested(desc);
+			writer.EndNested(packet);
+		}
+
+		void writeTrackEvent(ProtoWriter& writer, const TraceEvent& event) {
+			size_t packet = writer.BeginNested(TRACE_PACKET);
+			writer.AddVarint(PACKET_TIMESTAMP, event.timestamp);
+			writer.AddVarint(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+			size_t body = writer.BeginNested(PACKET_TRACK_EVENT);
+			writer.AddVarint(EVENT_TYPE, event.type);
+			writer.AddVarint(EVENT_TRACK_UUID, event.track);
+			if (event.name) writer.AddString(EVENT_NAME, *event.name);
+			if (event.type == COUNTER) writer.AddSignedVarint(EVENT_COUNTER_VALUE, event.counterValue);
+			for (uint64_t flow : event.flows) writer.AddFixed64(EVENT_FLOW_IDS, flow);
+			for (uint64_t flow : event.terminatingFlows) writer.AddFixed64(EVENT_TERMINATING_FLOW_IDS, flow);
+			writer.EndNested(body);
+			writer.EndNested(packet);
+		}
+	}
+
+	bool ExportPerfetto(const PipelineGraph& graph, const char* name)
+	{
+		const auto& passMap = graph.GetPassMap();
+		const auto& resourceMap = graph.GetResourceMap();
+		/** track的uuid分配: queue依次编号，之后是资源的根track，计数track，帧分界track以及每个资源 */
+		const uint64_t queueUuidBase = 1;
+		const uint64_t resourceRootUuid = queueUuidBase + passMap.size();
+		const uint64_t liveCounterUuid = resourceRootUuid + 1;
+		const uint64_t frameUuid = liveCounterUuid + 1;
+		const uint64_t resourceUuidBase = frameUuid + 1;
+
+		ProtoWriter writer;
+		/** 第一个packet负责清空增量状态 */
+		{
+			size_t packet = writer.BeginNested(TRACE_PACKET);
+			writer.AddVarint(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+			writer.AddVarint(PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+			writer.EndNested(packet);
+		}
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			writeTrackDescriptor(writer, queueUuidBase + queIdx, 0,
+				"Queue " + std::to_string(queIdx), false);
+		}
+		writeTrackDescriptor(writer, frameUuid, 0, "Frames", false);
+		writeTrackDescriptor(writer, resourceRootUuid, 0, "Resources", false);
+		writeTrackDescriptor(writer, liveCounterUuid, resourceRootUuid, "Live resources", true);
+		for (ResourceIdx resIdx = 0; resIdx < resourceMap.size(); ++resIdx) {
+			writeTrackDescriptor(writer, resourceUuidBase + resIdx, resourceRootUuid,
+				resourceMap[resIdx].name, false);
+		}
+
+		/** 收集所有的事件 */
+		std::vector<TraceEvent> events;
+		PassIndex index(passMap);
+		std::vector<uint64_t> passBegins, passEnds;
+		bool recordedTiming = passTimestamps(graph, index, passBegins, passEnds);
+		events.reserve(index.PassCount() * 2 + resourceMap.size() * 4);
+		/** 每个pass在events中SLICE_BEGIN事件的位置，用于挂接fence的flow */
+		std::vector< std::vector<size_t> > beginEvents(passMap.size());
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			beginEvents[queIdx].reserve(passMap[queIdx].size());
+			for (const auto& pass : passMap[queIdx]) {
+				uint32_t id = index.ToId(pass.locate);
+				beginEvents[queIdx].push_back(events.size());
+				events.push_back({ passBegins[id], queueUuidBase + queIdx, SLICE_BEGIN, &pass.name, 0, {}, {} });
+				events.push_back({ passEnds[id], queueUuidBase + queIdx, SLICE_END, nullptr, 0, {}, {},
+					passEnds[id] == passBegins[id] });
+			}
+		}
+		/** 相邻的帧可能互相重叠，因此帧的分界以"Frames"上的instant事件表示，位于该帧最早的pass处 */
+		std::vector<std::string> frameNames(graph.GetFrameCount());
+		std::vector<uint64_t> frameBegin(frameNames.size(), UINT64_MAX);
+		for (const auto& queue : passMap)
+			for (const auto& pass : queue)
+				frameBegin[pass.frame] = std::min(frameBegin[pass.frame], passBegins[index.ToId(pass.locate)]);
+		for (FrameIdx frame = 0; frame < frameNames.size(); ++frame) {
+			if (frameBegin[frame] == UINT64_MAX) continue;
+			frameNames[frame] = "Frame " + std::to_string(frame);
+			events.push_back({ frameBegin[frame], frameUuid, INSTANT, &frameNames[frame], 0, {}, {} });
+		}
+		/** fence: 从发出信号的pass指向等待的pass */
+		uint64_t flowId = 1;
+		for (const auto& queue : passMap) {
+			for (const auto& pass : queue) {
+				for (const auto& signal : pass.depPasses) {
+					events[beginEvents[signal.queueIndex][signal.inqueueIndex]].flows.push_back(flowId);
+					events[beginEvents[pass.locate.queueIndex][pass.locate.inqueueIndex]].terminatingFlows.push_back(flowId);
+					++flowId;
+				}
+			}
+		}
+		/** 资源的生命周期以及barrier，使用记录的时间时从创建的pass开始到删除的pass结束，
+		 * 一直存在的资源延伸到整个trace的开始或者结束 */
+		uint64_t traceBegin = passBegins.empty() ? 0 : *std::min_element(passBegins.begin(), passBegins.end());
+		uint64_t traceEnd = passEnds.empty() ? 0 : *std::max_element(passEnds.begin(), passEnds.end());
+		for (ResourceIdx resIdx = 0; resIdx < resourceMap.size(); ++resIdx) {
+			const auto& resource = resourceMap[resIdx];
+			const Rectangle& rect = graph.GetResourceRect(resIdx);
+			uint64_t begin = toTimestamp(graph, rect.leftUpPoint.x);
+			uint64_t end = toTimestamp(graph, rect.leftUpPoint.x + rect.width);
+			if (recordedTiming) {
+				begin = index.Contains(resource.firstCreate) ? passBegins[index.ToId(resource.firstCreate)] : traceBegin;
+				end = index.Contains(resource.lastDestroy) ? passEnds[index.ToId(resource.lastDestroy)] : traceEnd;
+				end = std::max(begin, end);
+			}
+			events.push_back({ begin, resourceUuidBase + resIdx, SLICE_BEGIN, &resource.name, 0, {}, {} });
+			events.push_back({ end, resourceUuidBase + resIdx, SLICE_END, nullptr, 0, {}, {}, end == begin });
+			events.push_back({ begin, liveCounterUuid, COUNTER, nullptr, 1, {}, {} });
+			events.push_back({ end, liveCounterUuid, COUNTER, nullptr, -1, {}, {} });
+			for (const auto& barrier : resource.barriers) {
+				events.push_back({ passBegins[index.ToId(barrier.submitPass)], resourceUuidBase + resIdx,
+					INSTANT, &barrier.description, 0, {}, {} });
+			}
+		}
+		/** 按时间排序，同一时刻先结束再开始，保证同一track上的slice正确嵌套，持续时间为0的slice最后结束 */
+		auto rank = [](const TraceEvent& event) { return event.type != SLICE_END ? 1 : (event.emptySlice ? 2 : 0); };
+		std::stable_sort(events.begin(), events.end(),
+			[&rank](const TraceEvent& lhs, const TraceEvent& rhs) {
+			if (lhs.timestamp != rhs.timestamp) return lhs.timestamp < rhs.timestamp;
+			return rank(lhs) < rank(rhs);
+		});
+		/** 计数事件中存放的是增量，这里换算成当前存活的资源数量 */
+		int64_t liveResources = 0;
+		writer.Reserve(writer.Data().size() + events.size() * 32);
+		for (auto& event : events) {
+			if (event.type == COUNTER) {
+				liveResources += event.counterValue;
+				event.counterValue = liveResources;
+			}
+			writeTrackEvent(writer, event);
+		}
+
+		std::string fileName = std::string(name ? name : "test") + ".pftrace";
+		std::FILE* file = std::fopen(fileName.c_str(), "wb");
+		if (!file) return false;
+		const std::string& data = writer.Data();
+		bool succeed = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+		succeed = (std::fclose(file) == 0) && succeed;
+		return succeed;
+	}
+
+}
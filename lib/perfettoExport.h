@@ -0,0 +1,24 @@
+#ifndef PERFETTO_EXPORT_H
+#define PERFETTO_EXPORT_H
+
+#include "ppfg.h"
+
+/** 将PipelineGraph导出为Perfetto的TracePacket二进制格式(.pftrace)
+ * queue对应track，pass对应slice，fence对应flow，
+ * resource的生命周期对应"Resources"下的子track，barrier对应子track上的instant事件
+ * pass记录了时间时，无论按哪种方式布局，都使用记录的时间 */
+namespace PipelineProfilingGraph {
+
+	/** 按顺序布局且没有pass记录了时间时，图坐标中一个单位对应的纳秒数 */
+	const uint64_t PERFETTO_NS_PER_UNIT = 1000U;
+
+	/** 将分析好的图导出为Perfetto trace文件
+	 * @param graph 需要导出的图
+	 * @param name 输出的文件名称(不含后缀)
+	 * @return 文件是否成功写入
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	bool ExportPerfetto(const PipelineGraph& graph, const char* name = nullptr);
+
+}
+
+#endif // PERFETTO_EXPORT_H
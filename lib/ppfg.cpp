@@ -1,5 +1,7 @@
 #include "ppfg.h"
 #include "svgProcess.h"
+#include <algorithm>
+#include <cstdio>
 
 const float SVGBase::STROKE_WIDTH = 0.8f;
 
@@ -9,64 +11,112 @@ namespace PipelineProfilingGraph {
 		return (outside - inside) / 2.0f;
 	}
 
-	Rectangle PipelineGraph::processPassHelper(Pass& pass) {
-		if (pass.processed) {
+	Rectangle PipelineGraph::processPassHelper(Pass& root) {
+		if (root.processed) {
 			/** 假如pass已经被处理过，直接返回其Rectangle */
-			return m_queuePasses[pass.locate.queueIndex][pass.locate.inqueueIndex];
+			return m_queuePasses[root.locate.queueIndex][root.locate.inqueueIndex];
 		}
-		/** 获得同一queue的上一个pass的大小以及
-		 * Fence依赖的各个pass的大小 */
-		std::vector<Rectangle> depRect;
-		/** 同一个queue上的前一个pass的rect */
-		if (pass.locate.inqueueIndex == 0) {
-			/** 该pass是queue的第一个pass */
-			depRect.push_back(Rectangle({ -PASS_WIDTH - PASS_PADDING, 0 }, Rectangle::PASS));
+		/** 使用显式的栈代替递归，避免很长的queue导致栈溢出 */
+		std::vector<Pass*> stack(1, &root);
+		while (!stack.empty()) {
+			Pass& pass = *stack.back();
+			if (pass.processed) {
+				stack.pop_back();
+				continue;
+			}
+			/** 同一queue上的前一个pass以及Fence依赖的各个pass需要先被处理 */
+			size_t stackSize = stack.size();
+			if (pass.locate.inqueueIndex != 0) {
+				Pass& prev = m_passMap[pass.locate.queueIndex][pass.locate.inqueueIndex - 1];
+				if (!prev.processed) stack.push_back(&prev);
+			}
+			for (const auto& depLocate : pass.depPasses) {
+				Pass& dep = m_passMap[depLocate.queueIndex][depLocate.inqueueIndex];
+				if (!dep.processed) stack.push_back(&dep);
+			}
+			if (stack.size() != stackSize) continue;
+
+			/** 筛选出依赖的pass中最靠右的rect */
+			float mostRightX = -PASS_WIDTH - PASS_PADDING;
+			if (pass.locate.inqueueIndex != 0) {
+				/** 该pass不是queue的第一个pass */
+				mostRightX = m_queuePasses[pass.locate.queueIndex][pass.locate.inqueueIndex - 1].leftUpPoint.x;
+			}
+			for (const auto& depLocate : pass.depPasses) {
+				const Rectangle& depRect = m_queuePasses[depLocate.queueIndex][depLocate.inqueueIndex];
+				if (depRect.leftUpPoint.x > mostRightX)
+					mostRightX = depRect.leftUpPoint.x;
+			}
+			/** 计算出该pass的rect */
+			Rectangle rectForThisPass({ mostRightX + PASS_WIDTH + PASS_PADDING, 0 },
+				Rectangle::PASS);
+			rectForThisPass.desc = pass.name;
+			if (m_nsPerUnit > 0.0)
+				timePassHelper(pass, rectForThisPass);
+			m_queuePasses[pass.locate.queueIndex][pass.locate.inqueueIndex] = rectForThisPass;
+			pass.processed = true;
+			stack.pop_back();
 		}
-		else {
-			depRect.push_back(
-				processPassHelper(
-					m_passMap[pass.locate.queueIndex][pass.locate.inqueueIndex - 1]));
+
+		return m_queuePasses[root.locate.queueIndex][root.locate.inqueueIndex];
+	}
+
+	void PipelineGraph::timePassHelper(const Pass& pass, Rectangle& rect)
+	{
+		if (pass.HasTiming()) {
+			rect.leftUpPoint.x = static_cast<float>(static_cast<double>(pass.startTime - m_timeOrigin) / m_nsPerUnit);
+			rect.width = std::max(static_cast<float>(static_cast<double>(pass.endTime - pass.startTime) / m_nsPerUnit),
+				TIMED_PASS_MIN_WIDTH);
+			char duration[32];
+			std::snprintf(duration, sizeof(duration), "\n%.3f us", static_cast<double>(pass.endTime - pass.startTime) / 1000.0);
+			rect.desc += duration;
+			return;
+		}
+		/** 没有记录时间的pass接在queue内前一个pass以及其等待的pass结束之后 */
+		float mostRightEnd = -PASS_PADDING;
+		if (pass.locate.inqueueIndex != 0) {
+			const Rectangle& prevRect = m_queuePasses[pass.locate.queueIndex][pass.locate.inqueueIndex - 1];
+			mostRightEnd = prevRect.leftUpPoint.x + prevRect.width;
 		}
-		/** 依赖的pass的rect */
 		for (const auto& depLocate : pass.depPasses) {
-			depRect.push_back(
-				processPassHelper(
-					m_passMap[depLocate.queueIndex][depLocate.inqueueIndex]
-				)
-			);
-		}
-		/** 筛选出depRect中最靠右的rect */
-		const Rectangle* mostRightRect = depRect.data();
-		for (const auto& rect : depRect) {
-			if (rect.leftUpPoint.x > mostRightRect->leftUpPoint.x) {
-				mostRightRect = &rect;
-			}
+			const Rectangle& depRect = m_queuePasses[depLocate.queueIndex][depLocate.inqueueIndex];
+			mostRightEnd = std::max(mostRightEnd, depRect.leftUpPoint.x + depRect.width);
 		}
-		/** 计算出该pass的rect */
-		Rectangle rectForThisPass({mostRightRect->leftUpPoint.x + PASS_WIDTH + PASS_PADDING, 0},
-			Rectangle::PASS);
-		rectForThisPass.desc = pass.name;
-		m_queuePasses[pass.locate.queueIndex][pass.locate.inqueueIndex] = rectForThisPass;
-		pass.processed = true;
+		rect.leftUpPoint.x = mostRightEnd + PASS_PADDING;
+	}
 
-		return rectForThisPass;
+	uint64_t PipelineGraph::TimeAt(float x) const
+	{
+		double offset = (static_cast<double>(x) - LEFT_MARGIN - PASS_PADDING) * m_nsPerUnit;
+		if (offset < 0.0 && static_cast<uint64_t>(-offset) > m_timeOrigin) return 0;
+		return offset < 0.0 ? m_timeOrigin - static_cast<uint64_t>(-offset) : m_timeOrigin + static_cast<uint64_t>(offset);
 	}
 
 	float PipelineGraph::processQueueHelper(QueueIdx queIdx) {
 		Rectangle queRect = Rectangle({ LEFT_MARGIN, TOP_MARGIN }, Rectangle::QUEUE);
 		queRect.leftUpPoint.y += queIdx * (QUEUE_HEIGHT + QUEUE_PADDING);
-		/** 计算该queue应有的width */
+		/** 计算该queue应有的width，按时间布局时最后一个pass不一定最靠右 */
+		float mostRight = 0.0f;
 		for (auto& passRect : m_queuePasses[queIdx]) {
 			passRect.leftUpPoint.x += queRect.leftUpPoint.x + PASS_PADDING;
 			passRect.leftUpPoint.y += queRect.leftUpPoint.y + centerOffset(QUEUE_HEIGHT, PASS_HEIGHT);
+			mostRight = std::max(mostRight, passRect.leftUpPoint.x + passRect.width);
 		}
-		queRect.width = m_queuePasses[queIdx].back().leftUpPoint.x + PASS_WIDTH + PASS_PADDING - LEFT_MARGIN;
+		if (m_queuePasses[queIdx].empty())
+			queRect.width = PASS_PADDING;
+		else
+			queRect.width = mostRight + PASS_PADDING - LEFT_MARGIN;
 
 		m_queues[queIdx] = queRect;
 		return queRect.width;
 	}
 
 	void PipelineGraph::processFenceHelper(const PassLocate & signal, const PassLocate & receiver)
+	{
+		m_arrows.push_back(GetFenceArrow(signal, receiver));
+	}
+
+	Arrow PipelineGraph::GetFenceArrow(const PassLocate& signal, const PassLocate& receiver) const
 	{
 		/** 算出fence */
 		const Rectangle& signalRect = m_queuePasses[signal.queueIndex][signal.inqueueIndex];
@@ -87,7 +137,7 @@ namespace PipelineProfilingGraph {
 			fence.inflexionPoint.push_back({ receRect.leftUpPoint.x, signalRect.leftUpPoint.y + PASS_HEIGHT + PASS_QUEUE_PADDING_OFFSET / 2 });
 			fence.inflexionPoint.push_back({ receRect.leftUpPoint.x, receRect.leftUpPoint.y - ARROW_PADDING });
 		}
-		m_arrows.push_back(fence);
+		return fence;
 	}
 
 	void PipelineGraph::processResourceHelper(ResourceIdx resIdx)
@@ -155,6 +205,165 @@ namespace PipelineProfilingGraph {
 		}
 }
 
+	bool PipelineGraph::AppendFrame(std::vector<Queue>& passMap,
+		std::vector<Resource>& resMap, const std::vector<CrossFrameFence>& crossFences, std::string* error)
+	{
+		FrameIdx frame = static_cast<FrameIdx>(m_frameQueueOffsets.size());
+		/** 先检查所有的位置，失败时不修改图 */
+		auto isLocal = [&passMap](const PassLocate& locate) {
+			return locate.queueIndex < passMap.size() && locate.inqueueIndex < passMap[locate.queueIndex].size();
+		};
+		auto fail = [error](const std::string& reason) {
+			if (error) *error = reason;
+			return false;
+		};
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			for (const auto& pass : passMap[queIdx]) {
+				if (pass.locate != INVALID_PASS_LOCATE && !isLocal(pass.locate))
+					return fail("pass " + pass.name + " has an invalid locate");
+				for (const auto& dep : pass.depPasses)
+					if (!isLocal(dep)) return fail("pass " + pass.name + " waits on an invalid pass");
+			}
+		}
+		for (const auto& resource : resMap) {
+			bool valid = (resource.firstCreate == INVALID_PASS_LOCATE || isLocal(resource.firstCreate))
+				&& (resource.lastDestroy == INVALID_PASS_LOCATE || isLocal(resource.lastDestroy));
+			for (const auto& read : resource.readPasses)
+				valid = valid && isLocal(read);
+			for (const auto& write : resource.writedPasses)
+				valid = valid && isLocal(write);
+			for (const auto& barrier : resource.barriers)
+				valid = valid && isLocal(barrier.submitPass);
+			if (!valid) return fail("resource " + resource.name + " references an invalid pass");
+		}
+		for (const auto& fence : crossFences) {
+			if (!isLocal(fence.receiver))
+				return fail("cross-frame fence has an invalid receiver");
+			if (fence.signalFrame >= frame || !isFramePassHelper(fence.signalFrame, fence.signal))
+				return fail("cross-frame fence has an invalid signal");
+		}
+
+		if (m_passMap.size() < passMap.size())
+			m_passMap.resize(passMap.size());
+		/** 新的帧在每个queue上都接在已有的pass之后 */
+		std::vector<PassIdx> offsets(m_passMap.size());
+		for (QueueIdx queIdx = 0; queIdx < m_passMap.size(); ++queIdx)
+			offsets[queIdx] = static_cast<PassIdx>(m_passMap[queIdx].size());
+		auto remap = [&offsets](PassLocate& locate) {
+			if (locate != INVALID_PASS_LOCATE)
+				locate.inqueueIndex += offsets[locate.queueIndex];
+		};
+
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			auto& dstQueue = m_passMap[queIdx];
+			dstQueue.reserve(dstQueue.size() + passMap[queIdx].size());
+			for (auto& pass : passMap[queIdx]) {
+				remap(pass.locate);
+				for (auto& dep : pass.depPasses)
+					remap(dep);
+				pass.frame = frame;
+				pass.processed = false;
+				dstQueue.push_back(std::move(pass));
+			}
+		}
+		m_frameQueueOffsets.push_back(offsets);
+		/** 跨帧的fence直接挂在接收方的依赖上 */
+		for (const auto& fence : crossFences) {
+			PassLocate receiver = ToGraphLocate(frame, fence.receiver);
+			m_passMap[receiver.queueIndex][receiver.inqueueIndex].depPasses.push_back(
+				ToGraphLocate(fence.signalFrame, fence.signal));
+		}
+
+		m_resourceMap.reserve(m_resourceMap.size() + resMap.size());
+		for (auto& resource : resMap) {
+			remap(resource.firstCreate);
+			remap(resource.lastDestroy);
+			for (auto& read : resource.readPasses)
+				remap(read);
+			for (auto& write : resource.writedPasses)
+				remap(write);
+			for (auto& barrier : resource.barriers)
+				remap(barrier.submitPass);
+			resource.frame = frame;
+			m_resourceMap.push_back(std::move(resource));
+		}
+		passMap.clear();
+		resMap.clear();
+		return true;
+	}
+
+	bool PipelineGraph::isFramePassHelper(FrameIdx frame, const PassLocate& local) const
+	{
+		const auto& offsets = m_frameQueueOffsets[frame];
+		if (local.queueIndex >= offsets.size() || local.queueIndex >= m_passMap.size())
+			return false;
+		/** 下一帧的起始位置即为该帧的结束位置，最后一帧结束于queue的末尾 */
+		size_t end = m_passMap[local.queueIndex].size();
+		if (frame + 1 < m_frameQueueOffsets.size() && local.queueIndex < m_frameQueueOffsets[frame + 1].size())
+			end = m_frameQueueOffsets[frame + 1][local.queueIndex];
+		return offsets[local.queueIndex] + static_cast<size_t>(local.inqueueIndex) < end;
+	}
+
+	void PipelineGraph::rebuildFrameOffsets()
+	{
+		FrameIdx frameCount = 1;
+		for (const auto& queue : m_passMap)
+			if (!queue.empty() && queue.back().frame + 1 > frameCount)
+				frameCount = queue.back().frame + 1;
+		m_frameQueueOffsets.assign(frameCount, std::vector<PassIdx>(m_passMap.size(), 0));
+		for (QueueIdx queIdx = 0; queIdx < m_passMap.size(); ++queIdx) {
+			const auto& queue = m_passMap[queIdx];
+			PassIdx passIdx = 0;
+			for (FrameIdx frame = 0; frame < frameCount; ++frame) {
+				while (passIdx < queue.size() && queue[passIdx].frame < frame)
+					++passIdx;
+				m_frameQueueOffsets[frame][queIdx] = passIdx;
+			}
+		}
+	}
+
+	PassLocate PipelineGraph::ToGraphLocate(FrameIdx frame, const PassLocate& local) const
+	{
+		const auto& offsets = m_frameQueueOffsets[frame];
+		PassIdx offset = local.queueIndex < offsets.size() ? offsets[local.queueIndex] : 0;
+		return { local.queueIndex, local.inqueueIndex + offset };
+	}
+
+	float PipelineGraph::GetContentBottom() const
+	{
+		float bottom = TOP_MARGIN;
+		if (!m_queues.empty())
+			bottom = m_queues.back().leftUpPoint.y + m_queues.back().height;
+		if (!m_resources.empty())
+			bottom = std::max(bottom, m_resources.back().leftUpPoint.y + m_resources.back().height);
+		for (const auto& polygon : m_overlayPolygons)
+			for (const auto& point : polygon.points)
+				bottom = std::max(bottom, point.y);
+		for (const auto& label : m_overlayLabels)
+			bottom = std::max(bottom, label.leftUpPoint.y + LABEL_LINE_HEIGHT);
+		return bottom;
+	}
+
+	void PipelineGraph::MarkPass(const PassLocate& locate, uint8_t marks, const std::string& note)
+	{
+		Rectangle& rect = m_queuePasses[locate.queueIndex][locate.inqueueIndex];
+		rect.marks |= marks;
+		if (!note.empty()) {
+			rect.desc += '\n';
+			rect.desc += note;
+		}
+	}
+
+	void PipelineGraph::MarkResource(ResourceIdx resIdx, uint8_t marks, const std::string& note)
+	{
+		Rectangle& rect = m_resources[resIdx];
+		rect.marks |= marks;
+		if (!note.empty()) {
+			rect.desc += '\n';
+			rect.desc += note;
+		}
+	}
+
 	void PipelineGraph::Raster(const char* name)
 	{
 		SVGBase svg(name ? name : "test");
@@ -174,16 +383,48 @@ namespace PipelineProfilingGraph {
 		/** 处理所有的barrer */
 		for (const auto& transt : m_transts)
 			svg.AddTransition(transt);
+		/** 处理帧的分界标记 */
+		for (const auto& marker : m_frameMarkers)
+			svg.AddRect(marker);
+		/** 处理分析结果加入的多边形、矩形与箭头 */
+		for (const auto& polygon : m_overlayPolygons)
+			svg.AddPolygon(polygon);
+		for (const auto& rect : m_overlayRects)
+			svg.AddRect(rect);
+		for (auto& arrow : m_overlayArrows)
+			svg.AddArrow(arrow);
+		for (const auto& label : m_overlayLabels)
+			svg.AddLabel(label);
 
 		svg.Save();
 	}
 
 	void PipelineGraph::Setup()
 	{
-		/** 初始化各个vector */
-		m_queues = std::vector<Rectangle>(m_passMap.size());
-		for (const auto& queue : m_passMap) {
-			m_queuePasses.push_back(std::vector<Rectangle>(queue.size()));
+		/** 初始化各个vector，Setup可以被重复调用 */
+		m_queues.assign(m_passMap.size(), Rectangle());
+		m_queuePasses.resize(m_passMap.size());
+		m_resources.clear();
+		m_transts.clear();
+		m_arrows.clear();
+		m_frameMarkers.clear();
+		m_overlayArrows.clear();
+		m_overlayRects.clear();
+		m_overlayPolygons.clear();
+		m_overlayLabels.clear();
+		for (QueueIdx queIdx = 0; queIdx < m_passMap.size(); ++queIdx) {
+			m_queuePasses[queIdx].assign(m_passMap[queIdx].size(), Rectangle());
+			for (auto& pass : m_passMap[queIdx])
+				pass.processed = false;
+		}
+		/** 按时间布局时，以最早的pass的开始时间为原点 */
+		m_timeOrigin = 0;
+		if (m_nsPerUnit > 0.0) {
+			m_timeOrigin = UINT64_MAX;
+			for (const auto& queue : m_passMap)
+				for (const auto& pass : queue)
+					if (pass.HasTiming() && pass.startTime < m_timeOrigin) m_timeOrigin = pass.startTime;
+			if (m_timeOrigin == UINT64_MAX) m_timeOrigin = 0;
 		}
 		/** 初步处理所有的pass */
 		for (auto& queue : m_passMap) {
@@ -213,6 +454,26 @@ namespace PipelineProfilingGraph {
 		for (ResourceIdx resIdx = 0; resIdx < m_resourceMap.size(); ++resIdx) {
 			processResourceHelper(resIdx);
 		}
+		/** 多于一帧时，在每一帧最左侧的pass前放置分界标记 */
+		if (m_frameQueueOffsets.size() > 1) {
+			float bottom = m_resources.empty() ? m_queues.back().leftUpPoint.y + m_queues.back().height
+				: m_resources.back().leftUpPoint.y + m_resources.back().height;
+			for (FrameIdx frame = 0; frame < m_frameQueueOffsets.size(); ++frame) {
+				float frameLeft = maxQueueWidth + LEFT_MARGIN;
+				for (QueueIdx queIdx = 0; queIdx < m_passMap.size(); ++queIdx) {
+					PassIdx first = queIdx < m_frameQueueOffsets[frame].size() ? m_frameQueueOffsets[frame][queIdx] : 0;
+					if (first < m_passMap[queIdx].size() && m_passMap[queIdx][first].frame == frame
+						&& m_queuePasses[queIdx][first].leftUpPoint.x < frameLeft)
+						frameLeft = m_queuePasses[queIdx][first].leftUpPoint.x;
+				}
+				Rectangle marker({ frameLeft - (PASS_PADDING + FRAME_MARKER_WIDTH) / 2.0f, TOP_MARGIN }, Rectangle::FRAME);
+				marker.height = bottom - TOP_MARGIN;
+				marker.desc = "Frame " + std::to_string(frame);
+				m_frameMarkers.push_back(marker);
+			}
+		}
+		/** 建立查询用的索引 */
+		buildQueryIndexHelper();
 	}
 
 }
@@ -1,24 +1,30 @@
+#ifndef PPFG_H
+#define PPFG_H
+
 #include "ppfgEle.h"
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 namespace PipelineProfilingGraph {
 
 	using QueueIdx = uint32_t;
 	using PassIdx = uint32_t;
 	using ResourceIdx = uint32_t;
+	using FrameIdx = uint32_t;
 	const uint32_t INVALID_INDEX = UINT32_MAX; /**< 任何索引设置为该值都意味着无效 */
+	const uint64_t INVALID_TIMESTAMP = UINT64_MAX; /**< 没有记录时间的pass的时间戳 */
 
 
 	/** 描述一个pass的位置 */
 	struct PassLocate {
 		QueueIdx queueIndex; /**< 该pass所在的queue的索引 */
 		PassIdx inqueueIndex; /**< 该pass在queue中的索引 */
-		bool operator==(const PassLocate& rhs) {
+		bool operator==(const PassLocate& rhs) const {
 			return (queueIndex == rhs.queueIndex && inqueueIndex == rhs.inqueueIndex);
 		}
-		bool operator!=(const PassLocate& rhs) {
+		bool operator!=(const PassLocate& rhs) const {
 			return !(this->operator==(rhs));
 		}
 	};
@@ -31,20 +37,57 @@ namespace PipelineProfilingGraph {
 		Pass(const char* n, QueueIdx queIdx, 
 			PassIdx inqueueIdx, const FenceSignalPasses& dep)
 			: name(n), locate({ queIdx, inqueueIdx }),
-			depPasses(dep), processed(false) {}
+			depPasses(dep), frame(0), startTime(INVALID_TIMESTAMP), endTime(INVALID_TIMESTAMP),
+			processed(false) {}
 		Pass(const char* n, QueueIdx queIdx,
 			PassIdx inqueueIdx, FenceSignalPasses&& dep)
 			: name(n), locate({ queIdx, inqueueIdx }),
-			processed(false) {
+			frame(0), startTime(INVALID_TIMESTAMP), endTime(INVALID_TIMESTAMP), processed(false) {
 			depPasses.swap(dep);
 		}
+		/** 该pass是否记录了有效的起止时间 */
+		bool HasTiming() const { return startTime != INVALID_TIMESTAMP && endTime != INVALID_TIMESTAMP && endTime >= startTime; }
 
 		std::string name; /**< 该pass的名称 */
 		PassLocate locate; /**< 该pass的位置 */
 		FenceSignalPasses depPasses; /**< 该pass强依赖的(fence)的pass的位置 */
+		FrameIdx frame; /**< 该pass所属的帧 */
+		uint64_t startTime; /**< 该pass在GPU上开始执行的时间戳(纳秒)，没有记录时为INVALID_TIMESTAMP */
+		uint64_t endTime; /**< 该pass在GPU上结束执行的时间戳(纳秒)，没有记录时为INVALID_TIMESTAMP */
 		bool processed; /**< 该pass是否已经被处理过 */
 	};
 
+	/** 资源状态，与D3D12_RESOURCE_STATES对应，只读状态之间可以通过or操作组合 */
+	enum ResourceState : uint16_t {
+		STATE_COMMON = 0,
+		STATE_VERTEX_AND_CONSTANT_BUFFER = 0x0001U,
+		STATE_INDEX_BUFFER = 0x0002U,
+		STATE_RENDER_TARGET = 0x0004U,
+		STATE_UNORDERED_ACCESS = 0x0008U,
+		STATE_DEPTH_WRITE = 0x0010U,
+		STATE_DEPTH_READ = 0x0020U,
+		STATE_SHADER_RESOURCE = 0x0040U,
+		STATE_INDIRECT_ARGUMENT = 0x0080U,
+		STATE_COPY_DEST = 0x0100U,
+		STATE_COPY_SOURCE = 0x0200U,
+		STATE_PRESENT = 0x0400U,
+	};
+	/** 所有只读状态 */
+	const uint16_t READ_ONLY_STATES = STATE_VERTEX_AND_CONSTANT_BUFFER | STATE_INDEX_BUFFER
+		| STATE_DEPTH_READ | STATE_SHADER_RESOURCE | STATE_INDIRECT_ARGUMENT
+		| STATE_COPY_SOURCE | STATE_PRESENT;
+	/** 未指定状态时读取与写入使用的状态 */
+	const uint16_t DEFAULT_READ_STATE = STATE_SHADER_RESOURCE;
+	const uint16_t DEFAULT_WRITE_STATE = STATE_RENDER_TARGET;
+
+	/** 资源所在的堆，与D3D12_HEAP_TYPE对应 */
+	enum HeapType : uint8_t {
+		HEAP_DEFAULT,
+		HEAP_UPLOAD,
+		HEAP_READBACK,
+		HEAP_TYPE_COUNT,
+	};
+
 	struct Barrier {
 		enum Flag : uint8_t {
 			TRANSITION_BARRIER = 0x01U,
@@ -55,24 +98,28 @@ namespace PipelineProfilingGraph {
 			END = 0x20U
 		};
 		Barrier() = default;
-		Barrier(PassLocate pass, const char* desc, uint8_t flags)
-			: submitPass(pass), description(desc), flags(flags) {}
+		Barrier(PassLocate pass, const char* desc, uint8_t flags,
+			uint16_t before = STATE_COMMON, uint16_t after = STATE_COMMON)
+			: submitPass(pass), description(desc), flags(flags), stateBefore(before), stateAfter(after) {}
 		PassLocate submitPass; /**< 提交该指令的pass */
 		std::string description; /**< 状态切换的描述 */
 		uint8_t flags; /**< 当前barrier的状态，由Flag通过or操作设置 */
+		uint16_t stateBefore; /**< TRANSITION_BARRIER切换前的状态，见ResourceState */
+		uint16_t stateAfter; /**< TRANSITION_BARRIER切换后的状态，见ResourceState */
 	};
 
 	struct Resource {
-		Resource() {}
+		Resource() : frame(0), size(0), alignment(0), heapType(HEAP_DEFAULT) {}
 		Resource(const char* name, PassLocate firstCreatePass, PassLocate lastDestroyPass,
 			const std::vector<PassLocate>& readPasses,
 			const std::vector<PassLocate>& writePasses)
 			:name(name), firstCreate(firstCreatePass), lastDestroy(lastDestroyPass),
-			readPasses(readPasses), writedPasses(writedPasses) {}
+			readPasses(readPasses), writedPasses(writePasses), frame(0), size(0), alignment(0), heapType(HEAP_DEFAULT) {}
 		Resource(const char* name, PassLocate firstCreatePass, PassLocate lastDestroyPass,
 			std::vector<PassLocate>&& rp,
 			std::vector<PassLocate>&& wp)
-			:name(name), firstCreate(firstCreatePass), lastDestroy(lastDestroyPass) {
+			:name(name), firstCreate(firstCreatePass), lastDestroy(lastDestroyPass), frame(0),
+			size(0), alignment(0), heapType(HEAP_DEFAULT) {
 			readPasses.swap(rp);
 			writedPasses.swap(wp);
 		}
@@ -81,43 +128,211 @@ namespace PipelineProfilingGraph {
 		PassLocate lastDestroy; /**< 第一个删除该资源的pass，若为INVALID_PASS_LOCATE, 表示该资源一直未被删除*/
 		std::vector<PassLocate> readPasses; /**< 读取该资源的pass */
 		std::vector<PassLocate> writedPasses; /**< 写入该资源的pass */
-		std::vector<Barrier> barriers; /**< 资源使用到的barrier，需要额外手动设置 */
+		std::vector<Barrier> barriers; /**< 资源使用到的barrier，需要额外手动设置，或者由SynthesizeBarriers生成 */
+		FrameIdx frame; /**< 该资源所属的帧 */
+		std::vector<uint16_t> readStates; /**< 与readPasses一一对应的读取状态，为空时均为DEFAULT_READ_STATE */
+		std::vector<uint16_t> writeStates; /**< 与writedPasses一一对应的写入状态，为空时均为DEFAULT_WRITE_STATE */
+		uint64_t size; /**< 资源占用的字节数，为0表示未知 */
+		uint32_t alignment; /**< 资源在堆中的对齐字节数，为0表示不需要对齐 */
+		uint8_t heapType; /**< 资源所在的堆，见HeapType */
+
+		/** 获取资源按对齐向上取整后在堆中占用的字节数 */
+		uint64_t GetAlignedSize() const {
+			return alignment > 1 ? (size + alignment - 1) / alignment * alignment : size;
+		}
+		/** 获取第index次读取时资源所处的状态 */
+		uint16_t GetReadState(size_t index) const {
+			return index < readStates.size() ? readStates[index] : DEFAULT_READ_STATE;
+		}
+		/** 获取第index次写入时资源所处的状态 */
+		uint16_t GetWriteState(size_t index) const {
+			return index < writeStates.size() ? writeStates[index] : DEFAULT_WRITE_STATE;
+		}
 	};
 
 	using Queue = std::vector<Pass>;
 
+	/** 跨帧的fence，描述后加入的帧中的pass等待之前某一帧中的pass */
+	struct CrossFrameFence {
+		FrameIdx signalFrame; /**< 负责更新fence的pass所在的帧 */
+		PassLocate signal; /**< 负责更新fence的pass在其所在帧内的位置 */
+		PassLocate receiver; /**< 负责接收fence的pass在新加入的帧内的位置 */
+	};
+
+	/** pass对某个资源的访问，由Setup建立的索引提供 */
+	struct PassResourceAccess {
+		enum Access : uint8_t {
+			READ = 0x01U,
+			WRITE = 0x02U,
+			CREATE = 0x04U, /**< 该pass是资源的firstCreate */
+			DESTROY = 0x08U, /**< 该pass是资源的lastDestroy */
+		};
+		ResourceIdx resource; /**< 被访问的资源 */
+		uint8_t access; /**< 由Access通过or操作设置 */
+	};
+
+	/** 指向某个资源的某个barrier */
+	struct BarrierRef {
+		ResourceIdx resource; /**< barrier所属的资源 */
+		uint32_t barrierIndex; /**< barrier在Resource::barriers中的索引 */
+	};
+
 	class PipelineGraph {
 	public:
+		/** 构造一个空的Pipeline分析图，之后通过AppendFrame加入帧 */
+		PipelineGraph() : m_nsPerUnit(0.0), m_timeOrigin(0) {}
 		/** Pipeline分析图的构造函数
 		 * @param passMap 记录渲染图中所有pass以及pass的依赖关系
 		 * @param resMap 记录渲染图中用到的所有的资源以及其读写关系
 		 * @remark 传入的passMap以及resMap都会在函数调用后被替换成空的容器 */
 		PipelineGraph(std::vector<Queue>& passMap,
-			std::vector<Resource>& resMap) {
+			std::vector<Resource>& resMap) : m_nsPerUnit(0.0), m_timeOrigin(0) {
 			m_passMap.swap(passMap);
 			m_resourceMap.swap(resMap);
+			rebuildFrameOffsets();
 		}
 		/** Pipeline分析图的构造函数
 		 * @param passMap 记录渲染图中所有pass以及pass的依赖关系
 		 * @param resMap 记录渲染图中用到的所有的资源以及其读写关系
 		 * @remark 传入的passMap以及resMap都会在函数调用后被替换成空的容器 */
 		PipelineGraph(std::vector<Queue>&& passMap,
-			std::vector<Resource>& resMap) {
+			std::vector<Resource>& resMap) : m_nsPerUnit(0.0), m_timeOrigin(0) {
+			m_passMap.swap(passMap);
+			m_resourceMap.swap(resMap);
+			rebuildFrameOffsets();
+		}
+		/** 用新的pass和资源替换图中的内容，便于同一个PipelineGraph被重复使用
+		 * @param passMap 新的pass，调用后存放图中原有的pass
+		 * @param resMap 新的资源，调用后存放图中原有的资源
+		 * @remark 原有内容被交换出来而不是释放，调用方可以复用这些容器的内存；
+		 * 调用后需要重新调用Setup */
+		void Reset(std::vector<Queue>& passMap, std::vector<Resource>& resMap) {
 			m_passMap.swap(passMap);
 			m_resourceMap.swap(resMap);
+			rebuildFrameOffsets();
 		}
+		/** 向图中追加一帧，帧内的pass沿x方向接在之前的帧之后
+		 * @param passMap 该帧的所有pass，pass的位置均为帧内的位置
+		 * @param resMap 该帧用到的资源，资源引用的pass的位置均为帧内的位置
+		 * @param crossFences 该帧中的pass对之前的帧中的pass的fence，本帧内的fence记录在pass的depPasses中
+		 * @param error 失败时的错误信息，可以为空
+		 * @return 是否加入成功，新加入的帧的索引为GetFrameCount() - 1
+		 * @remark 成功时传入的passMap以及resMap都会被替换成空的容器，失败时图与传入的容器都不会被修改；
+		 * 调用后需要重新调用Setup */
+		bool AppendFrame(std::vector<Queue>& passMap,
+			std::vector<Resource>& resMap,
+			const std::vector<CrossFrameFence>& crossFences = std::vector<CrossFrameFence>(),
+			std::string* error = nullptr);
+		/** 获取图中帧的数量 */
+		FrameIdx GetFrameCount() const { return static_cast<FrameIdx>(m_frameQueueOffsets.size()); }
+		/** 将某一帧内的pass位置转换成图中的pass位置
+		 * @param frame pass所在的帧
+		 * @param local pass在帧内的位置 */
+		PassLocate ToGraphLocate(FrameIdx frame, const PassLocate& local) const;
 		/** 该函数将分析好的图输出到文件中
 		 * @param name 输出的图的名称 
 		 * @remark 调用该函数前，必须保证setup被调用*/
 		void Raster(const char* name = nullptr);
-		/** 该函数根据输入的pass和资源情况，设置图元素 */
+		/** 该函数根据输入的pass和资源情况，设置图元素，同时建立查询索引 */
 		void Setup();
+		/** 只建立查询索引而不设置图元素，用于在布局之前按名称查找pass与资源
+		 * @remark 修改图中的pass或资源后需要重新调用 */
+		void BuildQueryIndex() { buildQueryIndexHelper(); }
+		/** 设置按时间布局: x坐标为pass的开始时间，宽度为pass的持续时间，fence与资源的位置随之变化；
+		 * 没有记录时间的pass仍使用固定的宽度，接在queue内前一个pass以及其等待的pass之后
+		 * @param nsPerUnit 图坐标中一个单位对应的纳秒数，为0时使用默认的按顺序布局
+		 * @remark 需要在Setup之前调用 */
+		void SetTimeLayout(double nsPerUnit) { m_nsPerUnit = nsPerUnit > 0.0 ? nsPerUnit : 0.0; }
+		/** 获取按时间布局时一个单位对应的纳秒数，按顺序布局时为0 */
+		double GetNsPerUnit() const { return m_nsPerUnit; }
+		/** 按时间布局时，将图中的x坐标换算成时间戳(纳秒)
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		uint64_t TimeAt(float x) const;
+		/** 标记某个pass，用于在图中显示分析的结果
+		 * @param locate 需要标记的pass
+		 * @param marks 由Rectangle::Mark通过or操作设置，会与已有的标记合并
+		 * @param note 追加到该pass描述信息中的说明，可以为空
+		 * @remark 调用该函数前，必须保证setup被调用，再次调用setup会清除所有标记 */
+		void MarkPass(const PassLocate& locate, uint8_t marks, const std::string& note = std::string());
+		/** 标记某个资源，参数与MarkPass相同 */
+		void MarkResource(ResourceIdx resIdx, uint8_t marks, const std::string& note = std::string());
+		/** 在图的最上层加入一个箭头，用于连接分析结果中相关的两个元素
+		 * @remark 调用该函数前，必须保证setup被调用，再次调用setup会清除所有加入的箭头 */
+		void AddOverlay(const Arrow& arrow) { m_overlayArrows.push_back(arrow); }
+		/** 在图中加入一个矩形，用于标出分析结果中的区域，绘制在所有pass之后、加入的箭头之前
+		 * @remark 调用该函数前，必须保证setup被调用，再次调用setup会清除所有加入的矩形 */
+		void AddOverlay(const Rectangle& rect) { m_overlayRects.push_back(rect); }
+		/** 在图中加入一个多边形，用于绘制分析结果中的图表，绘制在加入的矩形之前
+		 * @remark 调用该函数前，必须保证setup被调用，再次调用setup会清除所有加入的多边形 */
+		void AddOverlay(const Polygon& polygon) { m_overlayPolygons.push_back(polygon); }
+		/** 在图的最上层加入一行文字，用于输出分析结果的汇总
+		 * @remark 调用该函数前，必须保证setup被调用，再次调用setup会清除所有加入的文字 */
+		void AddOverlay(const Label& label) { m_overlayLabels.push_back(label); }
+		/** 获取图中所有内容(包括已加入的多边形与文字)的最下方的y坐标，用于在图的下方加入新的内容
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		float GetContentBottom() const;
+		/** 获取某个pass访问的所有资源，每个资源只出现一次，按资源的索引排列
+		 * @param count 返回资源的数量
+		 * @return 指向第一个访问
+		 * @remark 调用该函数前，必须保证setup或BuildQueryIndex被调用，以下查询函数相同 */
+		const PassResourceAccess* GetPassResources(const PassLocate& locate, uint32_t& count) const {
+			uint32_t passId = m_queryPassOffsets[locate.queueIndex] + locate.inqueueIndex;
+			count = m_passAccessOffsets[passId + 1] - m_passAccessOffsets[passId];
+			return m_passAccesses.data() + m_passAccessOffsets[passId];
+		}
+		/** 获取某个pass提交的所有barrier，按资源的索引排列
+		 * @param count 返回barrier的数量 */
+		const BarrierRef* GetPassBarriers(const PassLocate& locate, uint32_t& count) const {
+			uint32_t passId = m_queryPassOffsets[locate.queueIndex] + locate.inqueueIndex;
+			count = m_passBarrierOffsets[passId + 1] - m_passBarrierOffsets[passId];
+			return m_passBarriers.data() + m_passBarrierOffsets[passId];
+		}
+		/** 根据名称查找pass，多个pass同名(例如多帧中的同一个pass)时返回位置最靠前的一个
+		 * @return 找不到时返回INVALID_PASS_LOCATE */
+		PassLocate FindPass(const char* name) const;
+		/** 根据名称查找所有同名的pass，按queue以及queue内的索引排列
+		 * @return 是否找到 */
+		bool FindPasses(const char* name, std::vector<PassLocate>& passes) const;
+		/** 根据名称查找资源，多个资源同名时返回索引最小的一个
+		 * @return 找不到时返回INVALID_INDEX */
+		ResourceIdx FindResource(const char* name) const;
+		/** 根据名称查找所有同名的资源，按索引排列
+		 * @return 是否找到 */
+		bool FindResources(const char* name, std::vector<ResourceIdx>& resources) const;
+		/** 获取渲染图中所有的pass */
+		const std::vector<Queue>& GetPassMap() const { return m_passMap; }
+		/** 获取渲染图中用到的所有资源 */
+		const std::vector<Resource>& GetResourceMap() const { return m_resourceMap; }
+		/** 获取某个pass的矩形
+		 * @param locate 需要查询的pass的位置
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		const Rectangle& GetPassRect(const PassLocate& locate) const {
+			return m_queuePasses[locate.queueIndex][locate.inqueueIndex];
+		}
+		/** 获取某个queue的矩形
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		const Rectangle& GetQueueRect(QueueIdx queIdx) const { return m_queues[queIdx]; }
+		/** 获取某个resource的矩形
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		const Rectangle& GetResourceRect(ResourceIdx resIdx) const { return m_resources[resIdx]; }
+		/** 获取某个fence的箭头，可以修改类型后通过AddOverlay突出显示
+		 * @remark 调用该函数前，必须保证setup被调用 */
+		Arrow GetFenceArrow(const PassLocate& signal, const PassLocate& receiver) const;
 	private:
+		/** 根据pass上记录的帧索引重新计算每一帧在各个queue中的起始位置
+		 * @remark 要求同一queue中pass的帧索引不递减 */
+		void rebuildFrameOffsets();
+		/** 判断帧内的pass位置是否指向图中已有帧的pass
+		 * @param frame pass所在的帧，必须小于GetFrameCount() */
+		bool isFramePassHelper(FrameIdx frame, const PassLocate& local) const;
 		/** 计算某个pass的矩形形状，并返回该pass的Rectangle
 		 * @param pass 当前需要处理的pass
 		 * @return 该pass初步处理后的Rectangle
 		 * @remark 初步处理是指只有长宽，以及x坐标，y坐标无效 */
 		Rectangle processPassHelper(Pass& pass);
+		/** 按时间布局时，根据pass的起止时间修改其矩形的x坐标与宽度
+		 * @remark 调用前必须确保该pass依赖的pass已经初步处理完毕 */
+		void timePassHelper(const Pass& pass, Rectangle& rect);
 		/** 计算某个queue的矩形形状
 		 * @param queIdx 需要处理的queue的索引
 		 * @return 返回当前queue的宽度
@@ -133,6 +348,11 @@ namespace PipelineProfilingGraph {
 		 * @param resIdx 需要处理的resource在m_resourceMap中的索引
 		 * @remark 调用前必须保证所有的queue被处理完成*/
 		void processResourceHelper(ResourceIdx resIdx);
+		/** 建立查询用的索引
+		 * @remark 调用前必须保证m_passMap和m_resourceMap不再变化 */
+		void buildQueryIndexHelper();
+		/** 在名称索引中查找，返回第一个同名元素的编号，找不到时返回INVALID_INDEX */
+		uint32_t findNameHelper(const std::unordered_map<std::string, uint32_t>& heads, const char* name) const;
 	private:
 		std::vector<Queue> m_passMap; /**< 存储渲染图中所有的pass */
 		std::vector<Resource> m_resourceMap; /**< 存储渲染图中用到的所有元素 */
@@ -141,7 +361,28 @@ namespace PipelineProfilingGraph {
 		std::vector<Rectangle> m_resources; /**< 存储图中所有资源的图形元素设置 */
 		std::vector<Transition> m_transts; /**< 存储图中所有barrier的图形元素设置 */
 		std::vector<Arrow> m_arrows; /**< 存储途中所有箭头(详看箭头类型设置)的图形元素设置 */
+		std::vector<Rectangle> m_frameMarkers; /**< 存储图中各帧起始位置的分界标记 */
+		std::vector<Arrow> m_overlayArrows; /**< 存储分析结果加入的箭头，绘制在最上层 */
+		std::vector<Rectangle> m_overlayRects; /**< 存储分析结果加入的矩形 */
+		std::vector<Polygon> m_overlayPolygons; /**< 存储分析结果加入的多边形 */
+		std::vector<Label> m_overlayLabels; /**< 存储分析结果加入的文字，绘制在最上层 */
+
+		/** 以下为Setup建立的查询索引，pass按queue以及queue内的索引连续编号，各个列表以CSR的方式存储 */
+		std::vector<uint32_t> m_queryPassOffsets; /**< 每个queue中第一个pass的编号 */
+		std::vector<uint32_t> m_passAccessOffsets; /**< pass i访问的资源为m_passAccesses中[offset[i], offset[i+1]) */
+		std::vector<PassResourceAccess> m_passAccesses;
+		std::vector<uint32_t> m_passBarrierOffsets; /**< pass i提交的barrier为m_passBarriers中[offset[i], offset[i+1]) */
+		std::vector<BarrierRef> m_passBarriers;
+		std::unordered_map<std::string, uint32_t> m_passNames; /**< 名称到第一个同名pass的编号 */
+		std::vector<uint32_t> m_nextSamePassName; /**< 每个pass之后下一个同名pass的编号 */
+		std::unordered_map<std::string, uint32_t> m_resourceNames; /**< 名称到第一个同名资源的索引 */
+		std::vector<uint32_t> m_nextSameResourceName; /**< 每个资源之后下一个同名资源的索引 */
+		std::vector< std::vector<PassIdx> > m_frameQueueOffsets; /**< 每一帧在各个queue中第一个pass的索引 */
+		double m_nsPerUnit; /**< 按时间布局时一个单位对应的纳秒数，为0时按顺序布局 */
+		uint64_t m_timeOrigin; /**< 按时间布局时最早的pass的开始时间，对应queue中第一个pass的位置 */
 	};
 
 
 }
+
+#endif // PPFG_H
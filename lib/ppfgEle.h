@@ -27,6 +27,16 @@ namespace PipelineProfilingGraph {
 	const float ARROW_LINE_WIDTH = BARRIER_WIDTH / 4;
 	const float ARROW_LINE_END_RADIUS = ARROW_LINE_WIDTH / 0.618f;
 
+	const float FRAME_MARKER_WIDTH = ARROW_LINE_WIDTH;
+
+	const float TIMED_PASS_MIN_WIDTH = ARROW_LINE_WIDTH; /**< 按时间布局时pass的最小宽度，避免很短的pass不可见 */
+
+	const float MEMORY_CHART_HEIGHT = QUEUE_HEIGHT * 3.0f; /**< 内存占用面积图的高度 */
+
+	const float LABEL_FONT_SIZE = PASS_HEIGHT * 0.6f; /**< 文字的字号 */
+	const float LABEL_CHAR_WIDTH = LABEL_FONT_SIZE * 0.6f; /**< 等宽字体中每个字符的宽度 */
+	const float LABEL_LINE_HEIGHT = PASS_HEIGHT; /**< 表格中每行的高度 */
+
 	struct Point {
 		float x, y;
 	};
@@ -37,12 +47,21 @@ namespace PipelineProfilingGraph {
 			QUEUE,
 			PASS,
 			RESOURCE,
+			FRAME,
+			BUBBLE, /**< queue上的空闲 */
+		};
+		/** 分析结果对图形的标记，可以通过or操作组合 */
+		enum Mark : uint8_t {
+			HIGHLIGHT = 0x01U, /**< 突出显示，例如存在问题的pass */
+			DIMMED = 0x02U, /**< 淡化显示，例如不影响结果的pass */
+			ADDED = 0x04U, /**< 比较两张图时只存在于新图中 */
+			REMOVED = 0x08U, /**< 比较两张图时只存在于旧图中 */
 		};
-		Rectangle() : leftUpPoint({ .0f, .0f }), width(.0f), height(.0f), type(Type::UNDEFINED) {}
+		Rectangle() : leftUpPoint({ .0f, .0f }), width(.0f), height(.0f), type(Type::UNDEFINED), marks(0) {}
 		Rectangle(Point lup, float width, float height, Type type)
-			: leftUpPoint(lup), width(width), height(height), type(type) {}
+			: leftUpPoint(lup), width(width), height(height), type(type), marks(0) {}
 		Rectangle(Point lup, Type type)
-			: leftUpPoint(lup), type(type) {
+			: leftUpPoint(lup), type(type), marks(0) {
 			switch (type) {
 			case QUEUE:
 				width = 0.0f;
@@ -56,6 +75,10 @@ namespace PipelineProfilingGraph {
 				width = .0f;
 				height = RESOURCE_HEIGHT;
 				break;
+			case FRAME:
+				width = FRAME_MARKER_WIDTH;
+				height = .0f;
+				break;
 			default:
 				width = height = 0.0f;
 				break;
@@ -66,6 +89,7 @@ namespace PipelineProfilingGraph {
 		float height; /**< 矩形的高度 */
 		Type type; /**< 矩形的类型，类型不同外观不同 */
 		std::string desc; /**< 矩形的描述信息 */
+		uint8_t marks; /**< 分析结果的标记，由Mark通过or操作设置 */
 	};
 
 	/** “传递”形状的图形元素 */
@@ -79,10 +103,30 @@ namespace PipelineProfilingGraph {
 		enum Type {
 			READ,
 			WRITE,
-			FENCE
+			FENCE,
+			RACE, /**< 两个存在数据竞争的访问 */
+			CRITICAL, /**< 关键路径上的fence */
+			WHISKER, /**< 多帧汇总中从持续时间的中位数到p99的须线 */
+			FENCE_ADDED, /**< 比较两张图时新增的fence */
+			FENCE_REMOVED, /**< 比较两张图时被删除的fence */
 		};
 		std::vector<Point> inflexionPoint; /**< 箭头的各个拐角位置，begin和end的点表示箭头的两个端点 */
 		Type type; /**< 箭头类型，类型不同外观不同 */
+		std::string desc; /**< 箭头的描述信息，为空时不输出 */
+	};
+	/** 单行文字图形元素，使用等宽字体，便于排列成表格 */
+	struct Label {
+		Point leftUpPoint; /**< 文字所在行的左上角 */
+		std::string text; /**< 文字内容 */
+	};
+	/** 多边形图形元素 */
+	struct Polygon {
+		enum Type {
+			MEMORY, /**< 内存占用的面积图 */
+		};
+		std::vector<Point> points; /**< 多边形的各个顶点，首尾自动闭合 */
+		Type type; /**< 多边形类型，类型不同外观不同 */
+		std::string desc; /**< 多边形的描述信息 */
 	};
 }
 
@@ -0,0 +1,84 @@
+#ifndef PROTO_WRITER_H
+#define PROTO_WRITER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/** 该文件提供一个最小的protobuf编码器，只覆盖导出trace所需要的wire type
+ * (varint, fixed64, length-delimited)，避免引入libprotobuf */
+namespace PipelineProfilingGraph {
+
+	class ProtoWriter {
+	public:
+		enum WireType : uint8_t {
+			VARINT = 0,
+			FIXED64 = 1,
+			LENGTH_DELIMITED = 2,
+		};
+		/** 嵌套消息的长度统一使用4字节的冗余varint预留，最大可表示2^28-1字节 */
+		static const size_t NESTED_SIZE_BYTES = 4;
+
+		void AddVarint(uint32_t field, uint64_t value) {
+			writeTag(field, VARINT);
+			writeVarint(value);
+		}
+		void AddSignedVarint(uint32_t field, int64_t value) {
+			/** int64字段直接以补码形式编码，不使用zigzag */
+			AddVarint(field, static_cast<uint64_t>(value));
+		}
+		void AddFixed64(uint32_t field, uint64_t value) {
+			writeTag(field, FIXED64);
+			for (uint32_t i = 0; i < 8; ++i) {
+				m_buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFFU));
+			}
+		}
+		void AddString(uint32_t field, const std::string& str) {
+			AddBytes(field, str.data(), str.size());
+		}
+		void AddBytes(uint32_t field, const void* data, size_t size) {
+			writeTag(field, LENGTH_DELIMITED);
+			writeVarint(size);
+			m_buffer.append(static_cast<const char*>(data), size);
+		}
+		/** 开始写入一个嵌套消息
+		 * @param field 嵌套消息的字段号
+		 * @return 用于EndNested的标记
+		 * @remark 长度先写入占位，EndNested时回填 */
+		size_t BeginNested(uint32_t field) {
+			writeTag(field, LENGTH_DELIMITED);
+			size_t token = m_buffer.size();
+			m_buffer.append(NESTED_SIZE_BYTES, '\0');
+			return token;
+		}
+		/** 结束一个嵌套消息，回填其长度
+		 * @param token BeginNested返回的标记 */
+		void EndNested(size_t token) {
+			size_t size = m_buffer.size() - token - NESTED_SIZE_BYTES;
+			for (size_t i = 0; i < NESTED_SIZE_BYTES; ++i) {
+				uint8_t byte = static_cast<uint8_t>((size >> (i * 7)) & 0x7FU);
+				if (i + 1 < NESTED_SIZE_BYTES) byte |= 0x80U;
+				m_buffer[token + i] = static_cast<char>(byte);
+			}
+		}
+		const std::string& Data() const { return m_buffer; }
+		void Clear() { m_buffer.clear(); }
+		void Reserve(size_t size) { m_buffer.reserve(size); }
+	private:
+		void writeTag(uint32_t field, WireType type) {
+			writeVarint((static_cast<uint64_t>(field) << 3) | type);
+		}
+		void writeVarint(uint64_t value) {
+			while (value >= 0x80U) {
+				m_buffer.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+				value >>= 7;
+			}
+			m_buffer.push_back(static_cast<char>(value));
+		}
+	private:
+		std::string m_buffer; /**< 编码结果 */
+	};
+
+}
+
+#endif // PROTO_WRITER_H
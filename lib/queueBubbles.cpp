@@ -0,0 +1,136 @@
+#include "queueBubbles.h"
+#include "passOrder.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+		struct PassAccess {
+			ResourceIdx resource;
+			bool write;
+		};
+	}
+
+	bool FindQueueBubbles(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		QueueBubbleReport& report, std::string* error, uint64_t minDuration)
+	{
+		report.bubbles.clear();
+		report.idleTime.assign(passMap.size(), 0);
+		report.busyTime.assign(passMap.size(), 0);
+		PassIndex index(passMap);
+		const uint32_t passCount = index.PassCount();
+
+		/** 以CSR方式存储每个pass访问的资源 */
+		std::vector<uint32_t> accessOffsets(passCount + 1, 0);
+		for (const auto& resource : resMap) {
+			bool valid = true;
+			for (const auto& read : resource.readPasses) {
+				valid = valid && index.Contains(read);
+				if (valid) ++accessOffsets[index.ToId(read) + 1];
+			}
+			for (const auto& write : resource.writedPasses) {
+				valid = valid && index.Contains(write);
+				if (valid) ++accessOffsets[index.ToId(write) + 1];
+			}
+			if (!valid) {
+				if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+		}
+		for (uint32_t id = 0; id < passCount; ++id)
+			accessOffsets[id + 1] += accessOffsets[id];
+		std::vector<PassAccess> accesses(accessOffsets.back());
+		std::vector<uint32_t> cursor(accessOffsets.begin(), accessOffsets.end() - 1);
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			for (const auto& read : resMap[resIdx].readPasses)
+				accesses[cursor[index.ToId(read)]++] = { resIdx, false };
+			for (const auto& write : resMap[resIdx].writedPasses)
+				accesses[cursor[index.ToId(write)]++] = { resIdx, true };
+		}
+
+		for (QueueIdx queIdx = 0; queIdx < passMap.size(); ++queIdx) {
+			const Pass* prev = nullptr;
+			for (const auto& pass : passMap[queIdx]) {
+				if (!pass.HasTiming()) {
+					prev = nullptr;
+					continue;
+				}
+				report.busyTime[queIdx] += pass.endTime - pass.startTime;
+				if (!prev || pass.startTime <= prev->endTime) {
+					prev = &pass;
+					continue;
+				}
+				QueueBubble bubble = { prev->locate, pass.locate, prev->endTime, pass.startTime - prev->endTime,
+					QueueBubble::UNKNOWN, INVALID_PASS_LOCATE, INVALID_INDEX };
+				report.idleTime[queIdx] += bubble.duration;
+				prev = &pass;
+
+				/** 在空闲期间结束的其他queue上的pass中选出最晚结束的一个 */
+				const Pass* blocker = nullptr;
+				auto consider = [&](const PassLocate& locate) {
+					const Pass& candidate = passMap[locate.queueIndex][locate.inqueueIndex];
+					if (locate.queueIndex == queIdx || !candidate.HasTiming()
+						|| candidate.endTime <= bubble.start || candidate.endTime > pass.startTime
+						|| (blocker && blocker->endTime >= candidate.endTime))
+						return false;
+					blocker = &candidate;
+					return true;
+				};
+				for (const auto& signal : pass.depPasses) {
+					if (!index.Contains(signal)) {
+						if (error) *error = "pass " + pass.name + " waits for an unknown pass";
+						return false;
+					}
+					consider(signal);
+				}
+				if (blocker) {
+					bubble.cause = QueueBubble::FENCE;
+				}
+				else {
+					/** 写后读、读后写以及写后写都需要等待 */
+					uint32_t id = index.ToId(pass.locate);
+					for (uint32_t accessIdx = accessOffsets[id]; accessIdx < accessOffsets[id + 1]; ++accessIdx) {
+						const PassAccess& access = accesses[accessIdx];
+						const Resource& resource = resMap[access.resource];
+						for (const auto& write : resource.writedPasses)
+							if (consider(write)) bubble.resource = access.resource;
+						if (!access.write) continue;
+						for (const auto& read : resource.readPasses)
+							if (consider(read)) bubble.resource = access.resource;
+					}
+					if (blocker) bubble.cause = QueueBubble::RESOURCE;
+				}
+				if (blocker) bubble.blocker = blocker->locate;
+				if (bubble.duration >= minDuration) report.bubbles.push_back(bubble);
+			}
+		}
+		std::stable_sort(report.bubbles.begin(), report.bubbles.end(),
+			[](const QueueBubble& lhs, const QueueBubble& rhs) { return lhs.duration > rhs.duration; });
+		return true;
+	}
+
+	void HighlightBubbles(PipelineGraph& graph, const QueueBubbleReport& report)
+	{
+		const auto& passMap = graph.GetPassMap();
+		for (const auto& bubble : report.bubbles) {
+			const Rectangle& before = graph.GetPassRect(bubble.before);
+			const Rectangle& after = graph.GetPassRect(bubble.after);
+			float left = before.leftUpPoint.x + before.width;
+			Rectangle rect({ left, before.leftUpPoint.y }, std::max(after.leftUpPoint.x - left, 0.0f),
+				before.height, Rectangle::BUBBLE);
+			char duration[32];
+			std::snprintf(duration, sizeof(duration), "idle %.3f us", static_cast<double>(bubble.duration) / 1000.0);
+			rect.desc = duration;
+			if (bubble.cause != QueueBubble::UNKNOWN) {
+				const Pass& blocker = passMap[bubble.blocker.queueIndex][bubble.blocker.inqueueIndex];
+				rect.desc += bubble.cause == QueueBubble::FENCE ? ", waiting for fence from " : ", waiting for ";
+				rect.desc += blocker.name;
+				if (bubble.cause == QueueBubble::RESOURCE)
+					rect.desc += " on " + graph.GetResourceMap()[bubble.resource].name;
+			}
+			graph.AddOverlay(rect);
+		}
+	}
+
+}
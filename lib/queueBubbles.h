@@ -0,0 +1,48 @@
+#ifndef QUEUE_BUBBLES_H
+#define QUEUE_BUBBLES_H
+
+#include "ppfg.h"
+
+/** 找出queue上相邻两个pass之间的空闲(bubble)并推断其原因
+ * 只考虑前后两个pass都记录了时间的情况；空闲之后的pass等待的fence中，
+ * 发出信号的pass在空闲开始之后才结束的即为原因，有多个时取最晚结束的一个；
+ * 没有这样的fence时，在其他queue上与该pass访问同一资源且存在读写冲突、在空闲期间结束的pass中取最晚结束的一个 */
+namespace PipelineProfilingGraph {
+
+	struct QueueBubble {
+		enum Cause : uint8_t {
+			FENCE, /**< 等待另一个queue上的pass发出的fence */
+			RESOURCE, /**< 等待另一个queue上访问同一资源的pass，但是两者之间没有fence */
+			UNKNOWN, /**< 找不到原因，例如CPU提交较晚 */
+		};
+		PassLocate before; /**< 空闲之前的pass */
+		PassLocate after; /**< 空闲之后的pass */
+		uint64_t start; /**< 空闲开始的时间，即before结束的时间 */
+		uint64_t duration; /**< 空闲的时长 */
+		Cause cause;
+		PassLocate blocker; /**< 导致空闲的pass，UNKNOWN时为INVALID_PASS_LOCATE */
+		ResourceIdx resource; /**< RESOURCE时为冲突的资源，否则为INVALID_INDEX */
+	};
+
+	struct QueueBubbleReport {
+		std::vector<QueueBubble> bubbles; /**< 所有的空闲，按时长从大到小排列 */
+		std::vector<uint64_t> idleTime; /**< 每个queue上空闲的总时长 */
+		std::vector<uint64_t> busyTime; /**< 每个queue上pass的总时长 */
+	};
+
+	/** 找出所有queue上的空闲
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param report 分析的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @param minDuration 短于该时长(纳秒)的空闲会被忽略
+	 * @return 图中引用了未知的pass时返回false */
+	bool FindQueueBubbles(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		QueueBubbleReport& report, std::string* error = nullptr, uint64_t minDuration = 0);
+	/** 在图中用阴影标出所有的空闲，并在其描述中说明原因
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightBubbles(PipelineGraph& graph, const QueueBubbleReport& report);
+
+}
+
+#endif // QUEUE_BUBBLES_H
@@ -0,0 +1,140 @@
+#include "queueOverlap.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		struct BusyEdge {
+			uint64_t time;
+			QueueIdx queue;
+			bool begin;
+		};
+
+		/** 汇总表中的一行 */
+		std::string tableRow(const char* name, uint64_t busy, const char* overlap, double utilization, const char* efficiency) {
+			char row[128];
+			std::snprintf(row, sizeof(row), "%-12s %12.3f %12s %11.1f%% %11s", name, static_cast<double>(busy) / 1000.0,
+				overlap, utilization * 100.0, efficiency);
+			return row;
+		}
+
+	}
+
+	void MeasureQueueOverlap(const std::vector<Queue>& passMap, QueueOverlapMetrics& metrics)
+	{
+		const QueueIdx queueCount = static_cast<QueueIdx>(passMap.size());
+		metrics.spanStart = 0;
+		metrics.spanEnd = 0;
+		metrics.busyTime.assign(queueCount, 0);
+		metrics.overlapTime.assign(queueCount, std::vector<uint64_t>(queueCount, 0));
+
+		/** 合并每个queue上重叠或相接的pass，得到互不相交的忙碌区间 */
+		std::vector<BusyEdge> edges;
+		std::vector< std::pair<uint64_t, uint64_t> > intervals;
+		bool timed = false;
+		for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+			intervals.clear();
+			for (const auto& pass : passMap[queIdx])
+				if (pass.HasTiming()) intervals.push_back(std::make_pair(pass.startTime, pass.endTime));
+			std::sort(intervals.begin(), intervals.end());
+			for (size_t begin = 0; begin < intervals.size();) {
+				uint64_t start = intervals[begin].first, end = intervals[begin].second;
+				size_t next = begin + 1;
+				while (next < intervals.size() && intervals[next].first <= end) {
+					end = std::max(end, intervals[next].second);
+					++next;
+				}
+				edges.push_back({ start, queIdx, true });
+				edges.push_back({ end, queIdx, false });
+				metrics.busyTime[queIdx] += end - start;
+				metrics.spanStart = timed ? std::min(metrics.spanStart, start) : start;
+				metrics.spanEnd = timed ? std::max(metrics.spanEnd, end) : end;
+				timed = true;
+				begin = next;
+			}
+		}
+
+		/** 按时间扫描，每两个相邻端点之间同时忙碌的queue两两累加 */
+		std::sort(edges.begin(), edges.end(), [](const BusyEdge& lhs, const BusyEdge& rhs) {
+			/** 时间相同时先处理开始，保证长度为0的区间也先开始后结束 */
+			return lhs.time != rhs.time ? lhs.time < rhs.time : lhs.begin > rhs.begin;
+		});
+		std::vector<QueueIdx> active;
+		for (size_t edgeIdx = 0; edgeIdx < edges.size(); ++edgeIdx) {
+			const BusyEdge& edge = edges[edgeIdx];
+			if (edge.begin) active.push_back(edge.queue);
+			else active.erase(std::find(active.begin(), active.end(), edge.queue));
+			if (edgeIdx + 1 == edges.size()) break;
+			uint64_t duration = edges[edgeIdx + 1].time - edge.time;
+			if (duration == 0) continue;
+			for (size_t first = 0; first < active.size(); ++first) {
+				for (size_t second = first + 1; second < active.size(); ++second) {
+					metrics.overlapTime[active[first]][active[second]] += duration;
+					metrics.overlapTime[active[second]][active[first]] += duration;
+				}
+			}
+		}
+		for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx)
+			metrics.overlapTime[queIdx][queIdx] = metrics.busyTime[queIdx];
+	}
+
+	bool SaveQueueOverlap(const char* path, const QueueOverlapMetrics& metrics)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file) return false;
+		const QueueIdx queueCount = static_cast<QueueIdx>(metrics.busyTime.size());
+		std::fprintf(file, "{\n  \"span\": %llu,\n  \"queues\": [", static_cast<unsigned long long>(metrics.Span()));
+		for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+			std::fprintf(file, "%s\n    { \"queue\": %u, \"busy\": %llu, \"utilization\": %.6f }", queIdx ? "," : "",
+				queIdx, static_cast<unsigned long long>(metrics.busyTime[queIdx]), metrics.Utilization(queIdx));
+		}
+		std::fprintf(file, " ],\n  \"pairs\": [");
+		bool firstPair = true;
+		for (QueueIdx first = 0; first < queueCount; ++first) {
+			for (QueueIdx second = first + 1; second < queueCount; ++second) {
+				std::fprintf(file, "%s\n    { \"queues\": [%u, %u], \"busy\": %llu, \"overlap\": %llu, "
+					"\"utilization\": %.6f, \"efficiency\": %.6f }", firstPair ? "" : ",", first, second,
+					static_cast<unsigned long long>(metrics.UnionBusyTime(first, second)),
+					static_cast<unsigned long long>(metrics.overlapTime[first][second]),
+					metrics.Utilization(first, second), metrics.OverlapEfficiency(first, second));
+				firstPair = false;
+			}
+		}
+		std::fprintf(file, " ]\n}\n");
+		bool succeed = std::ferror(file) == 0;
+		return std::fclose(file) == 0 && succeed;
+	}
+
+	void AddQueueOverlapTable(PipelineGraph& graph, const QueueOverlapMetrics& metrics)
+	{
+		const QueueIdx queueCount = static_cast<QueueIdx>(metrics.busyTime.size());
+		std::vector<std::string> rows;
+		char span[64];
+		std::snprintf(span, sizeof(span), "timed span %.3f us", static_cast<double>(metrics.Span()) / 1000.0);
+		rows.push_back(span);
+		char header[128];
+		std::snprintf(header, sizeof(header), "%-12s %12s %12s %12s %11s", "queues", "busy(us)", "overlap(us)",
+			"utilization", "efficiency");
+		rows.push_back(header);
+		char name[32], overlap[32], efficiency[32];
+		for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+			std::snprintf(name, sizeof(name), "%u", queIdx);
+			rows.push_back(tableRow(name, metrics.busyTime[queIdx], "-", metrics.Utilization(queIdx), "-"));
+		}
+		for (QueueIdx first = 0; first < queueCount; ++first) {
+			for (QueueIdx second = first + 1; second < queueCount; ++second) {
+				std::snprintf(name, sizeof(name), "%u+%u", first, second);
+				std::snprintf(overlap, sizeof(overlap), "%.3f", static_cast<double>(metrics.overlapTime[first][second]) / 1000.0);
+				std::snprintf(efficiency, sizeof(efficiency), "%.1f%%", metrics.OverlapEfficiency(first, second) * 100.0);
+				rows.push_back(tableRow(name, metrics.UnionBusyTime(first, second), overlap,
+					metrics.Utilization(first, second), efficiency));
+			}
+		}
+		float top = graph.GetContentBottom() + QUEUE_PADDING;
+		for (size_t rowIdx = 0; rowIdx < rows.size(); ++rowIdx)
+			graph.AddOverlay(Label{ { LEFT_MARGIN, top + rowIdx * LABEL_LINE_HEIGHT }, rows[rowIdx] });
+	}
+
+}
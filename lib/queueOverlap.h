@@ -0,0 +1,55 @@
+#ifndef QUEUE_OVERLAP_H
+#define QUEUE_OVERLAP_H
+
+#include "ppfg.h"
+#include <algorithm>
+
+/** 统计各个queue的忙碌时间以及queue之间同时执行的时间，用于衡量async compute的效果
+ * 只使用记录了时间的pass: 每个queue的忙碌区间为其pass的起止时间的并集，
+ * 再把所有queue的区间端点排序后扫描一遍，累加每对queue同时忙碌的时间；
+ * 统计的时间范围为最早的开始时间到最晚的结束时间 */
+namespace PipelineProfilingGraph {
+
+	struct QueueOverlapMetrics {
+		uint64_t spanStart; /**< 最早的pass开始的时间，没有记录时间的pass时为0 */
+		uint64_t spanEnd; /**< 最晚的pass结束的时间 */
+		std::vector<uint64_t> busyTime; /**< 每个queue忙碌的时间 */
+		std::vector< std::vector<uint64_t> > overlapTime; /**< 每对queue同时忙碌的时间，对称矩阵，对角线为busyTime */
+
+		uint64_t Span() const { return spanEnd - spanStart; }
+		/** 某个queue在统计范围内忙碌的比例 */
+		double Utilization(QueueIdx queIdx) const {
+			return Span() ? static_cast<double>(busyTime[queIdx]) / static_cast<double>(Span()) : 0.0;
+		}
+		/** 两个queue的平均利用率 */
+		double Utilization(QueueIdx first, QueueIdx second) const {
+			return (Utilization(first) + Utilization(second)) / 2.0;
+		}
+		/** 两个queue中至少一个忙碌的时间 */
+		uint64_t UnionBusyTime(QueueIdx first, QueueIdx second) const {
+			return busyTime[first] + busyTime[second] - overlapTime[first][second];
+		}
+		/** 忙碌时间较短的queue有多少比例与另一个queue同时执行，为1时其工作完全被另一个queue掩盖 */
+		double OverlapEfficiency(QueueIdx first, QueueIdx second) const {
+			uint64_t shorter = std::min(busyTime[first], busyTime[second]);
+			return shorter ? static_cast<double>(overlapTime[first][second]) / static_cast<double>(shorter) : 0.0;
+		}
+	};
+
+	/** 统计所有queue的忙碌时间与两两之间同时执行的时间
+	 * @param passMap 渲染图中所有的pass
+	 * @param metrics 统计的结果 */
+	void MeasureQueueOverlap(const std::vector<Queue>& passMap, QueueOverlapMetrics& metrics);
+	/** 将统计结果写成JSON文件，便于在不同版本之间比较
+	 * 格式: { "span": 纳秒数,
+	 *         "queues": [ { "queue": 0, "busy": 纳秒数, "utilization": 比例 } ],
+	 *         "pairs": [ { "queues": [0, 1], "busy": 纳秒数, "overlap": 纳秒数, "utilization": 比例, "efficiency": 比例 } ] }
+	 * @return 是否写入成功 */
+	bool SaveQueueOverlap(const char* path, const QueueOverlapMetrics& metrics);
+	/** 在图的下方加入统计结果的汇总表
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void AddQueueOverlapTable(PipelineGraph& graph, const QueueOverlapMetrics& metrics);
+
+}
+
+#endif // QUEUE_OVERLAP_H
@@ -0,0 +1,108 @@
+#include "raceDetector.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+		struct QueueAccess {
+			PassIdx inqueueIndex;
+			bool write;
+		};
+	}
+
+	bool DetectRaces(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		std::vector<DataRace>& races, std::string* error, const ReachabilityIndex::Options& options)
+	{
+		races.clear();
+		ReachabilityIndex reachability;
+		if (!reachability.Build(passMap, options, error)) return false;
+		const PassIndex& index = reachability.Index();
+
+		/** 每个queue上的访问，只记录本资源用到的queue */
+		std::vector< std::vector<QueueAccess> > accesses(passMap.size());
+		std::vector<QueueIdx> usedQueues;
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			const Resource& resource = resMap[resIdx];
+			for (QueueIdx queIdx : usedQueues) accesses[queIdx].clear();
+			usedQueues.clear();
+			bool valid = true;
+			auto add = [&](const PassLocate& pass, bool write) {
+				if (!index.Contains(pass)) {
+					valid = false;
+					return;
+				}
+				if (accesses[pass.queueIndex].empty()) usedQueues.push_back(pass.queueIndex);
+				accesses[pass.queueIndex].push_back({ pass.inqueueIndex, write });
+			};
+			for (const auto& read : resource.readPasses) add(read, false);
+			for (const auto& write : resource.writedPasses) add(write, true);
+			if (!valid) {
+				if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+			if (usedQueues.size() < 2) continue;
+			/** 同一个pass的多次访问合并为一次，写入优先 */
+			for (QueueIdx queIdx : usedQueues) {
+				auto& list = accesses[queIdx];
+				std::sort(list.begin(), list.end(), [](const QueueAccess& lhs, const QueueAccess& rhs) {
+					return lhs.inqueueIndex != rhs.inqueueIndex ? lhs.inqueueIndex < rhs.inqueueIndex : lhs.write > rhs.write;
+				});
+				list.erase(std::unique(list.begin(), list.end(), [](const QueueAccess& lhs, const QueueAccess& rhs) {
+					return lhs.inqueueIndex == rhs.inqueueIndex;
+				}), list.end());
+			}
+			std::sort(usedQueues.begin(), usedQueues.end());
+
+			for (QueueIdx writeQueue : usedQueues) {
+				for (const QueueAccess& write : accesses[writeQueue]) {
+					if (!write.write) continue;
+					uint32_t writeId = index.ToId({ writeQueue, write.inqueueIndex });
+					for (QueueIdx otherQueue : usedQueues) {
+						if (otherQueue == writeQueue) continue;
+						const auto& list = accesses[otherQueue];
+						uint32_t queueBegin = index.QueueBegin(otherQueue);
+						auto first = std::partition_point(list.begin(), list.end(), [&](const QueueAccess& access) {
+							return reachability.HappensBefore(queueBegin + access.inqueueIndex, writeId);
+						});
+						auto last = std::partition_point(first, list.end(), [&](const QueueAccess& access) {
+							return !reachability.HappensBefore(writeId, queueBegin + access.inqueueIndex);
+						});
+						for (auto access = first; access != last; ++access) {
+							/** 两次写入之间的竞争只从queue索引较小的一方报告一次 */
+							if (access->write && otherQueue < writeQueue) continue;
+							races.push_back({ resIdx, { writeQueue, write.inqueueIndex },
+								{ otherQueue, access->inqueueIndex }, access->write });
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	void HighlightRaces(PipelineGraph& graph, const std::vector<DataRace>& races)
+	{
+		const auto& passMap = graph.GetPassMap();
+		const auto& resMap = graph.GetResourceMap();
+		for (const auto& race : races) {
+			const std::string& resource = resMap[race.resource].name;
+			const Pass& write = passMap[race.write.queueIndex][race.write.inqueueIndex];
+			const Pass& other = passMap[race.other.queueIndex][race.other.inqueueIndex];
+			std::string desc = "race on " + resource + ": " + write.name + " writes, "
+				+ other.name + (race.otherWrites ? " writes" : " reads");
+			graph.MarkPass(race.write, Rectangle::HIGHLIGHT, desc);
+			graph.MarkPass(race.other, Rectangle::HIGHLIGHT, desc);
+
+			/** 连接两个pass的中心 */
+			const Rectangle& from = graph.GetPassRect(race.write);
+			const Rectangle& to = graph.GetPassRect(race.other);
+			Arrow arrow;
+			arrow.type = Arrow::RACE;
+			arrow.inflexionPoint.push_back({ from.leftUpPoint.x + from.width / 2.0f, from.leftUpPoint.y + from.height / 2.0f });
+			arrow.inflexionPoint.push_back({ to.leftUpPoint.x + to.width / 2.0f, to.leftUpPoint.y + to.height / 2.0f });
+			arrow.desc = desc;
+			graph.AddOverlay(arrow);
+		}
+	}
+
+}
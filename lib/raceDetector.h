@@ -0,0 +1,35 @@
+#ifndef RACE_DETECTOR_H
+#define RACE_DETECTOR_H
+
+#include "reachability.h"
+
+/** 检查不同queue上对同一资源的冲突访问是否有先后关系
+ * 至少一方为写入、位于不同queue并且互相之间没有先后关系的两次访问即为数据竞争
+ * 每个资源的访问按queue分组并按queue内的索引排序，对于每次写入，
+ * 另一个queue上先于它的访问是一个前缀，后于它的访问是一个后缀，两次二分查找即可得到所有竞争的访问 */
+namespace PipelineProfilingGraph {
+
+	struct DataRace {
+		ResourceIdx resource; /**< 发生竞争的资源 */
+		PassLocate write; /**< 写入该资源的pass */
+		PassLocate other; /**< 与写入没有先后关系的另一次访问 */
+		bool otherWrites; /**< 另一次访问是否也是写入 */
+	};
+
+	/** 找出所有的数据竞争
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param races 找到的数据竞争，按资源排列
+	 * @param error 失败时的错误信息，可以为空
+	 * @param options 建立先后关系索引时的选项
+	 * @return 图中引用了未知的pass、fence之间存在环或者索引超出内存上限时返回false */
+	bool DetectRaces(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		std::vector<DataRace>& races, std::string* error = nullptr,
+		const ReachabilityIndex::Options& options = ReachabilityIndex::Options());
+	/** 在图中突出显示存在竞争的pass，并用箭头连接每一对竞争的访问
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightRaces(PipelineGraph& graph, const std::vector<DataRace>& races);
+
+}
+
+#endif // RACE_DETECTOR_H
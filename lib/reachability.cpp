@@ -0,0 +1,114 @@
+#include "reachability.h"
+#include <algorithm>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PPFG_REACHABILITY_SSE2
+#endif
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+		/** dst |= src */
+		void orWords(uint64_t* dst, const uint64_t* src, size_t count) {
+			size_t index = 0;
+#ifdef PPFG_REACHABILITY_SSE2
+			for (; index + 2 <= count; index += 2) {
+				__m128i value = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + index)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index)));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index), value);
+			}
+#endif
+			for (; index < count; ++index)
+				dst[index] |= src[index];
+		}
+
+		uint64_t rowWords(uint64_t rank) {
+			return (rank + 63) >> 6;
+		}
+	}
+
+	bool ReachabilityIndex::Build(const std::vector<Queue>& passMap, const Options& options, std::string* error)
+	{
+		m_clocks.clear();
+		m_rowOffsets.clear();
+		m_bits.clear();
+		m_index.Build(passMap);
+		if (!TopologicalOrder(passMap, m_index, m_order, error)) return false;
+		const uint64_t passCount = m_index.PassCount();
+		m_queueCount = m_index.QueueCount();
+		m_ranks.resize(m_order.size());
+		for (uint32_t rank = 0; rank < m_order.size(); ++rank)
+			m_ranks[m_order[rank]] = rank;
+
+		/** 两种方式都需要的编号、拓扑序等不计入比较 */
+		uint64_t chainBytes = passCount * m_queueCount * sizeof(uint32_t) + passCount * sizeof(PassLocate);
+		uint64_t bitsetBytes = (passCount * passCount / 128 + passCount) * sizeof(uint64_t);
+		Mode mode = options.mode;
+		if (mode == AUTO) mode = chainBytes <= bitsetBytes ? CHAIN : BITSET;
+		uint64_t bytes = mode == CHAIN ? chainBytes : bitsetBytes;
+		if (bytes > options.memoryBudget) {
+			if (error) *error = "reachability index needs " + std::to_string(bytes) + " bytes, over the budget of "
+				+ std::to_string(options.memoryBudget);
+			return false;
+		}
+		m_mode = mode;
+		if (mode == CHAIN) buildChains(passMap);
+		else buildBitsets(passMap);
+		return true;
+	}
+
+	void ReachabilityIndex::buildChains(const std::vector<Queue>& passMap)
+	{
+		const uint32_t passCount = m_index.PassCount();
+		m_locates.resize(passCount);
+		for (uint32_t id = 0; id < passCount; ++id)
+			m_locates[id] = m_index.ToLocate(id);
+		m_clocks.assign(static_cast<size_t>(passCount) * m_queueCount, 0);
+		for (uint32_t id : m_order) {
+			const PassLocate& locate = m_locates[id];
+			uint32_t* clock = m_clocks.data() + static_cast<size_t>(id) * m_queueCount;
+			if (locate.inqueueIndex != 0)
+				std::copy(clock - m_queueCount, clock, clock);
+			for (const auto& dep : passMap[locate.queueIndex][locate.inqueueIndex].depPasses) {
+				const uint32_t* source = m_clocks.data() + static_cast<size_t>(m_index.ToId(dep)) * m_queueCount;
+				for (QueueIdx queIdx = 0; queIdx < m_queueCount; ++queIdx)
+					clock[queIdx] = std::max(clock[queIdx], source[queIdx]);
+			}
+			clock[locate.queueIndex] = locate.inqueueIndex + 1;
+		}
+	}
+
+	void ReachabilityIndex::buildBitsets(const std::vector<Queue>& passMap)
+	{
+		const uint32_t passCount = m_index.PassCount();
+		m_locates.clear();
+		m_rowOffsets.resize(static_cast<size_t>(passCount) + 1);
+		m_rowOffsets[0] = 0;
+		for (uint32_t rank = 0; rank < passCount; ++rank)
+			m_rowOffsets[rank + 1] = m_rowOffsets[rank] + rowWords(rank);
+		m_bits.assign(static_cast<size_t>(m_rowOffsets.back()), 0);
+
+		/** 按拓扑序处理，前驱的位图一定已经完成，前驱的位图比当前行短，直接按字合并 */
+		for (uint32_t rank = 0; rank < passCount; ++rank) {
+			uint64_t* row = m_bits.data() + m_rowOffsets[rank];
+			auto merge = [this, row](uint32_t id) {
+				uint32_t source = m_ranks[id];
+				orWords(row, m_bits.data() + m_rowOffsets[source], static_cast<size_t>(rowWords(source)));
+				row[source >> 6] |= 1ULL << (source & 63);
+			};
+			uint32_t id = m_order[rank];
+			PassLocate locate = m_index.ToLocate(id);
+			if (locate.inqueueIndex != 0) merge(id - 1);
+			for (const auto& dep : passMap[locate.queueIndex][locate.inqueueIndex].depPasses)
+				merge(m_index.ToId(dep));
+		}
+	}
+
+	size_t ReachabilityIndex::MemoryUsage() const
+	{
+		return m_order.size() * sizeof(uint32_t) + m_ranks.size() * sizeof(uint32_t)
+			+ m_locates.size() * sizeof(PassLocate) + m_clocks.size() * sizeof(uint32_t)
+			+ m_rowOffsets.size() * sizeof(uint64_t) + m_bits.size() * sizeof(uint64_t);
+	}
+
+}
@@ -0,0 +1,80 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include "passOrder.h"
+
+/** pass之间的先后关系(happens-before)索引
+ * pass A先于pass B当且仅当沿着queue内的顺序以及fence可以从A到达B，建立后每次查询都是O(1)
+ * 有两种存储方式:
+ *   CHAIN: 每个queue是一条链，每个pass只需要记录各个queue上能到达它的最后一个pass，占用 pass数 * queue数 * 4 字节
+ *   BITSET: 按拓扑序给pass编号，每个pass用位图记录拓扑序在它之前的所有祖先，
+ *           只需要保存下三角部分，占用约 pass数^2 / 16 字节，适合queue数很多的图 */
+namespace PipelineProfilingGraph {
+
+	class ReachabilityIndex {
+	public:
+		enum Mode : uint8_t {
+			AUTO, /**< 选择占用内存较少的方式 */
+			CHAIN,
+			BITSET,
+		};
+		struct Options {
+			Options() : mode(AUTO), memoryBudget(256U << 20) {}
+			Mode mode;
+			size_t memoryBudget; /**< 索引最多占用的字节数 */
+		};
+
+		ReachabilityIndex() : m_mode(AUTO), m_queueCount(0) {}
+		/** 建立索引
+		 * @param passMap 渲染图中所有的pass
+		 * @param options 存储方式以及内存的上限
+		 * @param error 失败时的错误信息，可以为空
+		 * @return fence引用了未知的pass、fence之间存在环或者超出内存上限时返回false */
+		bool Build(const std::vector<Queue>& passMap, const Options& options = Options(), std::string* error = nullptr);
+
+		/** a是否先于b，a与b相同时返回false */
+		bool HappensBefore(const PassLocate& a, const PassLocate& b) const {
+			return HappensBefore(m_index.ToId(a), m_index.ToId(b));
+		}
+		/** 同上，参数为PassIndex中的编号 */
+		bool HappensBefore(uint32_t a, uint32_t b) const {
+			if (a == b) return false;
+			if (m_mode == CHAIN) {
+				PassLocate locate = m_locates[a];
+				return m_clocks[static_cast<size_t>(b) * m_queueCount + locate.queueIndex] > locate.inqueueIndex;
+			}
+			uint32_t rankA = m_ranks[a], rankB = m_ranks[b];
+			if (rankA >= rankB) return false;
+			return (m_bits[m_rowOffsets[rankB] + (rankA >> 6)] >> (rankA & 63)) & 1U;
+		}
+		/** a与b之间没有先后关系 */
+		bool Concurrent(const PassLocate& a, const PassLocate& b) const {
+			return a != b && !HappensBefore(a, b) && !HappensBefore(b, a);
+		}
+
+		Mode GetMode() const { return m_mode; }
+		const PassIndex& Index() const { return m_index; }
+		/** 拓扑序中的第rank个pass，拓扑序的定义见TopologicalOrder */
+		uint32_t Ordered(uint32_t rank) const { return m_order[rank]; }
+		/** pass在拓扑序中的位置 */
+		uint32_t Rank(uint32_t id) const { return m_ranks[id]; }
+		/** 索引占用的字节数 */
+		size_t MemoryUsage() const;
+	private:
+		void buildChains(const std::vector<Queue>& passMap);
+		void buildBitsets(const std::vector<Queue>& passMap);
+	private:
+		Mode m_mode;
+		uint32_t m_queueCount;
+		PassIndex m_index;
+		std::vector<uint32_t> m_order; /**< 拓扑序 */
+		std::vector<uint32_t> m_ranks; /**< 每个pass在拓扑序中的位置 */
+		std::vector<PassLocate> m_locates; /**< 每个编号对应的pass位置 */
+		std::vector<uint32_t> m_clocks; /**< CHAIN: 每个pass在各个queue上能到达它的最后一个pass的索引加1 */
+		std::vector<uint64_t> m_rowOffsets; /**< BITSET: 拓扑序中第r个pass的位图在m_bits中的起始位置 */
+		std::vector<uint64_t> m_bits; /**< BITSET: 第r行记录拓扑序在[0, r)中的祖先 */
+	};
+
+}
+
+#endif // REACHABILITY_H
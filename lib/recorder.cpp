@@ -0,0 +1,218 @@
+#include "recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace PipelineProfilingGraph {
+
+	Recorder::Recorder(size_t ringCapacity)
+		: m_ringCapacity(ringCapacity), m_orphanEvents(0), m_lateEvents(0), m_lastEndedFrame(0),
+		m_anyFrameEnded(false), m_running(false) {}
+
+	Recorder::~Recorder()
+	{
+		StopConsumer();
+	}
+
+	uint32_t Recorder::RegisterName(const char* name)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_names.push_back(name ? name : "");
+		return static_cast<uint32_t>(m_names.size() - 1);
+	}
+
+	ThreadRecorder* Recorder::CreateThreadRecorder()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threads.push_back(std::unique_ptr<ThreadRecorder>(new ThreadRecorder(m_ringCapacity)));
+		return m_threads.back().get();
+	}
+
+	uint64_t Recorder::DroppedEvents() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uint64_t dropped = 0;
+		for (const auto& thread : m_threads)
+			dropped += thread->Dropped();
+		return dropped;
+	}
+
+	void Recorder::Drain()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_drainList.clear();
+			for (const auto& thread : m_threads)
+				m_drainList.push_back(thread.get());
+		}
+		auto drainOnce = [this]() {
+			for (ThreadRecorder* thread : m_drainList) {
+				RecordEvent event;
+				while (thread->Pop(event)) {
+					/** 已经结束的帧不会再被组装，其事件直接丢弃，否则会留在m_pendingFrames中永远不被释放 */
+					if (m_anyFrameEnded && event.frame <= m_lastEndedFrame)
+						++m_lateEvents;
+					else if (event.type == RecordEvent::FRAME_END)
+						m_frameEnds.push_back(event.frame);
+					else
+						m_pendingFrames[event.frame].push_back(event);
+				}
+			}
+		};
+		drainOnce();
+		if (m_frameEnds.empty()) return;
+		/** 帧结束事件可能先于其他线程中该帧的事件被读到，因此再收集一次，
+		 * 这些事件都在帧结束事件写入之前写入，读到帧结束事件之后的一次完整收集一定能读到；
+		 * 第二次收集中读到的帧结束事件还没有经过完整的收集，留到下一次Drain再处理 */
+		const size_t confirmed = m_frameEnds.size();
+		drainOnce();
+		std::vector<uint32_t> frameEnds(m_frameEnds.begin(), m_frameEnds.begin() + confirmed);
+		m_frameEnds.erase(m_frameEnds.begin(), m_frameEnds.begin() + confirmed);
+		for (uint32_t frame : frameEnds) {
+			auto pending = m_pendingFrames.find(frame);
+			auto& ended = m_endedFrames[frame];
+			if (pending == m_pendingFrames.end()) continue;
+			if (ended.empty()) ended.swap(pending->second);
+			else ended.insert(ended.end(), pending->second.begin(), pending->second.end());
+			m_pendingFrames.erase(pending);
+		}
+		for (uint32_t frame : frameEnds) {
+			if (!m_anyFrameEnded || frame > m_lastEndedFrame) m_lastEndedFrame = frame;
+			m_anyFrameEnded = true;
+		}
+		/** 比最新结束的帧更早却仍未结束的帧不会再结束，丢弃其事件 */
+		while (!m_pendingFrames.empty() && m_pendingFrames.begin()->first <= m_lastEndedFrame) {
+			m_lateEvents += m_pendingFrames.begin()->second.size();
+			m_pendingFrames.erase(m_pendingFrames.begin());
+		}
+	}
+
+	bool Recorder::NextFrame(PipelineGraph& graph, uint32_t& frame)
+	{
+		if (m_endedFrames.empty()) return false;
+		auto first = m_endedFrames.begin();
+		frame = first->first;
+		bool succeed = buildFrame(first->second, graph);
+		m_endedFrames.erase(first);
+		return succeed;
+	}
+
+	bool Recorder::buildFrame(const std::vector<RecordEvent>& events, PipelineGraph& graph)
+	{
+		{
+			/** 名称只会追加，只需要拷贝新注册的部分 */
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (size_t index = m_nameSnapshot.size(); index < m_names.size(); ++index)
+				m_nameSnapshot.push_back(m_names[index]);
+		}
+		auto name = [this](uint32_t id) {
+			return id < m_nameSnapshot.size() ? m_nameSnapshot[id].c_str() : "";
+		};
+
+		/** 同一queue上的pass按key排列 */
+		std::vector<const RecordEvent*> begins;
+		for (const auto& event : events)
+			if (event.type == RecordEvent::PASS_BEGIN) begins.push_back(&event);
+		std::sort(begins.begin(), begins.end(), [](const RecordEvent* lhs, const RecordEvent* rhs) {
+			return lhs->queue != rhs->queue ? lhs->queue < rhs->queue : lhs->pass < rhs->pass;
+		});
+
+		m_builder.Clear();
+		m_builder.Reserve(static_cast<uint32_t>(begins.size()), 0, static_cast<uint32_t>(events.size()),
+			0, 0);
+		std::unordered_map<uint32_t, PassHandle> passes;
+		passes.reserve(begins.size());
+		std::vector<uint64_t> beginTimes; /**< 以PassHandle为索引的开始时间 */
+		beginTimes.reserve(begins.size());
+		for (const RecordEvent* begin : begins) {
+			if (passes.count(begin->pass)) continue;
+			passes[begin->pass] = m_builder.AddPass(begin->queue, name(begin->name));
+			beginTimes.push_back(begin->timestamp);
+		}
+
+		struct ResourceState {
+			ResourceHandle handle;
+			PassHandle create;
+			PassHandle destroy;
+		};
+		std::unordered_map<uint32_t, ResourceState> resources;
+		std::vector<uint32_t> resourceOrder; /**< 资源按照第一次出现的顺序排列 */
+		for (const auto& event : events) {
+			if (event.type == RecordEvent::PASS_BEGIN) continue;
+			auto pass = passes.find(event.pass);
+			if (event.type == RecordEvent::PASS_END) {
+				/** 只有开始与结束都记录了时间戳的pass才有起止时间 */
+				if (pass == passes.end()) continue;
+				uint64_t begin = beginTimes[pass->second.id];
+				if (begin != 0 && event.timestamp >= begin)
+					m_builder.SetPassTime(pass->second, begin, event.timestamp);
+				continue;
+			}
+			if (pass == passes.end() && event.type != RecordEvent::MEMORY) {
+				++m_orphanEvents;
+				continue;
+			}
+			if (event.type == RecordEvent::FENCE) {
+				auto signal = passes.find(event.target);
+				if (signal == passes.end()) ++m_orphanEvents;
+				else m_builder.AddFence(signal->second, pass->second);
+				continue;
+			}
+			auto resource = resources.find(event.target);
+			if (resource == resources.end()) {
+				ResourceState state = { m_builder.AddResource(name(event.name)), INVALID_PASS_HANDLE, INVALID_PASS_HANDLE };
+				resource = resources.insert(std::make_pair(event.target, state)).first;
+				resourceOrder.push_back(event.target);
+			}
+			ResourceState& state = resource->second;
+			switch (event.type) {
+			case RecordEvent::READ: m_builder.Read(state.handle, pass->second); break;
+			case RecordEvent::WRITE: m_builder.Write(state.handle, pass->second); break;
+			case RecordEvent::CREATE: state.create = pass->second; break;
+			case RecordEvent::DESTROY: state.destroy = pass->second; break;
+			case RecordEvent::BARRIER:
+				m_builder.AddBarrier(state.handle, pass->second, name(event.desc), event.flags);
+				break;
+			case RecordEvent::MEMORY:
+				m_builder.SetMemory(state.handle, event.timestamp, event.desc, event.flags);
+				break;
+			default: break;
+			}
+		}
+		for (uint32_t key : resourceOrder) {
+			const ResourceState& state = resources[key];
+			m_builder.SetLifetime(state.handle, state.create, state.destroy);
+		}
+		return m_builder.Build(graph);
+	}
+
+	void Recorder::StartConsumer(std::function<void(PipelineGraph&, uint32_t)> onFrame)
+	{
+		StopConsumer();
+		m_running = true;
+		m_consumer = std::thread([this, onFrame]() {
+			PipelineGraph graph;
+			uint32_t frame = 0;
+			while (true) {
+				bool running = m_running.load();
+				Drain();
+				bool consumed = false;
+				while (NextFrame(graph, frame)) {
+					onFrame(graph, frame);
+					consumed = true;
+				}
+				/** 最后一次Drain中读到的帧结束事件需要再收集一次才能处理 */
+				if (!running && m_frameEnds.empty()) break;
+				if (!consumed) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+	}
+
+	void Recorder::StopConsumer()
+	{
+		if (!m_consumer.joinable()) return;
+		m_running = false;
+		m_consumer.join();
+	}
+
+}
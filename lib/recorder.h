@@ -0,0 +1,159 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "frameGraphBuilder.h"
+#include "spscRing.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/** 在引擎内部记录渲染图
+ * 每个记录线程拥有一个ThreadRecorder，事件写入其独占的SPSC环形缓冲，缓冲满时丢弃事件而不阻塞；
+ * 消费线程收集各个缓冲中的事件，在某一帧结束后将其组装成PipelineGraph
+ * pass与资源均以引擎自己的编号(key)标识，同一queue上的pass按key从小到大排列 */
+namespace PipelineProfilingGraph {
+
+	/** 定长的记录事件 */
+	struct RecordEvent {
+		enum Type : uint8_t {
+			PASS_BEGIN,
+			PASS_END,
+			FENCE,
+			READ,
+			WRITE,
+			CREATE,
+			DESTROY,
+			BARRIER,
+			FRAME_END,
+			MEMORY,
+		};
+		uint64_t timestamp; /**< PASS_BEGIN/PASS_END的GPU时间戳(纳秒)，0表示没有记录；MEMORY中为资源占用的字节数 */
+		uint32_t frame; /**< 事件所属的帧 */
+		uint32_t pass; /**< pass的key，FENCE中为等待的pass */
+		uint32_t target; /**< 资源的key，FENCE中为发出信号的pass */
+		uint32_t name; /**< pass或资源的名称，BARRIER中为资源的名称 */
+		uint32_t desc; /**< BARRIER的描述，MEMORY中为资源的对齐字节数 */
+		uint16_t queue; /**< PASS_BEGIN中pass所在的queue */
+		uint8_t type; /**< 见Type */
+		uint8_t flags; /**< BARRIER的Barrier::Flag，MEMORY中为资源所在的堆 */
+	};
+	static_assert(sizeof(RecordEvent) == 32, "RecordEvent should stay compact");
+
+	/** 单个记录线程使用的记录器，只能被创建它的线程调用 */
+	class ThreadRecorder {
+	public:
+		explicit ThreadRecorder(size_t capacity) : m_ring(capacity), m_dropped(0) {}
+
+		void BeginPass(uint32_t frame, uint32_t pass, QueueIdx queue, uint32_t name, uint64_t timestamp) {
+			push({ timestamp, frame, pass, 0, name, 0, static_cast<uint16_t>(queue), RecordEvent::PASS_BEGIN, 0 });
+		}
+		void EndPass(uint32_t frame, uint32_t pass, uint64_t timestamp) {
+			push({ timestamp, frame, pass, 0, 0, 0, 0, RecordEvent::PASS_END, 0 });
+		}
+		/** waitPass需要等待signalPass完成 */
+		void Fence(uint32_t frame, uint32_t signalPass, uint32_t waitPass) {
+			push({ 0, frame, waitPass, signalPass, 0, 0, 0, RecordEvent::FENCE, 0 });
+		}
+		void Read(uint32_t frame, uint32_t resource, uint32_t name, uint32_t pass) {
+			push({ 0, frame, pass, resource, name, 0, 0, RecordEvent::READ, 0 });
+		}
+		void Write(uint32_t frame, uint32_t resource, uint32_t name, uint32_t pass) {
+			push({ 0, frame, pass, resource, name, 0, 0, RecordEvent::WRITE, 0 });
+		}
+		void Create(uint32_t frame, uint32_t resource, uint32_t name, uint32_t pass) {
+			push({ 0, frame, pass, resource, name, 0, 0, RecordEvent::CREATE, 0 });
+		}
+		void Destroy(uint32_t frame, uint32_t resource, uint32_t name, uint32_t pass) {
+			push({ 0, frame, pass, resource, name, 0, 0, RecordEvent::DESTROY, 0 });
+		}
+		void AddBarrier(uint32_t frame, uint32_t resource, uint32_t name, uint32_t pass,
+			uint32_t desc, uint8_t flags) {
+			push({ 0, frame, pass, resource, name, desc, 0, RecordEvent::BARRIER, flags });
+		}
+		/** 记录资源占用的内存，不属于任何pass，参数见FrameGraphBuilder::SetMemory */
+		void SetMemory(uint32_t frame, uint32_t resource, uint32_t name, uint64_t size,
+			uint32_t alignment = 0, uint8_t heapType = HEAP_DEFAULT) {
+			push({ size, frame, 0, resource, name, alignment, 0, RecordEvent::MEMORY, heapType });
+		}
+		/** 标记某一帧结束
+		 * @remark 调用前必须保证所有线程已经记录完该帧的事件；帧需要按编号从小到大结束 */
+		void EndFrame(uint32_t frame) {
+			push({ 0, frame, 0, 0, 0, 0, 0, RecordEvent::FRAME_END, 0 });
+		}
+		/** 因缓冲已满而丢弃的事件数量 */
+		uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+		/** 由消费线程调用 */
+		bool Pop(RecordEvent& event) { return m_ring.TryPop(event); }
+	private:
+		void push(const RecordEvent& event) {
+			if (!m_ring.TryPush(event))
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	private:
+		SpscRing<RecordEvent> m_ring;
+		std::atomic<uint64_t> m_dropped;
+	};
+
+	class Recorder {
+	public:
+		/** @param ringCapacity 每个记录线程的缓冲能容纳的事件数量 */
+		explicit Recorder(size_t ringCapacity = 1 << 16);
+		~Recorder();
+		Recorder(const Recorder&) = delete;
+		Recorder& operator=(const Recorder&) = delete;
+
+		/** 注册一个名称，返回其编号，可在任意线程调用，应在初始化阶段完成 */
+		uint32_t RegisterName(const char* name);
+		/** 为当前线程创建记录器，记录器的生命周期与Recorder相同 */
+		ThreadRecorder* CreateThreadRecorder();
+
+		/** 收集所有记录器中的事件，由消费线程调用
+		 * @remark 本次收集过程中才读到结束事件的帧要到下一次Drain才能取出 */
+		void Drain();
+		/** 取出下一个已经结束的帧，由消费线程调用
+		 * @param graph 用于接收该帧的图，图中原有的内容会被替换
+		 * @param frame 该帧的编号
+		 * @return 是否取出了一帧
+		 * @remark 取出后需要调用graph的Setup */
+		bool NextFrame(PipelineGraph& graph, uint32_t& frame);
+		/** 启动消费线程，每当一帧结束时调用onFrame */
+		void StartConsumer(std::function<void(PipelineGraph&, uint32_t)> onFrame);
+		/** 停止消费线程，剩余的事件会被处理完 */
+		void StopConsumer();
+
+		/** 所有记录器因缓冲已满而丢弃的事件数量 */
+		uint64_t DroppedEvents() const;
+		/** 组装帧时因引用了未记录的pass而忽略的事件数量 */
+		uint64_t OrphanEvents() const { return m_orphanEvents; }
+		/** 所属的帧已经结束后才收到而被丢弃的事件数量，包括编号更大的帧结束时仍未结束的帧中的事件 */
+		uint64_t LateEvents() const { return m_lateEvents; }
+	private:
+		/** 将某一帧的事件组装成图 */
+		bool buildFrame(const std::vector<RecordEvent>& events, PipelineGraph& graph);
+	private:
+		size_t m_ringCapacity;
+		mutable std::mutex m_mutex; /**< 保护名称与记录器列表 */
+		std::vector<std::string> m_names;
+		std::vector< std::unique_ptr<ThreadRecorder> > m_threads;
+
+		/** 以下成员只由消费线程访问 */
+		std::vector<ThreadRecorder*> m_drainList; /**< Drain时记录器列表的快照 */
+		std::map< uint32_t, std::vector<RecordEvent> > m_pendingFrames; /**< 尚未结束的帧 */
+		std::map< uint32_t, std::vector<RecordEvent> > m_endedFrames; /**< 已经结束等待取出的帧 */
+		std::vector<uint32_t> m_frameEnds; /**< 已经读到但还没有经过一次完整收集的帧结束事件 */
+		FrameGraphBuilder m_builder;
+		std::vector<std::string> m_nameSnapshot; /**< 组装帧时使用的名称 */
+		uint64_t m_orphanEvents;
+		uint64_t m_lateEvents;
+		uint32_t m_lastEndedFrame; /**< 已经结束的帧中最大的编号，m_anyFrameEnded为true时有效 */
+		bool m_anyFrameEnded;
+
+		std::thread m_consumer;
+		std::atomic<bool> m_running;
+	};
+
+}
+
+#endif // RECORDER_H
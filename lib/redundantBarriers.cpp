@@ -0,0 +1,142 @@
+#include "redundantBarriers.h"
+#include "passOrder.h"
+#include "resourceState.h"
+#include <algorithm>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 资源上的一个访问或者barrier */
+		struct ResourceEvent {
+			uint64_t order; /**< 拓扑序中的位置乘以3，再加上在pass中的位置: 0为pass之前的barrier，1为访问，2为pass之后的barrier */
+			uint32_t index; /**< barrier在Resource::barriers中的索引，或者访问的状态 */
+			bool barrier;
+			bool write;
+			bool hasState; /**< 访问是否记录了状态 */
+		};
+
+		const BarrierRef NO_BARRIER = { INVALID_INDEX, INVALID_INDEX };
+
+		bool hasStates(const Barrier& barrier) {
+			return (barrier.flags & Barrier::TRANSITION_BARRIER)
+				&& (barrier.stateBefore != STATE_COMMON || barrier.stateAfter != STATE_COMMON);
+		}
+
+	}
+
+	bool FindRedundantBarriers(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		RedundantBarrierReport& report, std::string* error)
+	{
+		report.barriers.clear();
+		report.totalBarriers = 0;
+		report.removableBarriers = 0;
+		PassIndex index(passMap);
+		std::vector<uint32_t> order;
+		if (!TopologicalOrder(passMap, index, order, error)) return false;
+		std::vector<uint32_t> ranks(order.size());
+		for (uint32_t rank = 0; rank < order.size(); ++rank)
+			ranks[order[rank]] = rank;
+
+		std::vector<ResourceEvent> events;
+		std::vector<uint32_t> pendingUavs; /**< 之前没有写入，需要根据下一次访问判断的UAV_BARRIER */
+		for (ResourceIdx resIdx = 0; resIdx < resMap.size(); ++resIdx) {
+			const Resource& resource = resMap[resIdx];
+			report.totalBarriers += resource.barriers.size();
+			events.clear();
+			bool valid = true;
+			auto position = [&](const PassLocate& pass, uint64_t phase) {
+				valid = valid && index.Contains(pass);
+				return valid ? static_cast<uint64_t>(ranks[index.ToId(pass)]) * 3 + phase : 0;
+			};
+			for (size_t readIdx = 0; readIdx < resource.readPasses.size(); ++readIdx)
+				events.push_back({ position(resource.readPasses[readIdx], 1), resource.GetReadState(readIdx),
+					false, false, !resource.readStates.empty() });
+			for (size_t writeIdx = 0; writeIdx < resource.writedPasses.size(); ++writeIdx)
+				events.push_back({ position(resource.writedPasses[writeIdx], 1), resource.GetWriteState(writeIdx),
+					false, true, !resource.writeStates.empty() });
+			for (uint32_t barrierIdx = 0; barrierIdx < resource.barriers.size(); ++barrierIdx) {
+				const Barrier& barrier = resource.barriers[barrierIdx];
+				events.push_back({ position(barrier.submitPass, (barrier.flags & Barrier::BEGIN) ? 2 : 0),
+					barrierIdx, true, false, false });
+			}
+			if (!valid) {
+				if (error) *error = "resource " + resource.name + " refers to an unknown pass";
+				return false;
+			}
+			std::stable_sort(events.begin(), events.end(), [](const ResourceEvent& lhs, const ResourceEvent& rhs) {
+				return lhs.order < rhs.order;
+			});
+
+			auto flag = [&](uint32_t barrierIdx, uint32_t relatedIdx, RedundantBarrier::Reason reason) {
+				BarrierRef related = relatedIdx == INVALID_INDEX ? NO_BARRIER : BarrierRef{ resIdx, relatedIdx };
+				report.barriers.push_back({ { resIdx, barrierIdx }, related, reason });
+				report.removableBarriers += reason == RedundantBarrier::CANCELLING_PAIR ? 2 : 1;
+			};
+			bool stateKnown = false;
+			uint16_t state = STATE_COMMON;
+			uint32_t lastTransition = INVALID_INDEX; /**< 之后还没有访问的上一次切换 */
+			bool writeSinceSync = false; /**< 上一个barrier之后是否有写入 */
+			pendingUavs.clear();
+			for (const ResourceEvent& event : events) {
+				if (!event.barrier) {
+					for (uint32_t uav : pendingUavs)
+						if (!event.write) flag(uav, INVALID_INDEX, RedundantBarrier::UAV_WITHOUT_WRITE);
+					pendingUavs.clear();
+					lastTransition = INVALID_INDEX;
+					writeSinceSync = writeSinceSync || event.write;
+					if (event.hasState) {
+						/** 连续的只读访问使用组合后的状态 */
+						bool combine = !event.write && stateKnown && ((state | event.index) & ~READ_ONLY_STATES) == 0;
+						state = combine ? static_cast<uint16_t>(state | event.index) : static_cast<uint16_t>(event.index);
+						stateKnown = true;
+					}
+					continue;
+				}
+				const Barrier& barrier = resource.barriers[event.index];
+				if (barrier.flags & Barrier::UAV_BARRIER) {
+					if (!writeSinceSync) pendingUavs.push_back(event.index);
+					writeSinceSync = false;
+				}
+				/** split barrier的END只是完成BEGIN开始的切换 */
+				if (!hasStates(barrier) || (barrier.flags & Barrier::END)) continue;
+				writeSinceSync = false;
+				if (barrier.stateBefore == barrier.stateAfter || (stateKnown && state == barrier.stateAfter)) {
+					flag(event.index, INVALID_INDEX, RedundantBarrier::NO_OP_TRANSITION);
+					continue;
+				}
+				if (lastTransition != INVALID_INDEX) {
+					bool cancelling = resource.barriers[lastTransition].stateBefore == barrier.stateAfter;
+					flag(event.index, lastTransition,
+						cancelling ? RedundantBarrier::CANCELLING_PAIR : RedundantBarrier::BACK_TO_BACK);
+					state = barrier.stateAfter;
+					stateKnown = true;
+					/** 合并后的切换可以继续与之后的切换合并，抵消后则不再存在 */
+					if (cancelling) lastTransition = INVALID_INDEX;
+					continue;
+				}
+				state = barrier.stateAfter;
+				stateKnown = true;
+				lastTransition = event.index;
+			}
+			/** 之后没有任何访问的UAV_BARRIER同样没有作用 */
+			for (uint32_t uav : pendingUavs)
+				flag(uav, INVALID_INDEX, RedundantBarrier::UAV_WITHOUT_WRITE);
+		}
+		return true;
+	}
+
+	void HighlightRedundantBarriers(PipelineGraph& graph, const RedundantBarrierReport& report)
+	{
+		static const char* REASON_NAMES[] = {
+			"no-op transition", "UAV barrier without write", "cancelling transition", "back-to-back transition" };
+		const auto& resMap = graph.GetResourceMap();
+		for (const auto& redundant : report.barriers) {
+			const Resource& resource = resMap[redundant.barrier.resource];
+			const Barrier& barrier = resource.barriers[redundant.barrier.barrierIndex];
+			graph.MarkPass(barrier.submitPass, Rectangle::HIGHLIGHT,
+				std::string(REASON_NAMES[redundant.reason]) + " on " + resource.name + ": " + barrier.description);
+		}
+	}
+
+}
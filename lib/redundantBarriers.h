@@ -0,0 +1,44 @@
+#ifndef REDUNDANT_BARRIERS_H
+#define REDUNDANT_BARRIERS_H
+
+#include "ppfg.h"
+
+/** 找出可以去掉的barrier
+ * 每个资源的barrier与访问按pass的拓扑序排列，同一个pass上带BEGIN的barrier位于访问之后，其余barrier位于访问之前；
+ * 沿着这个顺序跟踪资源的状态，只检查记录了切换前后状态的TRANSITION_BARRIER(COMMON -> COMMON视为没有记录)，
+ * split barrier只检查BEGIN的一半 */
+namespace PipelineProfilingGraph {
+
+	struct RedundantBarrier {
+		enum Reason : uint8_t {
+			NO_OP_TRANSITION, /**< 切换前后状态相同，或者资源已经处于切换后的状态 */
+			UAV_WITHOUT_WRITE, /**< UAV_BARRIER前后都没有写入 */
+			CANCELLING_PAIR, /**< 与related之间没有访问，并且切换回related之前的状态，两个barrier都可以去掉 */
+			BACK_TO_BACK, /**< 与related之间没有访问，两次切换可以合并为一次 */
+		};
+		BarrierRef barrier; /**< 可以去掉的barrier */
+		BarrierRef related; /**< CANCELLING_PAIR与BACK_TO_BACK中的前一次切换，否则resource为INVALID_INDEX */
+		Reason reason;
+	};
+
+	struct RedundantBarrierReport {
+		std::vector<RedundantBarrier> barriers; /**< 找到的barrier，按资源排列 */
+		size_t totalBarriers; /**< 图中barrier的数量 */
+		size_t removableBarriers; /**< 可以去掉的barrier的数量，每个barrier估计为一次GPU flush */
+	};
+
+	/** 检查所有资源的barrier
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源
+	 * @param report 检查的结果
+	 * @param error 失败时的错误信息，可以为空
+	 * @return 图中引用了未知的pass或者fence之间存在环时返回false */
+	bool FindRedundantBarriers(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		RedundantBarrierReport& report, std::string* error = nullptr);
+	/** 突出显示提交了可以去掉的barrier的pass，并在其描述中说明原因
+	 * @remark 调用该函数前，必须保证graph的Setup被调用 */
+	void HighlightRedundantBarriers(PipelineGraph& graph, const RedundantBarrierReport& report);
+
+}
+
+#endif // REDUNDANT_BARRIERS_H
@@ -0,0 +1,269 @@
+#include "regressionGate.h"
+#include "jsonReader.h"
+#include "queueOverlap.h"
+#include <cstdio>
+#include <unordered_map>
+
+namespace PipelineProfilingGraph {
+
+	namespace {
+
+		/** 读取基线文件，未知的字段会被忽略，版本必须与GATE_BASELINE_VERSION相同 */
+		class BaselineParser {
+		public:
+			BaselineParser(char* buffer, size_t size, GateMetrics& metrics)
+				: m_reader(buffer, size), m_metrics(metrics) {}
+
+			bool Parse() {
+				if (m_reader.Next() != JsonReader::BEGIN_OBJECT) return fail("expect an object");
+				bool hasVersion = false;
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_OBJECT) return hasVersion || fail("baseline has no version");
+					if (token != JsonReader::STRING) return fail("expect a key");
+					if (m_reader.StringEquals("version")) {
+						uint64_t version = 0;
+						if (!parseNumber(version)) return false;
+						if (version != GATE_BASELINE_VERSION) return fail("unsupported baseline version");
+						hasVersion = true;
+					}
+					else if (m_reader.StringEquals("frame")) {
+						if (!parseNumber(m_metrics.frameTime)) return false;
+					}
+					else if (m_reader.StringEquals("barriers")) {
+						if (!parseNumber(m_metrics.barrierCount)) return false;
+					}
+					else if (m_reader.StringEquals("fences")) {
+						if (!parseNumber(m_metrics.fenceCount)) return false;
+					}
+					else if (m_reader.StringEquals("queues")) {
+						if (!parseQueues()) return false;
+					}
+					else if (m_reader.StringEquals("passes")) {
+						if (!parsePasses()) return false;
+					}
+					else if (!m_reader.SkipValue(m_reader.Next())) {
+						return fail("invalid value");
+					}
+				}
+			}
+			const std::string& Error() const { return m_error; }
+		private:
+			bool fail(const char* reason) {
+				m_error = std::string(reason) + " at line " + std::to_string(m_reader.Line())
+					+ " (offset " + std::to_string(m_reader.Offset()) + ")";
+				return false;
+			}
+			bool parseNumber(uint64_t& value) {
+				if (m_reader.Next() != JsonReader::NUMBER || !m_reader.IsUInt()) return fail("expect a non-negative integer");
+				value = m_reader.UInt();
+				return true;
+			}
+			bool parseQueues() {
+				if (m_reader.Next() != JsonReader::BEGIN_ARRAY) return fail("expect an array of queue times");
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::NUMBER || !m_reader.IsUInt()) return fail("expect a queue time");
+					m_metrics.queueBusyTimes.push_back(m_reader.UInt());
+				}
+			}
+			bool parsePasses() {
+				if (m_reader.Next() != JsonReader::BEGIN_ARRAY) return fail("expect an array of passes");
+				while (true) {
+					JsonReader::Token token = m_reader.Next();
+					if (token == JsonReader::END_ARRAY) return true;
+					if (token != JsonReader::BEGIN_OBJECT) return fail("expect a pass");
+					std::pair<std::string, uint64_t> pass("", 0);
+					bool hasName = false, hasTime = false;
+					while (true) {
+						token = m_reader.Next();
+						if (token == JsonReader::END_OBJECT) break;
+						if (token != JsonReader::STRING) return fail("expect a key");
+						if (m_reader.StringEquals("name")) {
+							if (m_reader.Next() != JsonReader::STRING) return fail("expect a pass name");
+							pass.first.assign(m_reader.String(), m_reader.StringSize());
+							hasName = true;
+						}
+						else if (m_reader.StringEquals("time")) {
+							if (!parseNumber(pass.second)) return false;
+							hasTime = true;
+						}
+						else if (!m_reader.SkipValue(m_reader.Next())) {
+							return fail("invalid value");
+						}
+					}
+					if (!hasName || !hasTime) return fail("pass needs a name and a time");
+					m_metrics.passTimes.push_back(pass);
+				}
+			}
+		private:
+			JsonReader m_reader;
+			GateMetrics& m_metrics;
+			std::string m_error;
+		};
+
+		void writeCount(std::FILE* file, const char* key, const GateCheck& check) {
+			std::fprintf(file, "  \"%s\": { \"baseline\": %llu, \"current\": %llu },\n", key,
+				static_cast<unsigned long long>(check.baseline), static_cast<unsigned long long>(check.current));
+		}
+
+		void writeNames(std::FILE* file, const std::vector<std::string>& names) {
+			for (size_t index = 0; index < names.size(); ++index)
+				std::fprintf(file, "%s\"%s\"", index ? ", " : "", EscapeJson(names[index]).c_str());
+		}
+
+	}
+
+	void CollectGateMetrics(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		GateMetrics& metrics)
+	{
+		metrics = GateMetrics();
+		std::unordered_map<std::string, uint32_t> occurrences;
+		for (const auto& queue : passMap) {
+			for (const auto& pass : queue) {
+				metrics.fenceCount += pass.depPasses.size();
+				if (!pass.HasTiming()) continue;
+				uint32_t occurrence = occurrences[pass.name]++;
+				metrics.passTimes.push_back(std::make_pair(
+					occurrence ? pass.name + "#" + std::to_string(occurrence) : pass.name, pass.endTime - pass.startTime));
+			}
+		}
+		for (const auto& resource : resMap)
+			metrics.barrierCount += resource.barriers.size();
+		QueueOverlapMetrics overlap;
+		MeasureQueueOverlap(passMap, overlap);
+		metrics.queueBusyTimes = overlap.busyTime;
+		metrics.frameTime = overlap.Span();
+	}
+
+	bool SaveGateBaseline(const char* path, const GateMetrics& metrics)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file) return false;
+		std::fprintf(file, "{\n  \"version\": %u,\n  \"frame\": %llu,\n  \"barriers\": %llu,\n  \"fences\": %llu,\n  \"queues\": [",
+			GATE_BASELINE_VERSION, static_cast<unsigned long long>(metrics.frameTime), static_cast<unsigned long long>(metrics.barrierCount),
+			static_cast<unsigned long long>(metrics.fenceCount));
+		for (size_t queIdx = 0; queIdx < metrics.queueBusyTimes.size(); ++queIdx)
+			std::fprintf(file, "%s%llu", queIdx ? ", " : "", static_cast<unsigned long long>(metrics.queueBusyTimes[queIdx]));
+		std::fprintf(file, "],\n  \"passes\": [");
+		for (size_t index = 0; index < metrics.passTimes.size(); ++index) {
+			std::fprintf(file, "%s\n    { \"name\": \"%s\", \"time\": %llu }", index ? "," : "",
+				EscapeJson(metrics.passTimes[index].first).c_str(),
+				static_cast<unsigned long long>(metrics.passTimes[index].second));
+		}
+		std::fprintf(file, " ]\n}\n");
+		bool succeed = std::ferror(file) == 0;
+		return std::fclose(file) == 0 && succeed;
+	}
+
+	bool LoadGateBaseline(const char* path, GateMetrics& metrics, std::string* error)
+	{
+		std::FILE* file = std::fopen(path, "rb");
+		if (!file) {
+			if (error) *error = std::string("cannot open ") + path;
+			return false;
+		}
+		std::fseek(file, 0, SEEK_END);
+		long size = std::ftell(file);
+		std::fseek(file, 0, SEEK_SET);
+		std::vector<char> buffer(size > 0 ? static_cast<size_t>(size) + 1 : 1, '\0');
+		size_t readSize = size > 0 ? std::fread(buffer.data(), 1, static_cast<size_t>(size), file) : 0;
+		std::fclose(file);
+		if (size < 0 || readSize != static_cast<size_t>(size)) {
+			if (error) *error = std::string("cannot read ") + path;
+			return false;
+		}
+		metrics = GateMetrics();
+		BaselineParser parser(buffer.data(), readSize, metrics);
+		if (parser.Parse()) return true;
+		if (error) *error = std::string(path) + ": " + parser.Error();
+		return false;
+	}
+
+	void CheckRegressions(const GateMetrics& baseline, const GateMetrics& current,
+		const GateThresholds& thresholds, GateReport& report)
+	{
+		report = GateReport();
+		auto checkTime = [&](GateCheck::Kind kind, const std::string& name, uint64_t before, uint64_t after) {
+			uint64_t increase = after > before ? after - before : 0;
+			bool regressed = increase > thresholds.absolute
+				&& static_cast<double>(increase) > static_cast<double>(before) * thresholds.relative;
+			report.checks.push_back({ kind, name, before, after, regressed });
+			report.regressions += regressed;
+		};
+		auto checkCount = [&](GateCheck::Kind kind, uint64_t before, uint64_t after) {
+			bool regressed = after > before + thresholds.countIncrease;
+			report.checks.push_back({ kind, std::string(), before, after, regressed });
+			report.regressions += regressed;
+		};
+		checkTime(GateCheck::FRAME_TIME, std::string(), baseline.frameTime, current.frameTime);
+		/** 没有计时的图所有时间都是0，不会被视为回归，需要单独报告 */
+		report.missingTiming = !baseline.passTimes.empty() && current.passTimes.empty();
+		for (size_t queIdx = 0; queIdx < baseline.queueBusyTimes.size(); ++queIdx) {
+			if (queIdx >= current.queueBusyTimes.size()) {
+				report.missingQueues.push_back(static_cast<QueueIdx>(queIdx));
+				continue;
+			}
+			checkTime(GateCheck::QUEUE_TIME, std::to_string(queIdx), baseline.queueBusyTimes[queIdx], current.queueBusyTimes[queIdx]);
+		}
+		checkCount(GateCheck::BARRIER_COUNT, baseline.barrierCount, current.barrierCount);
+		checkCount(GateCheck::FENCE_COUNT, baseline.fenceCount, current.fenceCount);
+
+		std::unordered_map<std::string, size_t> baselinePasses;
+		for (size_t index = 0; index < baseline.passTimes.size(); ++index)
+			baselinePasses.insert(std::make_pair(baseline.passTimes[index].first, index));
+		std::vector<uint8_t> matched(baseline.passTimes.size(), 0);
+		for (const auto& pass : current.passTimes) {
+			auto found = baselinePasses.find(pass.first);
+			if (found == baselinePasses.end()) {
+				report.newPasses.push_back(pass.first);
+				continue;
+			}
+			matched[found->second] = 1;
+			checkTime(GateCheck::PASS_TIME, pass.first, baseline.passTimes[found->second].second, pass.second);
+		}
+		for (size_t index = 0; index < baseline.passTimes.size(); ++index)
+			if (!matched[index]) report.missingPasses.push_back(baseline.passTimes[index].first);
+		if (!thresholds.allowMissing)
+			report.missing = report.missingPasses.size() + report.missingQueues.size() + (report.missingTiming ? 1 : 0);
+	}
+
+	bool SaveGateReport(const char* path, const GateReport& report, const GateThresholds& thresholds)
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		if (!file) return false;
+		std::fprintf(file, "{\n  \"passed\": %s,\n  \"regressions\": %llu,\n  \"missingCount\": %llu,\n",
+			report.Passed() ? "true" : "false", static_cast<unsigned long long>(report.regressions),
+			static_cast<unsigned long long>(report.missing));
+		std::fprintf(file, "  \"thresholds\": { \"relative\": %.6f, \"absolute\": %llu, \"count\": %llu },\n",
+			thresholds.relative, static_cast<unsigned long long>(thresholds.absolute),
+			static_cast<unsigned long long>(thresholds.countIncrease));
+		for (const auto& check : report.checks) {
+			if (check.kind == GateCheck::FRAME_TIME || check.kind == GateCheck::BARRIER_COUNT
+				|| check.kind == GateCheck::FENCE_COUNT)
+				writeCount(file, GATE_CHECK_NAMES[check.kind], check);
+		}
+		std::fprintf(file, "  \"regressed\": [");
+		bool firstEntry = true;
+		for (const auto& check : report.checks) {
+			if (!check.regressed) continue;
+			std::fprintf(file, "%s\n    { \"kind\": \"%s\", \"name\": \"%s\", \"baseline\": %llu, \"current\": %llu }",
+				firstEntry ? "" : ",", GATE_CHECK_NAMES[check.kind], EscapeJson(check.name).c_str(),
+				static_cast<unsigned long long>(check.baseline), static_cast<unsigned long long>(check.current));
+			firstEntry = false;
+		}
+		std::fprintf(file, " ],\n  \"missing\": [");
+		writeNames(file, report.missingPasses);
+		std::fprintf(file, "],\n  \"new\": [");
+		writeNames(file, report.newPasses);
+		std::fprintf(file, "],\n  \"missingQueues\": [");
+		for (size_t index = 0; index < report.missingQueues.size(); ++index)
+			std::fprintf(file, "%s%u", index ? ", " : "", static_cast<unsigned>(report.missingQueues[index]));
+		std::fprintf(file, "],\n  \"missingTiming\": %s,\n  \"allowMissing\": %s\n}\n",
+			report.missingTiming ? "true" : "false", thresholds.allowMissing ? "true" : "false");
+		bool succeed = std::ferror(file) == 0;
+		return std::fclose(file) == 0 && succeed;
+	}
+
+}
@@ -0,0 +1,91 @@
+#ifndef REGRESSION_GATE_H
+#define REGRESSION_GATE_H
+
+#include "ppfg.h"
+
+/** 性能回归检查: 把一帧的计时与计数保存为基线，之后的图与基线比较，超出阈值即为回归
+ * 计时包括每个pass的持续时间、每个queue的忙碌时间(见MeasureQueueOverlap)以及整帧的时间跨度，只使用记录了时间的pass；
+ * pass按名称匹配，同名的pass按出现顺序在名称后加上"#序号"区分；计数为barrier与fence的数量 */
+namespace PipelineProfilingGraph {
+
+	struct GateMetrics {
+		GateMetrics() : frameTime(0), barrierCount(0), fenceCount(0) {}
+		std::vector< std::pair<std::string, uint64_t> > passTimes; /**< 每个记录了时间的pass的名称与持续时间，按queue以及queue内的索引排列 */
+		std::vector<uint64_t> queueBusyTimes; /**< 每个queue的忙碌时间 */
+		uint64_t frameTime; /**< 最早的开始时间到最晚的结束时间 */
+		uint64_t barrierCount;
+		uint64_t fenceCount;
+	};
+
+	/** 计时同时超过absolute与relative时才视为回归，避免很短的pass因为噪声而误报 */
+	struct GateThresholds {
+		GateThresholds() : relative(0.05), absolute(50000), countIncrease(0), allowMissing(false) {}
+		double relative; /**< 相对于基线允许增加的比例 */
+		uint64_t absolute; /**< 允许增加的纳秒数 */
+		uint64_t countIncrease; /**< barrier与fence允许增加的数量 */
+		bool allowMissing; /**< 基线中的pass、queue或者计时在当前的图中缺失时是否仍然通过 */
+	};
+
+	struct GateCheck {
+		enum Kind : uint8_t {
+			PASS_TIME,
+			QUEUE_TIME,
+			FRAME_TIME,
+			BARRIER_COUNT,
+			FENCE_COUNT,
+		};
+		Kind kind;
+		std::string name; /**< pass的名称或者queue的索引，其余为空 */
+		uint64_t baseline;
+		uint64_t current;
+		bool regressed;
+	};
+
+	/** 以GateCheck::Kind为索引的名称，用于输出 */
+	const char* const GATE_CHECK_NAMES[] = { "pass", "queue", "frame", "barriers", "fences" };
+
+	struct GateReport {
+		GateReport() : missingTiming(false), regressions(0), missing(0) {}
+		std::vector<GateCheck> checks; /**< 两边都存在的所有计时与计数 */
+		std::vector<std::string> missingPasses; /**< 只存在于基线中的pass */
+		std::vector<std::string> newPasses; /**< 基线中没有的pass */
+		std::vector<QueueIdx> missingQueues; /**< 只存在于基线中的queue */
+		bool missingTiming; /**< 基线中有计时而当前的图中没有任何记录了时间的pass */
+		size_t regressions; /**< 回归的检查项数量 */
+		size_t missing; /**< 导致检查失败的缺失项数量，GateThresholds::allowMissing为true时为0 */
+		bool Passed() const { return regressions == 0 && missing == 0; }
+	};
+
+	/** 从渲染图中统计基线需要的计时与计数
+	 * @param passMap 渲染图中所有的pass
+	 * @param resMap 渲染图中所有的资源 */
+	void CollectGateMetrics(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap,
+		GateMetrics& metrics);
+
+	/** 基线文件的版本 */
+	const uint32_t GATE_BASELINE_VERSION = 1;
+
+	/** 将统计结果保存为基线文件
+	 * 格式: { "version": GATE_BASELINE_VERSION, "frame": 纳秒数, "barriers": 数量, "fences": 数量, "queues": [纳秒数],
+	 *         "passes": [ { "name": "G-Buffer", "time": 纳秒数 } ] }
+	 * @return 是否写入成功 */
+	bool SaveGateBaseline(const char* path, const GateMetrics& metrics);
+	/** 读取SaveGateBaseline写入的基线文件，版本不是GATE_BASELINE_VERSION时失败
+	 * @param error 失败时的错误信息，可以为空 */
+	bool LoadGateBaseline(const char* path, GateMetrics& metrics, std::string* error = nullptr);
+	/** 将当前的统计结果与基线比较，除非thresholds.allowMissing，基线中的pass、queue或者计时缺失时检查失败
+	 * @param report 比较的结果 */
+	void CheckRegressions(const GateMetrics& baseline, const GateMetrics& current,
+		const GateThresholds& thresholds, GateReport& report);
+	/** 将比较结果写成JSON文件，只列出回归的检查项以及整帧的计时与计数
+	 * 格式: { "passed": false, "regressions": 数量, "missingCount": 导致失败的缺失项数量,
+	 *         "thresholds": { "relative": 比例, "absolute": 纳秒数, "count": 数量 },
+	 *         "frame": { "baseline": 纳秒数, "current": 纳秒数 }, "barriers": { ... }, "fences": { ... },
+	 *         "regressed": [ { "kind": "pass", "name": "G-Buffer", "baseline": 纳秒数, "current": 纳秒数 } ],
+	 *         "missing": [名称], "new": [名称], "missingQueues": [索引], "missingTiming": false, "allowMissing": false }
+	 * @return 是否写入成功 */
+	bool SaveGateReport(const char* path, const GateReport& report, const GateThresholds& thresholds);
+
+}
+
+#endif // REGRESSION_GATE_H
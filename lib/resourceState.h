@@ -0,0 +1,61 @@
+#ifndef RESOURCE_STATE_H
+#define RESOURCE_STATE_H
+
+#include "ppfg.h"
+#include <cstring>
+
+/** 资源状态以及堆类型与名称之间的转换 */
+namespace PipelineProfilingGraph {
+
+	struct ResourceStateName {
+		const char* name;
+		uint16_t state;
+	};
+	const ResourceStateName RESOURCE_STATE_NAMES[] = {
+		{ "VERTEX_AND_CONSTANT_BUFFER", STATE_VERTEX_AND_CONSTANT_BUFFER },
+		{ "INDEX_BUFFER", STATE_INDEX_BUFFER },
+		{ "RENDER_TARGET", STATE_RENDER_TARGET },
+		{ "UNORDERED_ACCESS", STATE_UNORDERED_ACCESS },
+		{ "DEPTH_WRITE", STATE_DEPTH_WRITE },
+		{ "DEPTH_READ", STATE_DEPTH_READ },
+		{ "SHADER_RESOURCE", STATE_SHADER_RESOURCE },
+		{ "INDIRECT_ARGUMENT", STATE_INDIRECT_ARGUMENT },
+		{ "COPY_DEST", STATE_COPY_DEST },
+		{ "COPY_SOURCE", STATE_COPY_SOURCE },
+		{ "PRESENT", STATE_PRESENT },
+	};
+
+	/** 以HeapType为索引的堆名称 */
+	const char* const HEAP_TYPE_NAMES[HEAP_TYPE_COUNT] = { "DEFAULT", "UPLOAD", "READBACK" };
+
+	/** 根据名称查找单个状态，"COMMON"对应STATE_COMMON
+	 * @return 是否找到 */
+	inline bool FindResourceState(const char* name, size_t length, uint16_t& state) {
+		if (length == 6 && std::strncmp(name, "COMMON", 6) == 0) {
+			state = STATE_COMMON;
+			return true;
+		}
+		for (const auto& stateName : RESOURCE_STATE_NAMES) {
+			if (std::strlen(stateName.name) == length && std::strncmp(stateName.name, name, length) == 0) {
+				state = stateName.state;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** 将状态(可以是多个只读状态的组合)转换成以'|'分隔的名称 */
+	inline std::string DescribeResourceStates(uint16_t states) {
+		if (states == STATE_COMMON) return "COMMON";
+		std::string desc;
+		for (const auto& stateName : RESOURCE_STATE_NAMES) {
+			if ((states & stateName.state) == 0) continue;
+			if (!desc.empty()) desc.push_back('|');
+			desc.append(stateName.name);
+		}
+		return desc;
+	}
+
+}
+
+#endif // RESOURCE_STATE_H
@@ -0,0 +1,256 @@
+#include "shmTransport.h"
+#include <cstring>
+#include <new>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PipelineProfilingGraph {
+
+	static_assert(sizeof(ShmHeader) == CACHE_LINE_SIZE * 3, "unexpected ShmHeader layout");
+	static_assert(sizeof(ShmSlot) == 16, "unexpected ShmSlot layout");
+
+	namespace {
+		/** 槽的大小，保证每个capture按8字节对齐 */
+		uint64_t slotStride(uint32_t slotSize) {
+			return (sizeof(ShmSlot) + static_cast<uint64_t>(slotSize) + 7) & ~static_cast<uint64_t>(7);
+		}
+		ShmSlot* slotAt(ShmHeader* header, uint64_t index) {
+			uint8_t* slots = reinterpret_cast<uint8_t*>(header) + sizeof(ShmHeader);
+			return reinterpret_cast<ShmSlot*>(slots + (index % header->slotCount) * slotStride(header->slotSize));
+		}
+	}
+
+	SharedMemory::SharedMemory() : m_data(nullptr), m_size(0)
+#ifdef _WIN32
+		, m_mapping(nullptr)
+#endif
+	{}
+
+	SharedMemory::~SharedMemory() {
+		Close();
+	}
+
+#ifdef _WIN32
+	bool SharedMemory::Create(const char* name, size_t size) {
+		Close();
+		uint64_t size64 = size;
+		m_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xFFFFFFFFU), name);
+		if (!m_mapping) return false;
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (!m_data) {
+			Close();
+			return false;
+		}
+		m_size = size;
+		return true;
+	}
+
+	bool SharedMemory::Open(const char* name) {
+		Close();
+		m_mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+		if (!m_mapping) return false;
+		m_data = MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		MEMORY_BASIC_INFORMATION info;
+		if (!m_data || VirtualQuery(m_data, &info, sizeof(info)) == 0) {
+			Close();
+			return false;
+		}
+		m_size = info.RegionSize;
+		return true;
+	}
+
+	void SharedMemory::Close() {
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_size = 0;
+		m_name.clear();
+	}
+#else
+	bool SharedMemory::Create(const char* name, size_t size) {
+		Close();
+		shm_unlink(name);
+		int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) return false;
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			close(fd);
+			shm_unlink(name);
+			return false;
+		}
+		void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			shm_unlink(name);
+			return false;
+		}
+		m_data = data;
+		m_size = size;
+		m_name = name;
+		return true;
+	}
+
+	bool SharedMemory::Open(const char* name) {
+		Close();
+		int fd = shm_open(name, O_RDWR, 0600);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close(fd);
+			return false;
+		}
+		void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) return false;
+		m_data = data;
+		m_size = static_cast<size_t>(info.st_size);
+		return true;
+	}
+
+	void SharedMemory::Close() {
+		if (m_data) munmap(m_data, m_size);
+		/** 已经映射了该区域的消费者不受删除名称的影响 */
+		if (!m_name.empty()) shm_unlink(m_name.c_str());
+		m_data = nullptr;
+		m_size = 0;
+		m_name.clear();
+	}
+#endif
+
+	bool ShmProducer::Create(const char* name, uint32_t slotCount, uint32_t slotSize)
+	{
+		Close();
+		if (slotCount == 0) return false;
+		size_t size = static_cast<size_t>(sizeof(ShmHeader) + slotStride(slotSize) * slotCount);
+		if (!m_memory.Create(name, size)) return false;
+		std::memset(m_memory.Data(), 0, sizeof(ShmHeader));
+		m_header = new (m_memory.Data()) ShmHeader();
+		m_header->slotCount = slotCount;
+		m_header->slotSize = slotSize;
+		m_header->writeIndex.store(0);
+		m_header->readIndex.store(0);
+		m_header->droppedFrames.store(0);
+		m_header->oversizedFrames.store(0);
+		m_header->producerClosed.store(0);
+#ifdef _WIN32
+		m_header->producerProcess = GetCurrentProcessId();
+#else
+		m_header->producerProcess = static_cast<uint32_t>(getpid());
+#endif
+		m_header->version = SHM_VERSION;
+		/** magic最后写入，消费者以此判断区域已经初始化 */
+		std::atomic_thread_fence(std::memory_order_release);
+		m_header->magic = SHM_MAGIC;
+		m_sequence = 0;
+		return true;
+	}
+
+	bool ShmProducer::Publish(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap)
+	{
+		if (!m_header) return false;
+		uint64_t sequence = m_sequence++;
+		uint64_t writeIndex = m_header->writeIndex.load(std::memory_order_relaxed);
+		/** 先检查是否有空闲的槽，避免为要丢弃的帧编码 */
+		if (writeIndex - m_header->readIndex.load(std::memory_order_acquire) >= m_header->slotCount) {
+			m_header->droppedFrames.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		SerializeCapture(passMap, resMap, m_buffer);
+		if (m_buffer.size() > m_header->slotSize) {
+			m_header->oversizedFrames.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		ShmSlot* slot = slotAt(m_header, writeIndex);
+		slot->size = m_buffer.size();
+		slot->sequence = sequence;
+		std::memcpy(slot + 1, m_buffer.data(), m_buffer.size());
+		m_header->writeIndex.store(writeIndex + 1, std::memory_order_release);
+		return true;
+	}
+
+	void ShmProducer::Close()
+	{
+		if (m_header) m_header->producerClosed.store(1, std::memory_order_release);
+		m_header = nullptr;
+		m_memory.Close();
+	}
+
+	uint64_t ShmProducer::DroppedFrames() const
+	{
+		if (!m_header) return 0;
+		return m_header->droppedFrames.load(std::memory_order_relaxed)
+			+ m_header->oversizedFrames.load(std::memory_order_relaxed);
+	}
+
+	bool ShmConsumer::Open(const char* name, std::string* error)
+	{
+		m_header = nullptr;
+		if (!m_memory.Open(name)) {
+			if (error) *error = std::string("cannot open shared memory ") + name;
+			return false;
+		}
+		ShmHeader* header = static_cast<ShmHeader*>(m_memory.Data());
+		bool valid = m_memory.Size() >= sizeof(ShmHeader) && header->magic == SHM_MAGIC;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		valid = valid && header->version == SHM_VERSION && header->slotCount != 0
+			&& m_memory.Size() >= sizeof(ShmHeader) + slotStride(header->slotSize) * header->slotCount;
+		if (!valid) {
+			if (error) *error = std::string(name) + " is not a ppfg transport";
+			m_memory.Close();
+			return false;
+		}
+		m_header = header;
+		return true;
+	}
+
+	bool ShmConsumer::Next(PipelineGraph& graph, uint64_t& sequence, std::string* error)
+	{
+		if (!m_header) return false;
+		uint64_t readIndex = m_header->readIndex.load(std::memory_order_relaxed);
+		if (readIndex == m_header->writeIndex.load(std::memory_order_acquire)) return false;
+		/** 槽在readIndex前进之前不会被生产者改写，因此可以直接在共享内存上解析 */
+		const ShmSlot* slot = slotAt(m_header, readIndex);
+		sequence = slot->sequence;
+		CaptureView view;
+		bool succeed = slot->size <= m_header->slotSize && view.Parse(slot + 1, static_cast<size_t>(slot->size), error);
+		if (succeed) {
+			view.BuildGraph(m_passMap, m_resMap);
+			graph.Reset(m_passMap, m_resMap);
+		}
+		m_header->readIndex.store(readIndex + 1, std::memory_order_release);
+		return succeed;
+	}
+
+	bool ShmConsumer::Finished() const
+	{
+		if (!m_header) return true;
+		return m_header->producerClosed.load(std::memory_order_acquire) != 0
+			&& m_header->readIndex.load(std::memory_order_relaxed)
+				== m_header->writeIndex.load(std::memory_order_acquire);
+	}
+
+	bool ShmConsumer::ProducerAlive() const
+	{
+		if (!m_header || m_header->producerProcess == 0) return true;
+#ifdef _WIN32
+		HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, m_header->producerProcess);
+		if (!process) return GetLastError() != ERROR_INVALID_PARAMETER;
+		bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		CloseHandle(process);
+		return alive;
+#else
+		/** 信号0只检查进程是否存在，没有权限时进程同样存在 */
+		return kill(static_cast<pid_t>(m_header->producerProcess), 0) == 0 || errno == EPERM;
+#endif
+	}
+
+}
@@ -0,0 +1,113 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include "capture.h"
+#include "spscRing.h"
+#include <atomic>
+
+/** 通过共享内存把渲染图从被分析的进程传给独立的ppfg进程
+ * 共享内存中是一个由定长槽组成的环形缓冲，每个槽存放一帧的capture(见capture.h)；
+ * 生产者在缓冲已满或者帧过大时直接丢弃该帧并计数，从不等待消费者
+ * 典型用法: 在Recorder::StartConsumer的回调中调用ShmProducer::Publish，
+ * 再由另一个进程执行"ppfg --shm 名称"完成布局与输出 */
+namespace PipelineProfilingGraph {
+
+	const uint32_t SHM_MAGIC = 0x4D535050U; /**< "PPSM" */
+	const uint32_t SHM_VERSION = 1;
+
+	/** 共享内存区域的头部，生产者和消费者的位置分别放在不同的cache line中 */
+	struct ShmHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount; /**< 槽的数量 */
+		uint32_t slotSize; /**< 每个槽能容纳的capture的最大字节数 */
+		uint32_t producerProcess; /**< 生产者的进程ID，用于发现未关闭就退出的生产者 */
+		char padding0[CACHE_LINE_SIZE - 20];
+		std::atomic<uint64_t> writeIndex; /**< 已经发布的帧数，只由生产者修改 */
+		std::atomic<uint64_t> droppedFrames; /**< 因缓冲已满而丢弃的帧数 */
+		std::atomic<uint64_t> oversizedFrames; /**< 因超过槽大小而丢弃的帧数 */
+		std::atomic<uint32_t> producerClosed; /**< 生产者是否已经关闭 */
+		char padding1[CACHE_LINE_SIZE - 28];
+		std::atomic<uint64_t> readIndex; /**< 已经取走的帧数，只由消费者修改 */
+		char padding2[CACHE_LINE_SIZE - 8];
+	};
+
+	/** 每个槽的头部，其后紧跟capture */
+	struct ShmSlot {
+		uint64_t size; /**< capture的大小 */
+		uint64_t sequence; /**< 该帧在生产者中的序号，包含被丢弃的帧 */
+	};
+
+	/** 一块命名的共享内存 */
+	class SharedMemory {
+	public:
+		SharedMemory();
+		~SharedMemory();
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+		/** 创建共享内存，同名的旧区域会被替换 */
+		bool Create(const char* name, size_t size);
+		/** 打开已经存在的共享内存 */
+		bool Open(const char* name);
+		void Close();
+		void* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+	private:
+		void* m_data;
+		size_t m_size;
+		std::string m_name; /**< 由Create创建时记录名称，关闭时删除 */
+#ifdef _WIN32
+		void* m_mapping;
+#endif
+	};
+
+	class ShmProducer {
+	public:
+		ShmProducer() : m_header(nullptr), m_sequence(0) {}
+		~ShmProducer() { Close(); }
+		/** 创建传输用的共享内存
+		 * @param name 共享内存的名称，POSIX下需要以'/'开头
+		 * @param slotCount 槽的数量，即消费者最多落后的帧数
+		 * @param slotSize 每帧capture的最大字节数 */
+		bool Create(const char* name, uint32_t slotCount, uint32_t slotSize);
+		/** 发布一帧，缓冲已满或者帧过大时丢弃该帧
+		 * @return 该帧是否被发布 */
+		bool Publish(const std::vector<Queue>& passMap, const std::vector<Resource>& resMap);
+		bool Publish(const PipelineGraph& graph) {
+			return Publish(graph.GetPassMap(), graph.GetResourceMap());
+		}
+		/** 通知消费者不会再有新的帧，并释放共享内存 */
+		void Close();
+		uint64_t DroppedFrames() const;
+	private:
+		SharedMemory m_memory;
+		ShmHeader* m_header;
+		std::vector<uint8_t> m_buffer; /**< 编码用的缓冲，在帧之间复用 */
+		uint64_t m_sequence;
+	};
+
+	class ShmConsumer {
+	public:
+		ShmConsumer() : m_header(nullptr) {}
+		/** 打开生产者创建的共享内存 */
+		bool Open(const char* name, std::string* error = nullptr);
+		/** 取出下一帧到graph中
+		 * @param sequence 该帧在生产者中的序号
+		 * @return 是否取出了一帧，没有新的帧时立即返回false */
+		bool Next(PipelineGraph& graph, uint64_t& sequence, std::string* error = nullptr);
+		/** 生产者是否已经关闭并且所有帧都已取出 */
+		bool Finished() const;
+		/** 生产者进程是否仍然存在，生产者崩溃或者被杀死时不会关闭共享内存，只能以此发现
+		 * @remark 无法确定时视为存在 */
+		bool ProducerAlive() const;
+		const ShmHeader& Header() const { return *m_header; }
+	private:
+		SharedMemory m_memory;
+		ShmHeader* m_header;
+		std::vector<Queue> m_passMap; /**< 与图交换的pass容器，在帧之间复用 */
+		std::vector<Resource> m_resMap; /**< 与图交换的资源容器，在帧之间复用 */
+	};
+
+}
+
+#endif // SHM_TRANSPORT_H
@@ -0,0 +1,65 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace PipelineProfilingGraph {
+
+	const size_t CACHE_LINE_SIZE = 64;
+
+	/** 单生产者单消费者的无锁环形缓冲
+	 * 生产者与消费者各自缓存对方的位置，只有在缓存的位置不够用时才读取对方的原子变量
+	 * @remark T必须可以平凡拷贝，容量会被向上取整到2的幂 */
+	template<typename T>
+	class SpscRing {
+	public:
+		explicit SpscRing(size_t capacity) : m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0) {
+			size_t size = 1;
+			while (size < capacity) size <<= 1;
+			m_buffer.resize(size);
+			m_mask = size - 1;
+		}
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		/** 由生产者调用，缓冲已满时直接返回false，不会阻塞 */
+		bool TryPush(const T& value) {
+			uint64_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_cachedTail > m_mask) {
+				m_cachedTail = m_tail.load(std::memory_order_acquire);
+				if (head - m_cachedTail > m_mask) return false;
+			}
+			m_buffer[static_cast<size_t>(head & m_mask)] = value;
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+		/** 由消费者调用，缓冲为空时返回false */
+		bool TryPop(T& value) {
+			uint64_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail == m_cachedHead) {
+				m_cachedHead = m_head.load(std::memory_order_acquire);
+				if (tail == m_cachedHead) return false;
+			}
+			value = m_buffer[static_cast<size_t>(tail & m_mask)];
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		size_t Capacity() const { return m_buffer.size(); }
+	private:
+		std::vector<T> m_buffer;
+		size_t m_mask;
+		/** 生产者与消费者使用的变量分别放在不同的cache line中，避免伪共享 */
+		char m_padding0[CACHE_LINE_SIZE];
+		std::atomic<uint64_t> m_head; /**< 下一个写入的位置，只由生产者修改 */
+		uint64_t m_cachedTail; /**< 生产者缓存的消费位置 */
+		char m_padding1[CACHE_LINE_SIZE];
+		std::atomic<uint64_t> m_tail; /**< 下一个读取的位置，只由消费者修改 */
+		uint64_t m_cachedHead; /**< 消费者缓存的写入位置 */
+		char m_padding2[CACHE_LINE_SIZE];
+	};
+
+}
+
+#endif // SPSC_RING_H
@@ -82,6 +82,7 @@ public:
 		rectEle->SetAttribute("width", rect.width);
 		rectEle->SetAttribute("height", rect.height);
 		rectangleStyleHelper(rect.type, rectEle);
+		markStyleHelper(rect.marks, rectEle);
 		titleHelper(rectEle, rect.desc.c_str());
 		m_canvas->InsertEndChild(rectEle);
 		return rectEle;
@@ -114,6 +115,53 @@ public:
 			arrowHead->SetAttribute("x", arrow.inflexionPoint.back().x);
 			arrowHead->SetAttribute("y", arrow.inflexionPoint.back().y);
 		}
+		else if (arrow.type == PipelineProfilingGraph::Arrow::CRITICAL) {
+			pathHelper(arrow.inflexionPoint, arrowPath);
+			arrowPath->SetAttribute("stroke", "#ff0000");
+			arrowPath->SetAttribute("stroke-width", PipelineProfilingGraph::ARROW_LINE_WIDTH * 2.0f);
+			arrowHead = m_doc.NewElement("use");
+			arrowHead->SetAttribute("xlink:href", "#Diamond");
+			arrowHead->SetAttribute("fill", "#ff0000");
+			arrowHead->SetAttribute("x", arrow.inflexionPoint.back().x);
+			arrowHead->SetAttribute("y", arrow.inflexionPoint.back().y);
+		}
+		else if (arrow.type == PipelineProfilingGraph::Arrow::RACE) {
+			pathHelper(arrow.inflexionPoint, arrowPath);
+			arrowPath->SetAttribute("stroke", "#ff0000");
+			arrowPath->SetAttribute("stroke-dasharray", PipelineProfilingGraph::ARROW_LINE_END_RADIUS);
+			arrowHead = m_doc.NewElement("use");
+			arrowHead->SetAttribute("xlink:href", "#Diamond");
+			arrowHead->SetAttribute("fill", "#ff0000");
+			arrowHead->SetAttribute("x", arrow.inflexionPoint.back().x);
+			arrowHead->SetAttribute("y", arrow.inflexionPoint.back().y);
+		}
+		else if (arrow.type == PipelineProfilingGraph::Arrow::FENCE_ADDED
+			|| arrow.type == PipelineProfilingGraph::Arrow::FENCE_REMOVED) {
+			const char* color = arrow.type == PipelineProfilingGraph::Arrow::FENCE_ADDED ? "#13a10e" : "#7f7f7f";
+			pathHelper(arrow.inflexionPoint, arrowPath);
+			arrowPath->SetAttribute("stroke", color);
+			arrowPath->SetAttribute("stroke-width", PipelineProfilingGraph::ARROW_LINE_WIDTH * 2.0f);
+			if (arrow.type == PipelineProfilingGraph::Arrow::FENCE_REMOVED)
+				arrowPath->SetAttribute("stroke-dasharray", PipelineProfilingGraph::ARROW_LINE_END_RADIUS);
+			arrowHead = m_doc.NewElement("use");
+			arrowHead->SetAttribute("xlink:href", "#Diamond");
+			arrowHead->SetAttribute("fill", color);
+			arrowHead->SetAttribute("x", arrow.inflexionPoint.back().x);
+			arrowHead->SetAttribute("y", arrow.inflexionPoint.back().y);
+		}
+		else if (arrow.type == PipelineProfilingGraph::Arrow::WHISKER) {
+			pathHelper(arrow.inflexionPoint, arrowPath);
+			arrowPath->SetAttribute("stroke", "#404040");
+			/** 须线末端画一条竖线 */
+			const auto& end = arrow.inflexionPoint.back();
+			if (end.x > m_canvasWidth) SetCanvasWidth(end.x + PipelineProfilingGraph::LEFT_MARGIN);
+			std::vector<PipelineProfilingGraph::Point> cap = {
+				{ end.x, end.y - PipelineProfilingGraph::ARROW_LINE_END_RADIUS },
+				{ end.x, end.y + PipelineProfilingGraph::ARROW_LINE_END_RADIUS } };
+			arrowHead = m_doc.NewElement("path");
+			pathHelper(cap, arrowHead);
+			arrowHead->SetAttribute("stroke", "#404040");
+		}
 		else {
 			auto& xoc = m_xOccupy.find(static_cast<uint32_t>(arrow.inflexionPoint[0].x));
 			if (xoc == m_xOccupy.end()) {
@@ -143,10 +191,49 @@ public:
 				arrowHead->SetAttribute("height", PipelineProfilingGraph::ARROW_LINE_END_RADIUS * 2);
 			}
 		}
+		if (!arrow.desc.empty())
+			titleHelper(arrowPath, arrow.desc.c_str());
 		m_canvas->InsertEndChild(arrowPath);
 		m_canvas->InsertEndChild(arrowHead);
 		return arrowPath;
 	}
+	tinyxml2::XMLElement* AddPolygon(const PipelineProfilingGraph::Polygon& polygon) {
+		std::string points;
+		std::vector<char> point(40, 0);
+		for (const auto& vertex : polygon.points) {
+			if (vertex.x > m_canvasWidth) SetCanvasWidth(vertex.x + PipelineProfilingGraph::LEFT_MARGIN);
+			if (vertex.y > m_canvasHeight) SetCanvasHeight(vertex.y + PipelineProfilingGraph::TOP_MARGIN);
+			std::sprintf(point.data(), "%.3f,%.3f ", vertex.x, vertex.y);
+			points += point.data();
+		}
+		tinyxml2::XMLElement* polygonEle = m_doc.NewElement("polygon");
+		polygonEle->SetAttribute("points", points.c_str());
+		if (polygon.type == PipelineProfilingGraph::Polygon::MEMORY) {
+			polygonEle->SetAttribute("fill", "#ffa129");
+			polygonEle->SetAttribute("fill-opacity", 0.5f);
+			polygonEle->SetAttribute("stroke", "#c06000");
+			polygonEle->SetAttribute("stroke-width", STROKE_WIDTH);
+		}
+		titleHelper(polygonEle, polygon.desc.c_str());
+		m_canvas->InsertEndChild(polygonEle);
+		return polygonEle;
+	}
+	tinyxml2::XMLElement* AddLabel(const PipelineProfilingGraph::Label& label) {
+		float right = label.leftUpPoint.x + label.text.size() * PipelineProfilingGraph::LABEL_CHAR_WIDTH;
+		float bottom = label.leftUpPoint.y + PipelineProfilingGraph::LABEL_LINE_HEIGHT;
+		if (right > m_canvasWidth) SetCanvasWidth(right + PipelineProfilingGraph::LEFT_MARGIN);
+		if (bottom > m_canvasHeight) SetCanvasHeight(bottom + PipelineProfilingGraph::TOP_MARGIN);
+		tinyxml2::XMLElement* text = m_doc.NewElement("text");
+		text->SetAttribute("x", label.leftUpPoint.x);
+		/** y为基线的位置，使文字在行内垂直居中 */
+		text->SetAttribute("y", label.leftUpPoint.y + (PipelineProfilingGraph::LABEL_LINE_HEIGHT + PipelineProfilingGraph::LABEL_FONT_SIZE * 0.7f) / 2.0f);
+		text->SetAttribute("font-family", "monospace");
+		text->SetAttribute("font-size", PipelineProfilingGraph::LABEL_FONT_SIZE);
+		text->SetAttribute("xml:space", "preserve");
+		text->SetText(label.text.c_str());
+		m_canvas->InsertEndChild(text);
+		return text;
+	}
 private:
 	void rectangleStyleHelper(PipelineProfilingGraph::Rectangle::Type type,
 		tinyxml2::XMLElement* ele) {
@@ -175,10 +262,42 @@ private:
 			ele->SetAttribute("rx", 3);
 			ele->SetAttribute("ry", 3);
 			break;
+		case PipelineProfilingGraph::Rectangle::FRAME:
+			ele->SetAttribute("fill", "#7f7f7f");
+			ele->SetAttribute("fill-opacity", 0.6f);
+			break;
+		case PipelineProfilingGraph::Rectangle::BUBBLE:
+			ele->SetAttribute("fill", "#ff4040");
+			ele->SetAttribute("fill-opacity", 0.35f);
+			ele->SetAttribute("stroke", "#ff4040");
+			ele->SetAttribute("stroke-width", STROKE_WIDTH);
+			ele->SetAttribute("stroke-dasharray", PipelineProfilingGraph::ARROW_LINE_END_RADIUS);
+			break;
 		default:
 			break;
 		}
 	}
+	void markStyleHelper(uint8_t marks, tinyxml2::XMLElement* ele) {
+		if (marks & PipelineProfilingGraph::Rectangle::DIMMED) {
+			ele->SetAttribute("fill", "#bfbfbf");
+			ele->SetAttribute("fill-opacity", 0.5f);
+			ele->SetAttribute("stroke", "#7f7f7f");
+		}
+		if (marks & PipelineProfilingGraph::Rectangle::ADDED) {
+			ele->SetAttribute("stroke", "#13a10e");
+			ele->SetAttribute("stroke-width", STROKE_WIDTH * 2.5f);
+		}
+		if (marks & PipelineProfilingGraph::Rectangle::REMOVED) {
+			ele->SetAttribute("fill", "#bfbfbf");
+			ele->SetAttribute("fill-opacity", 0.5f);
+			ele->SetAttribute("stroke", "#7f7f7f");
+			ele->SetAttribute("stroke-dasharray", PipelineProfilingGraph::ARROW_LINE_END_RADIUS);
+		}
+		if (marks & PipelineProfilingGraph::Rectangle::HIGHLIGHT) {
+			ele->SetAttribute("stroke", "#ff0000");
+			ele->SetAttribute("stroke-width", STROKE_WIDTH * 2.5f);
+		}
+	}
 	void lineTranstStyleHelper(uint8_t flag,
 		tinyxml2::XMLElement* ele) {
 		uint8_t typeFlag1 = flag & 0x07U;
@@ -0,0 +1,402 @@
+#include "randomGraph.h"
+#include "reachability.h"
+#include "fenceInference.h"
+#include "frameAggregation.h"
+#include "graphDiff.h"
+#include "memoryTimeline.h"
+#include "frameGraphBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+using namespace PipelineProfilingGraph;
+
+/** 分析模块的行为测试，全部通过时返回0，否则输出失败的检查并返回1
+ * 用法: ppfgTest [测试名称]，不指定时运行所有测试 */
+
+namespace {
+
+	int g_failures = 0;
+
+	void checkHelper(bool condition, const char* text, const char* file, int line) {
+		if (condition) return;
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+		++g_failures;
+	}
+
+#define CHECK(condition) checkHelper((condition), #condition, __FILE__, __LINE__)
+
+	/** 由名称构造一个没有fence的queue */
+	Queue makeQueue(QueueIdx queIdx, const std::vector<std::string>& names) {
+		Queue queue;
+		for (PassIdx passIdx = 0; passIdx < names.size(); ++passIdx)
+			queue.emplace_back(names[passIdx].c_str(), queIdx, passIdx, FenceSignalPasses());
+		return queue;
+	}
+
+	/** 沿queue内的顺序与fence做广度优先搜索，得到每个pass能到达的所有pass，作为先后关系的参考答案 */
+	std::vector< std::vector<bool> > bruteForceReachability(const std::vector<Queue>& passMap) {
+		PassIndex index(passMap);
+		const uint32_t passCount = index.PassCount();
+		std::vector< std::vector<uint32_t> > successors(passCount);
+		for (uint32_t id = 0; id < passCount; ++id) {
+			PassLocate locate = index.ToLocate(id);
+			if (locate.inqueueIndex + 1 < passMap[locate.queueIndex].size()) successors[id].push_back(id + 1);
+			for (const auto& signal : passMap[locate.queueIndex][locate.inqueueIndex].depPasses)
+				successors[index.ToId(signal)].push_back(id);
+		}
+		std::vector< std::vector<bool> > reach(passCount, std::vector<bool>(passCount, false));
+		for (uint32_t source = 0; source < passCount; ++source) {
+			std::deque<uint32_t> pending(1, source);
+			while (!pending.empty()) {
+				uint32_t id = pending.front();
+				pending.pop_front();
+				for (uint32_t next : successors[id]) {
+					if (reach[source][next]) continue;
+					reach[source][next] = true;
+					pending.push_back(next);
+				}
+			}
+		}
+		return reach;
+	}
+
+	bool buildIndex(const std::vector<Queue>& passMap, ReachabilityIndex::Mode mode, ReachabilityIndex& reachability) {
+		ReachabilityIndex::Options options;
+		options.mode = mode;
+		std::string error;
+		bool succeed = reachability.Build(passMap, options, &error);
+		if (!succeed) std::fprintf(stderr, "cannot build the reachability index: %s\n", error.c_str());
+		return succeed;
+	}
+
+	void testReachability() {
+		/** queue0: A B C，queue1: X Y，X等待A，C等待Y */
+		std::vector<Queue> passMap = { makeQueue(0, { "A", "B", "C" }), makeQueue(1, { "X", "Y" }) };
+		passMap[1][0].depPasses.push_back({ 0, 0 });
+		passMap[0][2].depPasses.push_back({ 1, 1 });
+		const PassLocate A = { 0, 0 }, B = { 0, 1 }, C = { 0, 2 }, X = { 1, 0 }, Y = { 1, 1 };
+		for (ReachabilityIndex::Mode mode : { ReachabilityIndex::CHAIN, ReachabilityIndex::BITSET }) {
+			ReachabilityIndex reachability;
+			if (!buildIndex(passMap, mode, reachability)) {
+				CHECK(false);
+				continue;
+			}
+			CHECK(reachability.GetMode() == mode);
+			CHECK(reachability.HappensBefore(A, B));
+			CHECK(reachability.HappensBefore(A, Y));
+			CHECK(reachability.HappensBefore(X, C));
+			CHECK(reachability.HappensBefore(A, C));
+			CHECK(!reachability.HappensBefore(C, A));
+			CHECK(!reachability.HappensBefore(A, A));
+			CHECK(reachability.Concurrent(B, X));
+			CHECK(reachability.Concurrent(B, Y));
+			CHECK(!reachability.Concurrent(Y, C));
+		}
+
+		/** fence之间存在环时两种方式都应该失败 */
+		passMap[1][0].depPasses.push_back({ 0, 2 });
+		for (ReachabilityIndex::Mode mode : { ReachabilityIndex::CHAIN, ReachabilityIndex::BITSET }) {
+			ReachabilityIndex reachability;
+			ReachabilityIndex::Options options;
+			options.mode = mode;
+			CHECK(!reachability.Build(passMap, options));
+		}
+	}
+
+	/** CHAIN与BITSET在随机图上的所有pass对上都与广度优先搜索的结果一致 */
+	void testReachabilityModesAgree() {
+		for (uint32_t seed = 1; seed <= 40; ++seed) {
+			uint32_t queueCount = 1 + seed % 6;
+			std::vector<Queue> passMap = MakeRandomPassMap(queueCount, 4 + seed % 13, 0.4, seed);
+			std::vector< std::vector<bool> > reach = bruteForceReachability(passMap);
+			ReachabilityIndex chain, bitset;
+			if (!buildIndex(passMap, ReachabilityIndex::CHAIN, chain)
+				|| !buildIndex(passMap, ReachabilityIndex::BITSET, bitset)) {
+				CHECK(false);
+				continue;
+			}
+			const uint32_t passCount = chain.Index().PassCount();
+			uint32_t mismatches = 0;
+			for (uint32_t a = 0; a < passCount; ++a) {
+				for (uint32_t b = 0; b < passCount; ++b) {
+					bool expected = a != b && reach[a][b];
+					if (chain.HappensBefore(a, b) != expected || bitset.HappensBefore(a, b) != expected) ++mismatches;
+				}
+			}
+			CHECK(mismatches == 0);
+		}
+	}
+
+	void testFenceInference() {
+		/** queue0: A B，queue1: X Y；A写入S由X读取，A写入R由Y读取
+		 * A->Y可以由A->X与queue1上的顺序推出，因此最少的fence只有A->X */
+		FrameGraphBuilder builder;
+		PassHandle A = builder.AddPass(0, "A"), B = builder.AddPass(0, "B");
+		PassHandle X = builder.AddPass(1, "X"), Y = builder.AddPass(1, "Y");
+		(void)B;
+		ResourceHandle R = builder.AddResource("R"), S = builder.AddResource("S");
+		builder.Write(R, A);
+		builder.Write(S, A);
+		builder.Read(S, X);
+		builder.Read(R, Y);
+		builder.AddFence(A, X);
+		builder.AddFence(A, Y);
+		std::vector<Queue> passMap;
+		std::vector<Resource> resMap;
+		CHECK(builder.Build(passMap, resMap));
+
+		FenceInferenceResult result;
+		CHECK(InferFences(passMap, resMap, result));
+		const PassLocate a = { 0, 0 }, x = { 1, 0 }, y = { 1, 1 };
+		CHECK(result.inputFenceCount == 2);
+		CHECK(result.minimalFences.size() == 1);
+		if (result.minimalFences.size() == 1)
+			CHECK(result.minimalFences[0].signal == a && result.minimalFences[0].wait == x);
+		CHECK(result.missingFences.empty());
+		CHECK(result.redundantFences.size() == 1);
+		if (result.redundantFences.size() == 1) {
+			CHECK(result.redundantFences[0].fence.signal == a && result.redundantFences[0].fence.wait == y);
+			CHECK(result.redundantFences[0].reason == RedundantFence::IMPLIED);
+		}
+
+		/** 去掉所有fence后，最少的fence成为输入缺少的fence */
+		for (auto& queue : passMap)
+			for (auto& pass : queue)
+				pass.depPasses.clear();
+		CHECK(InferFences(passMap, resMap, result));
+		CHECK(result.inputFenceCount == 0);
+		CHECK(result.missingFences.size() == 1);
+		if (result.missingFences.size() == 1)
+			CHECK(result.missingFences[0].signal == a && result.missingFences[0].wait == x);
+	}
+
+	/** 在随机图上，用推导出的fence替换原有的fence后，原图中每个跨queue的写后读仍然有先后关系 */
+	void testInferredFencesPreserveConflicts() {
+		for (uint32_t seed = 1; seed <= 20; ++seed) {
+			std::vector<Queue> passMap = MakeRandomPassMap(3, 8, 0.5, seed);
+			std::mt19937 random(seed);
+			ReachabilityIndex original;
+			if (!buildIndex(passMap, ReachabilityIndex::CHAIN, original)) {
+				CHECK(false);
+				continue;
+			}
+			/** 只在原图中有先后关系的pass之间加入写后读，保证原图没有数据竞争 */
+			const PassIndex& index = original.Index();
+			std::vector<Resource> resMap;
+			std::vector< std::pair<uint32_t, uint32_t> > conflicts;
+			for (uint32_t attempt = 0; attempt < 64 && resMap.size() < 12; ++attempt) {
+				uint32_t writer = random() % index.PassCount(), reader = random() % index.PassCount();
+				if (!original.HappensBefore(writer, reader)) continue;
+				std::string name = "R" + std::to_string(resMap.size());
+				resMap.emplace_back(name.c_str(), INVALID_PASS_LOCATE, INVALID_PASS_LOCATE,
+					std::vector<PassLocate>(1, index.ToLocate(reader)), std::vector<PassLocate>(1, index.ToLocate(writer)));
+				conflicts.push_back(std::make_pair(writer, reader));
+			}
+			FenceInferenceResult result;
+			CHECK(InferFences(passMap, resMap, result));
+			CHECK(result.missingFences.empty());
+			ReplaceFences(passMap, result.minimalFences);
+			ReachabilityIndex inferred;
+			if (!buildIndex(passMap, ReachabilityIndex::CHAIN, inferred)) {
+				CHECK(false);
+				continue;
+			}
+			for (const auto& conflict : conflicts)
+				CHECK(inferred.HappensBefore(conflict.first, conflict.second));
+		}
+	}
+
+	void testP2Quantile() {
+		/** 样本少于5个时为精确值 */
+		P2Quantile small(0.5);
+		CHECK(small.Get() == 0.0);
+		small.Add(3.0);
+		small.Add(1.0);
+		small.Add(2.0);
+		CHECK(small.Count() == 3);
+		CHECK(small.Get() == 2.0);
+
+		/** 打乱顺序的均匀分布，估计值应该接近真实的分位数 */
+		std::vector<double> values;
+		for (int value = 0; value < 10000; ++value) values.push_back(value);
+		std::shuffle(values.begin(), values.end(), std::mt19937(7));
+		P2Quantile median(0.5), p99(0.99);
+		for (double value : values) {
+			median.Add(value);
+			p99.Add(value);
+		}
+		CHECK(std::fabs(median.Get() - 4999.5) < 100.0);
+		CHECK(std::fabs(p99.Get() - 9899.0) < 50.0);
+
+		/** 单调递增的输入是P²最不利的情况之一，估计值仍然不能越过样本的范围 */
+		P2Quantile sorted(0.9);
+		for (int value = 1; value <= 1000; ++value) sorted.Add(value);
+		CHECK(sorted.Get() >= 1.0 && sorted.Get() <= 1000.0);
+		CHECK(std::fabs(sorted.Get() - 900.0) < 20.0);
+	}
+
+	void testFrameAggregation() {
+		FrameAggregator aggregator;
+		const uint64_t durations[] = { 10, 30, 20 };
+		for (uint64_t duration : durations) {
+			FrameGraphBuilder builder;
+			PassHandle A = builder.AddPass(0, "A"), B = builder.AddPass(0, "B");
+			builder.SetPassTime(A, 1000, 1000 + duration);
+			builder.SetPassTime(B, 2000, 2005);
+			std::vector<Queue> passMap;
+			std::vector<Resource> resMap;
+			CHECK(builder.Build(passMap, resMap));
+			aggregator.AddFrame(passMap, resMap);
+		}
+		/** 名称不同的pass不参与统计 */
+		std::vector<Queue> renamed = { makeQueue(0, { "A", "Other" }) };
+		aggregator.AddFrame(renamed, std::vector<Resource>());
+		CHECK(aggregator.FrameCount() == 4);
+		CHECK(aggregator.UnmatchedPasses() == 1);
+		const PassDurationStats& stats = aggregator.GetStats({ 0, 0 });
+		CHECK(stats.count == 3);
+		CHECK(stats.min == 10);
+		CHECK(stats.max == 30);
+		CHECK(std::fabs(stats.mean - 20.0) < 1e-9);
+		CHECK(stats.p50.Get() == 20.0);
+	}
+
+	/** 动态规划计算最长公共子序列的长度，作为Myers对齐的参考答案 */
+	size_t longestCommonSubsequence(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs) {
+		std::vector< std::vector<size_t> > lengths(lhs.size() + 1, std::vector<size_t>(rhs.size() + 1, 0));
+		for (size_t i = 1; i <= lhs.size(); ++i)
+			for (size_t j = 1; j <= rhs.size(); ++j)
+				lengths[i][j] = lhs[i - 1] == rhs[j - 1] ? lengths[i - 1][j - 1] + 1
+					: std::max(lengths[i - 1][j], lengths[i][j - 1]);
+		return lengths[lhs.size()][rhs.size()];
+	}
+
+	size_t countChanges(const GraphDiff& diff, GraphDiff::PassChange change) {
+		return static_cast<size_t>(std::count(diff.passChanges.begin(), diff.passChanges.end(), static_cast<uint8_t>(change)));
+	}
+
+	void testGraphDiff() {
+		/** B被删除，E被加入，其余的pass对齐 */
+		std::vector<Queue> oldPassMap = { makeQueue(0, { "A", "B", "C", "D" }) };
+		std::vector<Queue> newPassMap = { makeQueue(0, { "A", "C", "E", "D" }) };
+		GraphDiff diff;
+		CHECK(DiffGraphs(oldPassMap, std::vector<Resource>(), newPassMap, std::vector<Resource>(), diff));
+		CHECK(diff.addedPasses == 1);
+		CHECK(diff.removedPasses == 1);
+		CHECK(diff.movedPasses == 0);
+		CHECK(countChanges(diff, GraphDiff::PASS_MATCHED) == 3);
+		CHECK(diff.passMap.size() == 1 && diff.passMap[0].size() == 5);
+
+		/** C被移到最前面: 对齐A B，C视为移动 */
+		oldPassMap = { makeQueue(0, { "A", "B", "C" }) };
+		newPassMap = { makeQueue(0, { "C", "A", "B" }) };
+		CHECK(DiffGraphs(oldPassMap, std::vector<Resource>(), newPassMap, std::vector<Resource>(), diff));
+		CHECK(diff.movedPasses == 1);
+		CHECK(diff.addedPasses == 0 && diff.removedPasses == 0);
+		CHECK(countChanges(diff, GraphDiff::PASS_MATCHED) == 2);
+
+		/** 随机编辑后的序列: 对齐的pass数量必须等于最长公共子序列的长度，分治的各个分支都会被覆盖 */
+		std::mt19937 random(11);
+		for (int round = 0; round < 50; ++round) {
+			std::vector<std::string> before, after;
+			size_t length = 1 + random() % 60;
+			for (size_t item = 0; item < length; ++item) before.push_back(std::string(1, static_cast<char>('a' + random() % 6)));
+			for (const auto& name : before) {
+				uint32_t edit = random() % 10;
+				if (edit == 0) continue;
+				if (edit == 1) after.push_back(std::string(1, static_cast<char>('a' + random() % 6)));
+				after.push_back(name);
+			}
+			oldPassMap = { makeQueue(0, before) };
+			newPassMap = { makeQueue(0, after) };
+			if (!DiffGraphs(oldPassMap, std::vector<Resource>(), newPassMap, std::vector<Resource>(), diff)) {
+				CHECK(false);
+				continue;
+			}
+			size_t matched = countChanges(diff, GraphDiff::PASS_MATCHED);
+			CHECK(matched == longestCommonSubsequence(before, after));
+			CHECK(matched + diff.movedPasses + diff.removedPasses == before.size());
+			CHECK(matched + diff.movedPasses + diff.addedPasses == after.size());
+		}
+	}
+
+	void testMemoryTimeline() {
+		/** queue0: A B C D，queue1: X等待A并与B、C同时执行；B执行时R1、R3与Out同时存活 */
+		FrameGraphBuilder builder;
+		PassHandle A = builder.AddPass(0, "A"), B = builder.AddPass(0, "B");
+		PassHandle C = builder.AddPass(0, "C"), D = builder.AddPass(0, "D");
+		PassHandle X = builder.AddPass(1, "X");
+		builder.AddFence(A, X);
+		const PassHandle passes[] = { A, B, C, D };
+		for (uint64_t passIdx = 0; passIdx < 4; ++passIdx)
+			builder.SetPassTime(passes[passIdx], passIdx * 100, passIdx * 100 + 100);
+		builder.SetPassTime(X, 100, 350);
+		struct Lifetime {
+			const char* name;
+			PassHandle create;
+			PassHandle destroy;
+			uint64_t size;
+		};
+		const Lifetime lifetimes[] = { { "R1", A, X, 500 }, { "R2", A, A, 510 }, { "R3", B, C, 500 }, { "Out", X, D, 510 } };
+		for (const auto& lifetime : lifetimes) {
+			ResourceHandle resource = builder.AddResource(lifetime.name);
+			builder.SetLifetime(resource, lifetime.create, lifetime.destroy);
+			builder.SetMemory(resource, lifetime.size);
+		}
+		std::vector<Queue> passMap;
+		std::vector<Resource> resMap;
+		CHECK(builder.Build(passMap, resMap));
+
+		MemoryTimeline timeline;
+		CHECK(BuildMemoryTimeline(passMap, resMap, timeline));
+		CHECK(timeline.timed);
+		CHECK(timeline.peakBytes == 1510);
+		CHECK(timeline.peakResources.size() == 3);
+		CHECK(timeline.totalBytes == 2020);
+
+		/** 没有时间时按先后关系估计，结果相同 */
+		for (auto& queue : passMap)
+			for (auto& pass : queue)
+				pass.startTime = pass.endTime = INVALID_TIMESTAMP;
+		CHECK(BuildMemoryTimeline(passMap, resMap, timeline));
+		CHECK(!timeline.timed);
+		CHECK(timeline.peakBytes == 1510);
+		CHECK(timeline.liveBytes[0][0] == 1010);
+		CHECK(timeline.liveBytes[1][0] == 1510);
+	}
+
+	struct TestCase {
+		const char* name;
+		void (*run)();
+	};
+
+	const TestCase TESTS[] = {
+		{ "reachability", testReachability },
+		{ "reachability-modes", testReachabilityModesAgree },
+		{ "fence-inference", testFenceInference },
+		{ "fence-inference-random", testInferredFencesPreserveConflicts },
+		{ "p2-quantile", testP2Quantile },
+		{ "frame-aggregation", testFrameAggregation },
+		{ "graph-diff", testGraphDiff },
+		{ "memory-timeline", testMemoryTimeline },
+	};
+
+}
+
+int main(int argc, char** argv) {
+	int ran = 0;
+	for (const auto& test : TESTS) {
+		if (argc > 1 && std::strcmp(argv[1], test.name) != 0) continue;
+		int failures = g_failures;
+		test.run();
+		std::printf("%s %s\n", g_failures == failures ? "PASS" : "FAIL", test.name);
+		++ran;
+	}
+	if (ran == 0) {
+		std::fprintf(stderr, "unknown test %s\n", argv[1]);
+		return 1;
+	}
+	return g_failures == 0 ? 0 : 1;
+}
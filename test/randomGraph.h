@@ -0,0 +1,40 @@
+#ifndef RANDOM_GRAPH_H
+#define RANDOM_GRAPH_H
+
+#include "ppfg.h"
+#include <random>
+
+/** 测试与基准共用的随机渲染图
+ * 每个queue上的pass数量相同，queue内第i个pass只等待其他queue上索引小于i的pass，因此fence之间一定没有环 */
+namespace PipelineProfilingGraph {
+
+	/** 生成随机的pass与fence，结果只由参数与种子决定
+	 * @param queueCount queue的数量
+	 * @param passesPerQueue 每个queue上pass的数量
+	 * @param fenceChance 每个pass等待一个其他queue上的pass的概率
+	 * @param seed 随机数种子 */
+	inline std::vector<Queue> MakeRandomPassMap(uint32_t queueCount, uint32_t passesPerQueue,
+		double fenceChance, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		std::vector<Queue> passMap(queueCount);
+		for (QueueIdx queIdx = 0; queIdx < queueCount; ++queIdx) {
+			passMap[queIdx].reserve(passesPerQueue);
+			for (PassIdx passIdx = 0; passIdx < passesPerQueue; ++passIdx) {
+				FenceSignalPasses signals;
+				if (queueCount > 1 && passIdx > 0 && chance(random) < fenceChance) {
+					QueueIdx other = static_cast<QueueIdx>(random() % (queueCount - 1));
+					if (other >= queIdx) ++other;
+					signals.push_back({ other, static_cast<PassIdx>(random() % passIdx) });
+				}
+				std::string name = "p" + std::to_string(queIdx) + "_" + std::to_string(passIdx);
+				passMap[queIdx].emplace_back(name.c_str(), queIdx, passIdx, std::move(signals));
+			}
+		}
+		return passMap;
+	}
+
+}
+
+#endif // RANDOM_GRAPH_H
@@ -0,0 +1,77 @@
+#include "randomGraph.h"
+#include "reachability.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+using namespace PipelineProfilingGraph;
+
+/** ReachabilityIndex的基准: 在固定种子的随机图上分别建立CHAIN与BITSET索引，输出建立的时间与占用的内存，
+ * 再用相同的随机查询比较两者的结果，结果不一致时返回1
+ * 用法: reachabilityBenchmark [pass数量(默认100000)] [queue数量(默认4)] [查询数量(默认2000000)] [种子(默认1)]
+ * BITSET约占用 pass数^2 / 16 字节，默认参数下约600MB，32位程序中需要减少pass的数量 */
+
+namespace {
+
+	double elapsedMilliseconds(std::chrono::steady_clock::time_point begin) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	}
+
+	bool buildTimed(const std::vector<Queue>& passMap, ReachabilityIndex::Mode mode, const char* name,
+		ReachabilityIndex& reachability) {
+		ReachabilityIndex::Options options;
+		options.mode = mode;
+		options.memoryBudget = SIZE_MAX;
+		std::string error;
+		auto begin = std::chrono::steady_clock::now();
+		if (!reachability.Build(passMap, options, &error)) {
+			std::fprintf(stderr, "cannot build the %s index: %s\n", name, error.c_str());
+			return false;
+		}
+		std::printf("%-6s build %10.1f ms, %10.1f MiB\n", name, elapsedMilliseconds(begin),
+			static_cast<double>(reachability.MemoryUsage()) / (1024.0 * 1024.0));
+		return true;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	uint32_t passCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 100000;
+	uint32_t queueCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 4;
+	uint64_t queryCount = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2000000;
+	uint32_t seed = argc > 4 ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : 1;
+	if (queueCount == 0 || passCount < queueCount) {
+		std::fprintf(stderr, "need at least one pass per queue\n");
+		return 1;
+	}
+	std::vector<Queue> passMap = MakeRandomPassMap(queueCount, passCount / queueCount, 0.25, seed);
+	std::printf("%u passes, %u queues, %llu queries, seed %u\n", passCount / queueCount * queueCount, queueCount,
+		static_cast<unsigned long long>(queryCount), seed);
+
+	ReachabilityIndex chain, bitset;
+	if (!buildTimed(passMap, ReachabilityIndex::CHAIN, "chain", chain)) return 1;
+	if (!buildTimed(passMap, ReachabilityIndex::BITSET, "bitset", bitset)) return 1;
+
+	/** 两种方式使用相同的查询，先生成查询再分别计时 */
+	std::mt19937 random(seed);
+	const uint32_t count = chain.Index().PassCount();
+	std::vector< std::pair<uint32_t, uint32_t> > queries(queryCount);
+	for (auto& query : queries) query = std::make_pair(random() % count, random() % count);
+	std::vector<uint8_t> chainAnswers(queryCount), bitsetAnswers(queryCount);
+	auto begin = std::chrono::steady_clock::now();
+	for (uint64_t queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+		chainAnswers[queryIdx] = chain.HappensBefore(queries[queryIdx].first, queries[queryIdx].second);
+	std::printf("chain  query %10.1f ms\n", elapsedMilliseconds(begin));
+	begin = std::chrono::steady_clock::now();
+	for (uint64_t queryIdx = 0; queryIdx < queryCount; ++queryIdx)
+		bitsetAnswers[queryIdx] = bitset.HappensBefore(queries[queryIdx].first, queries[queryIdx].second);
+	std::printf("bitset query %10.1f ms\n", elapsedMilliseconds(begin));
+
+	uint64_t mismatches = 0, ordered = 0;
+	for (uint64_t queryIdx = 0; queryIdx < queryCount; ++queryIdx) {
+		if (chainAnswers[queryIdx] != bitsetAnswers[queryIdx]) ++mismatches;
+		ordered += chainAnswers[queryIdx];
+	}
+	std::printf("%llu ordered pairs, %llu mismatches\n",
+		static_cast<unsigned long long>(ordered), static_cast<unsigned long long>(mismatches));
+	return mismatches == 0 ? 0 : 1;
+}